@@ -0,0 +1,201 @@
+// Raw video benchmarks: fused BGRx -> I420 convert+scale against separate passes, and block-hash change detection, printed as JSON
+#include "convert_scale.h"
+#include "frame_diff.h"
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ve;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  double min_seconds = 0.5;
+  int threads = 0;     // 0 = min(cores, 4)
+  std::string filter;  // substring of "<bench>/<case>"
+};
+
+bool enabled(const Options& opt, const char* name) {
+  return opt.filter.empty() || std::strstr(name, opt.filter.c_str()) != nullptr;
+}
+
+// Runs fn repeatedly for at least min_seconds; returns seconds per call.
+double time_per_call(const Options& opt, const std::function<void()>& fn) {
+  fn();  // warm-up
+  std::size_t iters = 1;
+  for (;;) {
+    const auto t0 = Clock::now();
+    for (std::size_t i = 0; i < iters; ++i) fn();
+    const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+    if (s >= opt.min_seconds) return s / static_cast<double>(iters);
+    iters = s > 0 ? static_cast<std::size_t>(iters * std::min(10.0, 1.5 * opt.min_seconds / s)) + 1
+                  : iters * 10;
+  }
+}
+
+class Json {
+ public:
+  void begin(const char* bench) {
+    std::printf("%s\n    {\"bench\": \"%s\"", first_ ? "" : ",", bench);
+    first_ = false;
+  }
+  void field(const char* key, const char* v) { std::printf(", \"%s\": \"%s\"", key, v); }
+  void field(const char* key, long long v) { std::printf(", \"%s\": %lld", key, v); }
+  void field(const char* key, double v) { std::printf(", \"%s\": %.4g", key, v); }
+  void end() { std::printf("}"); }
+
+ private:
+  bool first_ = true;
+};
+
+struct I420Buffer {
+  std::vector<std::uint8_t> planes[3];
+  PlanarFrame frame;
+
+  I420Buffer(int width, int height) {
+    const int cw = (width + 1) / 2;
+    const int ch = (height + 1) / 2;
+    planes[0].resize(static_cast<std::size_t>(width) * height);
+    planes[1].resize(static_cast<std::size_t>(cw) * ch);
+    planes[2].resize(static_cast<std::size_t>(cw) * ch);
+    for (int i = 0; i < 3; ++i) frame.planes[i] = planes[i].data();
+    frame.strides[0] = width;
+    frame.strides[1] = frame.strides[2] = cw;
+    frame.width = width;
+    frame.height = height;
+  }
+};
+
+struct Case {
+  const char* name;
+  int src_width, src_height, dst_width, dst_height;
+};
+
+void result(Json& json, const char* bench, const Case& c, int threads, double seconds, std::size_t bytes,
+            double baseline) {
+  json.begin(bench);
+  json.field("case", c.name);
+  json.field("kernel", convert_kernel_name(convert_kernel()));
+  json.field("threads", static_cast<long long>(threads));
+  json.field("frames_per_s", 1.0 / seconds);
+  json.field("ms_per_frame", seconds * 1e3);
+  json.field("mb_per_frame", bytes / 1e6);
+  if (baseline > 0) json.field("speedup", baseline / seconds);
+  json.end();
+}
+
+void bench_case(const Options& opt, Json& json, const Case& c) {
+  std::mt19937 rng(7);
+  const std::size_t src_stride = static_cast<std::size_t>(c.src_width) * 4;
+  std::vector<std::uint8_t> src(src_stride * c.src_height);
+  for (auto& b : src) b = static_cast<std::uint8_t>(rng());
+  const PackedFrame in{src.data(), src_stride, c.src_width, c.src_height};
+  I420Buffer out(c.dst_width, c.dst_height);
+
+  // Two elements: a full resampled BGRx frame is written, then read back
+  // by the converter (same kernels, one thread, as a single streaming
+  // thread runs videoscale then videoconvert).
+  const std::size_t mid_stride = static_cast<std::size_t>(c.dst_width) * 4;
+  std::vector<std::uint8_t> mid(mid_stride * c.dst_height);
+  FusedConvertScale scale_only({c.src_width, c.src_height, c.dst_width, c.dst_height});
+  FusedConvertScale convert_only({c.dst_width, c.dst_height, c.dst_width, c.dst_height});
+  const PackedFrame mid_frame{mid.data(), mid_stride, c.dst_width, c.dst_height};
+  // Source read, intermediate written and read back, planes written.
+  const std::size_t two_pass_bytes = src.size() + mid.size() + convert_only.bytes_per_frame();
+  const double two_pass = time_per_call(opt, [&] {
+    scale_only.resample(in, mid.data(), mid_stride);
+    convert_only.process(mid_frame, out.frame);
+  });
+  const std::string name = std::string("/") + c.name;
+  if (enabled(opt, ("two_pass" + name).c_str())) result(json, "two_pass", c, 1, two_pass, two_pass_bytes, 0.0);
+
+  if (enabled(opt, ("fused_1t" + name).c_str())) {
+    FusedConvertScale fused({c.src_width, c.src_height, c.dst_width, c.dst_height});
+    const double s = time_per_call(opt, [&] { fused.process(in, out.frame); });
+    result(json, "fused_1t", c, 1, s, fused.bytes_per_frame(), two_pass);
+  }
+  if (enabled(opt, ("fused_mt" + name).c_str()) && opt.threads > 1) {
+    WorkerPool pool(opt.threads - 1);
+    ConvertScaleConfig cfg{c.src_width, c.src_height, c.dst_width, c.dst_height};
+    cfg.stripes = opt.threads * 2;
+    FusedConvertScale fused(cfg);
+    const double s = time_per_call(opt, [&] { fused.process(in, out.frame, &pool); });
+    result(json, "fused_mt", c, opt.threads, s, fused.bytes_per_frame(), two_pass);
+  }
+}
+
+// Change detection over an unchanged BGRx frame: what every static screen frame costs.
+void bench_block_hash(const Options& opt, Json& json, const char* name, int width, int height) {
+  if (!enabled(opt, (std::string("block_hash/") + name).c_str())) return;
+  std::mt19937 rng(11);
+  const std::size_t stride = static_cast<std::size_t>(width) * 4;
+  std::vector<std::uint8_t> frame(stride * height);
+  for (auto& b : frame) b = static_cast<std::uint8_t>(rng());
+  const std::vector<PlaneView> planes = {{frame.data(), stride, stride, height}};
+  BlockChangeDetector detector;
+  detector.update(planes);
+  int changed = 0;
+  const double s = time_per_call(opt, [&] { changed += detector.update(planes); });
+  json.begin("block_hash");
+  json.field("case", name);
+  json.field("kernel", hash_kernel_name(hash_kernel()));
+  json.field("blocks", static_cast<long long>(detector.blocks()));
+  json.field("changed", static_cast<long long>(changed));
+  json.field("ms_per_frame", s * 1e3);
+  json.field("gb_per_s", frame.size() / s / 1e9);
+  json.end();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    if (a == "--quick") {
+      opt.min_seconds = 0.05;
+    } else if (a.rfind("--threads=", 0) == 0) {
+      opt.threads = std::max(1, std::stoi(a.substr(10)));
+    } else if (a.rfind("--kernel=", 0) == 0) {
+      const std::string k = a.substr(9);
+      const ConvertKernel kernel = k == "avx2" ? ConvertKernel::Avx2 : k == "sse2" ? ConvertKernel::Sse2
+                                                                                   : ConvertKernel::Scalar;
+      const HashKernel hash = k == "avx2" ? HashKernel::Avx2 : k == "sse2" ? HashKernel::Sse2 : HashKernel::Scalar;
+      if (!set_convert_kernel(kernel) || !set_hash_kernel(hash)) {
+        std::fprintf(stderr, "Kernel %s not supported on this CPU\n", k.c_str());
+        return 1;
+      }
+    } else if (a.rfind("--filter=", 0) == 0) {
+      opt.filter = a.substr(9);
+    } else {
+      std::fprintf(stderr,
+                   "Usage: %s [--quick] [--threads=<n>] [--kernel=scalar|sse2|avx2] [--filter=<bench/case substring>]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+  if (opt.threads == 0) opt.threads = std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1, 4);
+
+  const Case cases[] = {
+      {"1080p_to_720p", 1920, 1080, 1280, 720},
+      {"1080p_to_1080p", 1920, 1080, 1920, 1080},
+      {"1440p_to_720p", 2560, 1440, 1280, 720},
+  };
+  Json json;
+  std::printf("{\n  \"convert_kernel\": \"%s\",\n  \"results\": [", convert_kernel_name(convert_kernel()));
+  for (const Case& c : cases) bench_case(opt, json, c);
+  bench_block_hash(opt, json, "1080p", 1920, 1080);
+  bench_block_hash(opt, json, "1440p", 2560, 1440);
+  std::printf("\n  ]\n}\n");
+  return 0;
+}
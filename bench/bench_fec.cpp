@@ -0,0 +1,578 @@
+// FEC micro-benchmarks: throughput, recovery latency and frame decodability, printed as JSON
+#include "fec_decoder.h"
+#include "gf256.h"
+#include "h264_nal.h"
+#include "rs_fec.h"
+#include "rtp_fec.h"
+#include "sliding_fec.h"
+#include "xor_fec.h"
+#include "xor_kernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ve;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  double min_seconds = 0.1;
+  std::string filter;  // substring of benchmark name
+};
+
+bool enabled(const Options& opt, const char* name) {
+  return opt.filter.empty() || std::strstr(name, opt.filter.c_str()) != nullptr;
+}
+
+// Runs fn repeatedly for at least min_seconds; returns seconds per call.
+double time_per_call(const Options& opt, const std::function<void()>& fn) {
+  fn();  // warm-up
+  std::size_t iters = 1;
+  for (;;) {
+    const auto t0 = Clock::now();
+    for (std::size_t i = 0; i < iters; ++i) fn();
+    const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+    if (s >= opt.min_seconds) return s / static_cast<double>(iters);
+    iters = s > 0 ? static_cast<std::size_t>(iters * std::min(10.0, 1.5 * opt.min_seconds / s)) + 1
+                  : iters * 10;
+  }
+}
+
+class Json {
+ public:
+  void begin(const char* bench) {
+    std::printf("%s\n    {\"bench\": \"%s\"", first_ ? "" : ",", bench);
+    first_ = false;
+  }
+  void field(const char* key, const char* v) { std::printf(", \"%s\": \"%s\"", key, v); }
+  void field(const char* key, long long v) { std::printf(", \"%s\": %lld", key, v); }
+  void field(const char* key, double v) { std::printf(", \"%s\": %.4g", key, v); }
+  void end() { std::printf("}"); }
+
+ private:
+  bool first_ = true;
+};
+
+std::vector<std::vector<std::uint8_t>> random_packets(std::mt19937& rng, std::size_t n,
+                                                      std::size_t size) {
+  std::vector<std::vector<std::uint8_t>> out(n, std::vector<std::uint8_t>(size));
+  for (auto& p : out) for (auto& b : p) b = static_cast<std::uint8_t>(rng());
+  return out;
+}
+
+std::vector<std::uint8_t> rtp_packet(std::mt19937& rng, std::uint16_t seq, std::size_t payload) {
+  std::vector<std::uint8_t> p(kRtpHeaderSize + payload);
+  for (auto& b : p) b = static_cast<std::uint8_t>(rng());
+  p[0] = 0x80;
+  p[1] = 96;
+  p[2] = static_cast<std::uint8_t>(seq >> 8);
+  p[3] = static_cast<std::uint8_t>(seq);
+  p[8] = 0x11; p[9] = 0x22; p[10] = 0x33; p[11] = 0x44;
+  return p;
+}
+
+// Loss pattern: iid with probability p, or Gilbert-Elliott bursts with the
+// same average loss and mean burst length `burst`.
+class LossModel {
+ public:
+  LossModel(const char* name, double p, double burst, std::uint32_t seed)
+      : name_(name), p_(p), rng_(seed) {
+    if (burst > 1.0) {
+      r_ = 1.0 / burst;                 // bad -> good
+      q_ = p * r_ / (1.0 - p);          // good -> bad
+    }
+  }
+  const char* name() const { return name_; }
+  double rate() const { return p_; }
+  bool lost() {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    if (r_ == 0.0) return u(rng_) < p_;
+    bad_ = bad_ ? u(rng_) >= r_ : u(rng_) < q_;
+    return bad_;
+  }
+
+ private:
+  const char* name_;
+  double p_;
+  double q_ = 0.0;
+  double r_ = 0.0;
+  bool bad_ = false;
+  std::mt19937 rng_;
+};
+
+const std::size_t kGroups[] = {2, 4, 8, 16, 32, 64};
+const std::size_t kSizes[] = {200, 600, 1000, 1400};
+
+void bench_xor(const Options& opt, Json& json) {
+  std::mt19937 rng(1);
+  for (XorKernel k : {XorKernel::Scalar, XorKernel::Sse2, XorKernel::Avx2}) {
+    if (!set_xor_kernel(k)) continue;
+    for (std::size_t g : kGroups) {
+      for (std::size_t size : kSizes) {
+        const auto packets = random_packets(rng, g, size);
+        const std::vector<std::span<const std::uint8_t>> views(packets.begin(), packets.end());
+        const FecPacket parity = xor_parity(views, 0);
+        const std::vector<std::span<const std::uint8_t>> received(views.begin() + 1, views.end());
+
+        const double enc = time_per_call(opt, [&] {
+          FecPacket f = xor_parity(views, 0);
+          if (f.data.empty()) std::abort();
+        });
+        const double dec = time_per_call(opt, [&] {
+          auto r = xor_recover(received, parity);
+          if (r.empty()) std::abort();
+        });
+        json.begin("xor_parity");
+        json.field("kernel", xor_kernel_name(k));
+        json.field("group", static_cast<long long>(g));
+        json.field("packet_bytes", static_cast<long long>(size));
+        json.field("encode_gbps", g * size / enc / 1e9);
+        json.field("encode_pps", g / enc);
+        json.field("decode_gbps", (g - 1) * size / dec / 1e9);
+        json.field("decode_ns", dec * 1e9);
+        json.end();
+      }
+    }
+  }
+  set_xor_kernel(XorKernel::Avx2) || set_xor_kernel(XorKernel::Sse2);
+}
+
+void bench_accumulator(const Options& opt, Json& json) {
+  std::mt19937 rng(2);
+  ParityBufferPool pool(4, 1500);
+  XorParityAccumulator acc(pool);
+  for (std::size_t g : kGroups) {
+    for (std::size_t size : kSizes) {
+      const auto packets = random_packets(rng, g, size);
+      const double t = time_per_call(opt, [&] {
+        acc.begin(0);
+        for (const auto& p : packets) acc.add(p);
+        PooledParity out = acc.finish();
+        if (!out) std::abort();
+      });
+      json.begin("xor_accumulator");
+      json.field("kernel", xor_kernel_name(xor_kernel()));
+      json.field("group", static_cast<long long>(g));
+      json.field("packet_bytes", static_cast<long long>(size));
+      json.field("encode_gbps", g * size / t / 1e9);
+      json.field("encode_pps", g / t);
+      json.end();
+    }
+  }
+}
+
+void bench_rs(const Options& opt, Json& json) {
+  std::mt19937 rng(3);
+  for (GfKernel kernel : {GfKernel::Scalar, GfKernel::Ssse3, GfKernel::Avx2}) {
+    if (!set_gf_kernel(kernel)) continue;
+    for (std::size_t k : kGroups) {
+      const int m = std::max<int>(1, static_cast<int>(k) / 4);
+      for (std::size_t size : kSizes) {
+        RsCodec codec(static_cast<int>(k), m);
+        auto shards = random_packets(rng, k + m, size);
+        const std::vector<std::span<const std::uint8_t>> data(shards.begin(), shards.begin() + k);
+        const std::vector<std::span<std::uint8_t>> parity(shards.begin() + k, shards.end());
+        const std::vector<std::span<std::uint8_t>> all(shards.begin(), shards.end());
+        std::vector<bool> present(k + m, true);
+        for (int i = 0; i < m; ++i) present[i] = false;
+
+        const double enc = time_per_call(opt, [&] { codec.encode(data, parity); });
+        const double dec = time_per_call(opt, [&] { codec.decode(all, present); });
+        json.begin("rs_cauchy");
+        json.field("kernel", gf_kernel_name(kernel));
+        json.field("k", static_cast<long long>(k));
+        json.field("m", static_cast<long long>(m));
+        json.field("packet_bytes", static_cast<long long>(size));
+        json.field("encode_gbps", k * size / enc / 1e9);
+        json.field("decode_gbps", k * size / dec / 1e9);
+        json.field("decode_us", dec * 1e6);
+        json.end();
+      }
+    }
+  }
+  set_gf_kernel(GfKernel::Avx2) || set_gf_kernel(GfKernel::Ssse3);
+}
+
+void bench_rtp_fec(const Options& opt, Json& json) {
+  std::mt19937 rng(4);
+  for (std::size_t g : kGroups) {
+    if (g > kRtpFecMaxMask) continue;
+    for (std::size_t size : kSizes) {
+      std::vector<std::vector<std::uint8_t>> packets;
+      for (std::uint16_t i = 0; i < 256; ++i) packets.push_back(rtp_packet(rng, i, size));
+      RtpFecEncoder enc({127, static_cast<std::uint16_t>(g)});
+      std::vector<std::uint8_t> out;
+      const double t = time_per_call(opt, [&] {
+        for (const auto& p : packets) enc.add(p, out);
+      });
+      json.begin("rtp_fec_encode");
+      json.field("group", static_cast<long long>(g));
+      json.field("packet_bytes", static_cast<long long>(size));
+      json.field("encode_gbps", packets.size() * (size + kRtpHeaderSize) / t / 1e9);
+      json.field("encode_pps", packets.size() / t);
+      json.end();
+    }
+  }
+}
+
+// Recovery runs of the block and sliding codes share these, so their rows
+// compare like for like: one repair packet per `interval` media packets is
+// the same overhead for both, and every run draws media and repair losses
+// from a LossModel with the same seed, in the same order.
+struct LossScenario {
+  const char* name;
+  double p;
+  double burst;
+};
+const LossScenario kLossScenarios[] = {
+    {"random", 0.02, 1.0}, {"random", 0.05, 1.0}, {"burst", 0.02, 3.0}, {"burst", 0.05, 3.0}};
+const std::size_t kRepairIntervals[] = {4, 8, 16};
+constexpr std::uint32_t kLossSeed = 6;
+constexpr std::size_t kRecoveryPackets = 20000;
+
+// Fields common to rtp_fec_recovery and sliding_rlc_recovery rows.
+void recovery_fields(Json& json, const LossScenario& loss, std::size_t interval, std::size_t lost,
+                     std::size_t recovered, std::size_t missing, double mean_latency) {
+  json.field("loss", loss.name);
+  json.field("loss_rate", loss.p);
+  json.field("overhead_pct", 100.0 / static_cast<double>(interval));
+  json.field("lost", static_cast<long long>(lost));
+  json.field("recovered", static_cast<long long>(recovered));
+  json.field("residual_loss", static_cast<double>(missing) / kRecoveryPackets);
+  json.field("mean_recovery_latency_pkts", mean_latency);
+}
+
+// End-to-end recovery through FecStreamDecoder: residual loss and how many
+// packet intervals a repaired packet waited after its original send slot.
+void bench_rtp_recovery(const Options&, Json& json) {
+  for (std::size_t g : kRepairIntervals) {
+    for (const LossScenario& scenario : kLossScenarios) {
+      std::mt19937 rng(5);
+      LossModel loss(scenario.name, scenario.p, scenario.burst, kLossSeed);
+      RtpFecEncoder enc({127, static_cast<std::uint16_t>(g)});
+      FecStreamDecoder dec;
+      const auto t0 = FecStreamDecoder::Clock::time_point{};
+      std::vector<std::uint8_t> fec, out;
+      std::vector<std::size_t> lost_at(65536, 0);
+      std::size_t lost = 0, delivered = 0, latency_sum = 0, repaired = 0;
+      for (std::size_t i = 0; i < kRecoveryPackets; ++i) {
+        const auto now = t0 + std::chrono::milliseconds(i);
+        const auto pkt = rtp_packet(rng, static_cast<std::uint16_t>(i), 1000);
+        if (loss.lost()) {
+          ++lost;
+          lost_at[i & 0xffff] = i + 1;
+        } else {
+          dec.push_media(pkt, now);
+        }
+        if (enc.add(pkt, fec) && !loss.lost()) {
+          const auto before = dec.stats().recovered;
+          dec.push_fec(fec, now);
+          if (dec.stats().recovered > before) {
+            // Repairs triggered by this FEC packet fill holes of its group.
+            for (std::size_t back = 0; back < g && back <= i; ++back) {
+              std::size_t& at = lost_at[(i - back) & 0xffff];
+              if (at != 0) {
+                latency_sum += back;
+                at = 0;
+                ++repaired;
+              }
+            }
+          }
+        }
+        while (dec.pop(out, now)) ++delivered;
+      }
+      while (dec.pop(out, t0 + std::chrono::hours(1))) ++delivered;
+      json.begin("rtp_fec_recovery");
+      json.field("group", static_cast<long long>(g));
+      recovery_fields(json, scenario, g, lost, dec.stats().recovered, kRecoveryPackets - delivered,
+                      repaired ? static_cast<double>(latency_sum) / repaired : 0.0);
+      json.end();
+    }
+  }
+}
+
+void bench_2d(const Options& opt, Json& json) {
+  std::mt19937 rng(7);
+  for (const auto& [cols, rows] : {std::pair{4, 4}, std::pair{8, 4}, std::pair{10, 10}}) {
+    const std::size_t n = static_cast<std::size_t>(cols) * rows;
+    const auto packets = random_packets(rng, n, 1200);
+    const std::vector<std::span<const std::uint8_t>> views(packets.begin(), packets.end());
+    const FecMatrix shape{static_cast<std::uint16_t>(cols), static_cast<std::uint16_t>(rows)};
+    const FecMatrixParity parity = xor_parity_2d(views, shape, 0);
+    const double enc = time_per_call(opt, [&] { xor_parity_2d(views, shape, 0); });
+
+    // Burst of `cols` consecutive losses in the middle of the matrix.
+    std::size_t recovered = 0;
+    const double dec = time_per_call(opt, [&] {
+      auto rx = packets;
+      std::vector<bool> present(n, true);
+      for (int i = 0; i < cols; ++i) present[n / 2 - cols / 2 + i] = false;
+      recovered = xor_recover_2d(rx, present, shape, parity);
+    });
+    json.begin("xor_2d");
+    json.field("columns", static_cast<long long>(cols));
+    json.field("rows", static_cast<long long>(rows));
+    json.field("encode_gbps", n * 1200 / enc / 1e9);
+    json.field("burst_recovered", static_cast<long long>(recovered));
+    json.field("burst_decode_us", dec * 1e6);
+    json.end();
+  }
+}
+
+void bench_sliding(const Options& opt, Json& json) {
+  for (const auto& [window, interval] : {std::pair{10, 5}, std::pair{20, 5}, std::pair{40, 10}}) {
+    SlidingFecConfig cfg;
+    cfg.window = static_cast<std::uint16_t>(window);
+    cfg.repair_interval = static_cast<std::uint16_t>(interval);
+    std::mt19937 rng(8);
+    const auto packets = random_packets(rng, 256, 1000);
+    SlidingWindowEncoder enc(cfg);
+    std::vector<std::uint8_t> repair;
+    std::uint16_t id = 0;
+    const double t = time_per_call(opt, [&] {
+      for (const auto& p : packets) enc.add(id++, p, repair);
+    });
+    json.begin("sliding_rlc_encode");
+    json.field("window", static_cast<long long>(window));
+    json.field("repair_interval", static_cast<long long>(interval));
+    json.field("encode_pps", packets.size() / t);
+    json.field("encode_gbps", packets.size() * 1000 / t / 1e9);
+    json.end();
+  }
+}
+
+// Same intervals, loss and seed as rtp_fec_recovery; a window equal to the
+// interval is the block code, wider windows trade latency for reach.
+void bench_sliding_recovery(const Options&, Json& json) {
+  for (std::size_t interval : kRepairIntervals) {
+    for (std::size_t window : {interval, 2 * interval, 4 * interval}) {
+      for (const LossScenario& scenario : kLossScenarios) {
+        SlidingFecConfig cfg;
+        cfg.window = static_cast<std::uint16_t>(window);
+        cfg.repair_interval = static_cast<std::uint16_t>(interval);
+        std::mt19937 rng(5);
+        const auto packets = random_packets(rng, 256, 1000);
+        LossModel loss(scenario.name, scenario.p, scenario.burst, kLossSeed);
+        SlidingWindowEncoder enc(cfg);
+        SlidingWindowDecoder dec(cfg);
+        std::vector<std::size_t> lost_at(65536, 0);
+        std::size_t lost = 0, latency_sum = 0, repaired = 0;
+        std::vector<std::uint8_t> repair, out;
+        for (std::size_t i = 0; i < kRecoveryPackets; ++i) {
+          const auto& p = packets[i % packets.size()];
+          const auto sid = static_cast<std::uint16_t>(i);
+          if (loss.lost()) {
+            ++lost;
+            lost_at[sid] = i + 1;
+          } else {
+            dec.add_source(sid, p);
+          }
+          if (enc.add(sid, p, repair) && !loss.lost()) dec.add_repair(repair);
+          std::uint16_t rid = 0;
+          while (dec.pop_recovered(rid, out)) {
+            latency_sum += i + 1 - lost_at[rid];
+            ++repaired;
+          }
+        }
+        json.begin("sliding_rlc_recovery");
+        json.field("window", static_cast<long long>(window));
+        json.field("repair_interval", static_cast<long long>(interval));
+        recovery_fields(json, scenario, interval, lost, repaired, lost - repaired,
+                        repaired ? static_cast<double>(latency_sum) / repaired : 0.0);
+        json.end();
+      }
+    }
+  }
+}
+
+// How an H.264 frame's slicing decides what one lost packet costs. Each
+// frame is sent as RFC 6184 packets of its slices: one slice fragmented
+// into FU-A units (x264 default), 4 slices (--low-delay) or slices capped
+// to one packet (--mtu-slices, paying kMtuSliceCost in bitrate). XOR parity
+// follows every 100/fec media packets and repairs one loss in its group.
+// A slice decodes only if all its packets arrive; "decodable" is the share
+// of frame bytes (roughly picture area) in complete slices, "intact" the
+// share of frames with nothing missing. Reference propagation is ignored.
+constexpr double kMtuSliceCost = 0.05;
+const int kFecLevels[] = {0, 5, 10, 15, 20, 25, 30, 40, 50};
+
+struct SlicingMode {
+  const char* name;
+  int slices;  // per frame, 0 = capped to one packet
+};
+const SlicingMode kSlicingModes[] = {{"frame", 1}, {"4-slices", 4}, {"mtu", 0}};
+
+struct DecodabilityResult {
+  double decodable = 0.0;
+  double intact = 0.0;
+  double residual_loss = 0.0;
+  double packets_per_frame = 0.0;
+  double overhead = 0.0;  // parity and slice bytes over the unsliced stream
+};
+
+// Slice NAL sizes of a frame of `bytes` under `mode`.
+std::vector<std::size_t> slice_frame(std::size_t bytes, const SlicingMode& mode) {
+  if (mode.slices > 0) {
+    return std::vector<std::size_t>(static_cast<std::size_t>(mode.slices), bytes / mode.slices);
+  }
+  // x264's size estimate keeps slices a little under the cap on average.
+  const std::size_t cap = h264_slice_max_size(1200) - 4 - 16;
+  const auto sliced = static_cast<std::size_t>(static_cast<double>(bytes) * (1.0 + kMtuSliceCost));
+  const std::size_t n = (sliced + cap - 1) / cap;
+  return std::vector<std::size_t>(n, sliced / n);
+}
+
+DecodabilityResult run_decodability(const SlicingMode& mode, int fec, LossModel& loss, std::size_t frames) {
+  constexpr std::size_t kMtu = 1200;
+  constexpr std::size_t kPFrameBytes = 15000;  // ~4 Mbps at 30 fps
+  constexpr std::size_t kIdrBytes = 80000;
+  constexpr std::size_t kGop = 300;
+  const std::size_t group = fec > 0 ? static_cast<std::size_t>(std::max(1, (100 + fec / 2) / fec)) : 0;
+
+  // Per media packet: frame, slice within the frame.
+  std::vector<std::pair<std::size_t, std::size_t>> owner;
+  std::vector<std::vector<std::size_t>> slice_bytes(frames);
+  std::size_t base_bytes = 0, sent_bytes = 0;
+  for (std::size_t f = 0; f < frames; ++f) {
+    const std::size_t bytes = f % kGop == 0 ? kIdrBytes : kPFrameBytes;
+    base_bytes += bytes;
+    slice_bytes[f] = slice_frame(bytes, mode);
+    for (std::size_t s = 0; s < slice_bytes[f].size(); ++s) {
+      sent_bytes += slice_bytes[f][s];
+      const std::size_t n = h264_packets_for_nal(slice_bytes[f][s], kMtu);
+      for (std::size_t i = 0; i < n; ++i) owner.emplace_back(f, s);
+    }
+  }
+
+  std::vector<bool> received(owner.size());
+  for (std::size_t start = 0; start < owner.size();) {
+    const std::size_t end = group > 0 ? std::min(start + group, owner.size()) : owner.size();
+    std::size_t lost = 0, last_lost = 0;
+    for (std::size_t i = start; i < end; ++i) {
+      received[i] = !loss.lost();
+      if (!received[i]) {
+        ++lost;
+        last_lost = i;
+      }
+    }
+    if (group > 0) {
+      sent_bytes += kMtu;
+      if (!loss.lost() && lost == 1) received[last_lost] = true;
+    }
+    start = end;
+  }
+
+  std::vector<std::vector<bool>> slice_ok(frames);
+  for (std::size_t f = 0; f < frames; ++f) slice_ok[f].assign(slice_bytes[f].size(), true);
+  std::size_t missing = 0;
+  for (std::size_t i = 0; i < owner.size(); ++i) {
+    if (received[i]) continue;
+    ++missing;
+    slice_ok[owner[i].first][owner[i].second] = false;
+  }
+  DecodabilityResult r;
+  for (std::size_t f = 0; f < frames; ++f) {
+    std::size_t total = 0, ok = 0;
+    for (std::size_t s = 0; s < slice_bytes[f].size(); ++s) {
+      total += slice_bytes[f][s];
+      if (slice_ok[f][s]) ok += slice_bytes[f][s];
+    }
+    r.decodable += static_cast<double>(ok) / static_cast<double>(total);
+    r.intact += ok == total ? 1.0 : 0.0;
+  }
+  r.decodable /= static_cast<double>(frames);
+  r.intact /= static_cast<double>(frames);
+  r.residual_loss = static_cast<double>(missing) / static_cast<double>(owner.size());
+  r.packets_per_frame = static_cast<double>(owner.size()) / static_cast<double>(frames);
+  r.overhead = static_cast<double>(sent_bytes) / static_cast<double>(base_bytes) - 1.0;
+  return r;
+}
+
+// Decodable share per slicing mode, FEC level and loss rate, then for each
+// MTU-slice FEC level the least FEC whole-frame slicing needs to match it.
+void bench_decodability(const Options& opt, Json& json) {
+  const std::size_t frames = opt.min_seconds < 0.05 ? 3000 : 12000;
+  for (const auto& [name, burst] : {std::pair{"random", 1.0}, std::pair{"burst", 3.0}}) {
+    for (double p : {0.005, 0.01, 0.02, 0.05, 0.10}) {
+      std::vector<std::vector<DecodabilityResult>> results;
+      for (const SlicingMode& mode : kSlicingModes) {
+        results.emplace_back();
+        for (int fec : kFecLevels) {
+          LossModel loss(name, p, burst, 11);
+          const DecodabilityResult r = run_decodability(mode, fec, loss, frames);
+          results.back().push_back(r);
+          json.begin("frame_decodability");
+          json.field("loss", name);
+          json.field("loss_rate", p);
+          json.field("slicing", mode.name);
+          json.field("fec", static_cast<long long>(fec));
+          json.field("packets_per_frame", r.packets_per_frame);
+          json.field("overhead", r.overhead);
+          json.field("residual_loss", r.residual_loss);
+          json.field("intact_frames", r.intact);
+          json.field("decodable", r.decodable);
+          json.end();
+        }
+      }
+      const auto& whole = results.front();
+      const auto& mtu = results.back();
+      for (std::size_t i = 0; i < mtu.size(); ++i) {
+        json.begin("frame_decodability_fec");
+        json.field("loss", name);
+        json.field("loss_rate", p);
+        json.field("mtu_fec", static_cast<long long>(kFecLevels[i]));
+        json.field("mtu_decodable", mtu[i].decodable);
+        json.field("mtu_overhead", mtu[i].overhead);
+        std::size_t j = 0;
+        while (j < whole.size() && whole[j].decodable < mtu[i].decodable) ++j;
+        if (j < whole.size()) {
+          json.field("frame_fec", static_cast<long long>(kFecLevels[j]));
+          json.field("frame_overhead", whole[j].overhead);
+        } else {
+          json.field("frame_fec", "above 50");
+        }
+        json.end();
+      }
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    if (a == "--quick") {
+      opt.min_seconds = 0.02;
+    } else if (a.rfind("--filter=", 0) == 0) {
+      opt.filter = a.substr(9);
+    } else {
+      std::fprintf(stderr, "Usage: %s [--quick] [--filter=<name substring>]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  Json json;
+  std::printf("{\n  \"xor_kernel\": \"%s\",\n  \"gf_kernel\": \"%s\",\n  \"results\": [",
+              xor_kernel_name(xor_kernel()), gf_kernel_name(gf_kernel()));
+  if (enabled(opt, "xor_parity")) bench_xor(opt, json);
+  if (enabled(opt, "xor_accumulator")) bench_accumulator(opt, json);
+  if (enabled(opt, "xor_2d")) bench_2d(opt, json);
+  if (enabled(opt, "rs_cauchy")) bench_rs(opt, json);
+  if (enabled(opt, "rtp_fec_encode")) bench_rtp_fec(opt, json);
+  if (enabled(opt, "rtp_fec_recovery")) bench_rtp_recovery(opt, json);
+  if (enabled(opt, "sliding_rlc_encode")) bench_sliding(opt, json);
+  if (enabled(opt, "sliding_rlc_recovery")) bench_sliding_recovery(opt, json);
+  if (enabled(opt, "frame_decodability")) bench_decodability(opt, json);
+  std::printf("\n  ]\n}\n");
+  return 0;
+}
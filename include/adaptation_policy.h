@@ -0,0 +1,89 @@
+// Joint bitrate / FEC / resolution adaptation policy (no GStreamer dependency)
+#pragma once
+
+#include "utils.h"
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace ve {
+
+// Lowest bitrate at which a profile still looks better than the next rung
+// down (bits per pixel floor).
+int profile_min_kbps(const VideoProfile& profile);
+
+// Resolution/frame-rate ladder below `top`: 1, 3/4, 1/2 and 3/8 scale at the
+// top frame rate, then the smallest size at half rate. Rung 0 is `top`;
+// bitrates scale with pixel rate^0.75.
+std::vector<VideoProfile> make_profile_ladder(const VideoProfile& top);
+
+struct AdaptationConfig {
+  int fec_start = 20;              // initial redundancy (%); 0 disables FEC adaptation
+  int fec_min = 5;
+  int fec_max = 50;
+  double fec_per_loss_pct = 3.0;   // FEC points per percent of smoothed loss
+  int fec_step = 5;                // smaller FEC changes are ignored
+  int max_kbps = 8000;             // encoder ceiling
+  double up_margin = 1.4;          // step up once the rung above is this far above its floor
+  std::chrono::milliseconds down_hold{2000};
+  std::chrono::milliseconds up_hold{8000};
+  std::chrono::milliseconds cooldown{4000};      // after any resolution switch
+  std::chrono::milliseconds fec_down_hold{5000};
+};
+
+struct AdaptationDecision {
+  int video_kbps = 0;
+  int fec_percentage = 0;
+  std::size_t profile = 0;  // ladder index
+  bool fec_changed = false;
+  bool profile_changed = false;
+};
+
+// Splits a send budget between video and FEC and picks a ladder rung.
+// Redundancy follows smoothed loss (raised at once, lowered after
+// fec_down_hold); the rung steps down after down_hold below its floor and up
+// after up_hold with headroom, one rung at a time, never within cooldown of
+// the previous switch (each switch costs a keyframe).
+class AdaptationPolicy {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  AdaptationPolicy(std::vector<VideoProfile> ladder, AdaptationConfig cfg = {});
+
+  // Fraction lost (0..1) from the latest receiver report.
+  void report_loss(double fraction_lost);
+
+  // While suspended (retransmission covers losses) decisions carry 0% FEC and
+  // the whole budget goes to video; redundancy keeps tracking loss so it
+  // resumes at a current value.
+  void suspend_fec(bool suspended) { fec_suspended_ = suspended; }
+
+  // budget_kbps covers video plus FEC.
+  AdaptationDecision update(double budget_kbps, Clock::time_point now);
+
+  const std::vector<VideoProfile>& ladder() const { return ladder_; }
+  std::size_t profile_index() const { return profile_; }
+  // Redundancy currently on the wire.
+  int fec_percentage() const { return applied_fec_; }
+  int min_kbps() const { return profile_min_kbps(ladder_.back()); }
+
+ private:
+  void update_fec(Clock::time_point now);
+  bool update_profile(double video_kbps, Clock::time_point now);
+
+  std::vector<VideoProfile> ladder_;
+  AdaptationConfig cfg_;
+  double loss_ = 0.0;
+  bool have_loss_ = false;
+  int fec_ = 0;
+  int applied_fec_ = 0;
+  bool fec_suspended_ = false;
+  Clock::time_point fec_low_since_{};
+  std::size_t profile_ = 0;
+  Clock::time_point below_since_{};
+  Clock::time_point above_since_{};
+  Clock::time_point last_switch_{};
+};
+
+}  // namespace ve
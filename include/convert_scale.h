@@ -0,0 +1,109 @@
+// Fused packed-RGB to I420 conversion and bilinear scaling with SIMD kernels and runtime CPU dispatch
+#pragma once
+
+#include "cpu_features.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ve {
+
+class WorkerPool;
+
+using ConvertKernel = SimdLevel;  // Scalar, Sse2, Avx2
+
+// Kernel picked at startup (see KernelDispatch); overridable for benchmarks.
+ConvertKernel convert_kernel();
+bool convert_kernel_supported(ConvertKernel kernel);
+bool set_convert_kernel(ConvertKernel kernel);
+const char* convert_kernel_name(ConvertKernel kernel);
+
+// Limited-range YCbCr matrices.
+enum class YuvMatrix { Bt601, Bt709 };
+
+// 4 bytes per pixel: B, G, R, X (or R, G, B, X with rgb_order).
+struct PackedFrame {
+  const std::uint8_t* data = nullptr;
+  std::size_t stride = 0;
+  int width = 0;
+  int height = 0;
+};
+
+// I420: full-size Y, quarter-size U and V (rounded up for odd sizes).
+struct PlanarFrame {
+  std::uint8_t* planes[3] = {nullptr, nullptr, nullptr};
+  std::size_t strides[3] = {0, 0, 0};
+  int width = 0;
+  int height = 0;
+};
+
+struct ConvertScaleConfig {
+  int src_width = 0;
+  int src_height = 0;
+  int dst_width = 0;
+  int dst_height = 0;
+  bool rgb_order = false;        // RGBx / RGBA input instead of BGRx / BGRA
+  YuvMatrix matrix = YuvMatrix::Bt709;
+  int stripes = 1;               // horizontal bands a frame is split into
+};
+
+// Converts and resamples in one pass over the source: each output row pair is
+// built from at most a few horizontally resampled source rows held in small
+// per-stripe buffers, then colour-converted straight into the Y, U and V
+// planes, so no full-size intermediate frame is written or read back.
+// Resampling is bilinear (videoscale's default); chroma is the rounded
+// average of each 2x2 block. Output is bit-identical across kernels.
+class FusedConvertScale {
+ public:
+  explicit FusedConvertScale(ConvertScaleConfig cfg);
+
+  // Whole frame; stripes run on `pool` (and the caller) when given. False
+  // if the frames do not match the configured sizes.
+  bool process(const PackedFrame& src, const PlanarFrame& dst, WorkerPool* pool = nullptr);
+
+  // Output rows [row_begin, row_end) (even row_begin) using stripe scratch
+  // `slot`; stripes with different slots may run concurrently.
+  void process_rows(const PackedFrame& src, const PlanarFrame& dst, int row_begin, int row_end, int slot);
+
+  // Bilinear resampling alone, into packed rows of `dst` (dst_width x
+  // dst_height): what a separate scaling pass does. For comparisons.
+  bool resample(const PackedFrame& src, std::uint8_t* dst, std::size_t dst_stride);
+
+  const ConvertScaleConfig& config() const { return cfg_; }
+
+  // Frame memory read plus written per frame: the source once, the planes
+  // once. Small per-row buffers stay in cache and are not counted.
+  std::size_t bytes_per_frame() const;
+
+ private:
+  struct RowTap {
+    int y0;
+    int y1;
+    int w;             // weight of the lower row, 0..128
+  };
+  struct Scratch {
+    std::vector<std::uint8_t> hrows[2];  // horizontally resampled source rows
+    int hrow_index[2] = {-1, -1};
+    std::vector<std::uint8_t> out[2];    // final rows of the current pair
+  };
+
+  const std::uint8_t* source_row(const PackedFrame& src, int y, Scratch& s);
+  // Row y of the resampled frame; blended into `out` unless it is a plain
+  // source row.
+  const std::uint8_t* output_row(const PackedFrame& src, int y, Scratch& s, std::uint8_t* out);
+
+  ConvertScaleConfig cfg_;
+  // Horizontal taps: byte offsets of the left and right source pixels and,
+  // per output pixel, (128 - w, w) repeated for the four channels. w stays
+  // in 1..127 (a whole pixel is x1 == x0, w = 64) so weights fit int8.
+  std::vector<std::int32_t> hx0_;
+  std::vector<std::int32_t> hx1_;
+  std::vector<std::int8_t> hweights_;
+  std::vector<RowTap> vtaps_;
+  bool hidentity_ = false;
+  std::int16_t coeffs_[3][4] = {};  // Y, U, V weights in pixel byte order
+  std::vector<Scratch> scratch_;
+};
+
+}  // namespace ve
@@ -0,0 +1,14 @@
+// GStreamer element wrapping FusedConvertScale: packed RGB in, scaled I420 out, striped across worker threads
+#pragma once
+
+namespace ve {
+
+// Factory name the element is registered under.
+constexpr const char* kConvertScaleElement = "veconvertscale";
+
+// Registers the element with GStreamer (idempotent; call after gst_init).
+// Returns false if registration failed, in which case the planner should fall
+// back to videoscale + videoconvert.
+bool register_convert_scale_element();
+
+}  // namespace ve
@@ -0,0 +1,63 @@
+// Runtime CPU feature checks and the kernel-table dispatch shared by the SIMD modules
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace ve {
+
+enum class SimdLevel { Scalar = 0, Sse2, Ssse3, Avx2 };
+
+// Whether this build and the running CPU can execute code for `level`.
+bool cpu_supports(SimdLevel level);
+const char* simd_level_name(SimdLevel level);
+
+template <typename Table>
+struct KernelEntry {
+  SimdLevel level;
+  Table table;
+};
+
+// A module's kernels, one entry per level it implements, best first and
+// ending with the portable one. The best entry the CPU supports is active
+// from construction; select() overrides it (benchmarks / verification).
+template <typename Table>
+class KernelDispatch {
+ public:
+  template <std::size_t N>
+  explicit KernelDispatch(const KernelEntry<Table> (&entries)[N])
+      : entries_(entries), count_(N), active_(best()) {}
+
+  const Table& table() const { return active_.load(std::memory_order_relaxed)->table; }
+  SimdLevel level() const { return active_.load(std::memory_order_relaxed)->level; }
+  bool supports(SimdLevel level) const { return find(level) != nullptr; }
+
+  // Returns false, keeping the current kernels, if `level` is not available.
+  bool select(SimdLevel level) {
+    const KernelEntry<Table>* entry = find(level);
+    if (!entry) return false;
+    active_.store(entry, std::memory_order_relaxed);
+    return true;
+  }
+
+ private:
+  const KernelEntry<Table>* find(SimdLevel level) const {
+    for (std::size_t i = 0; i < count_; ++i) {
+      if (entries_[i].level == level) return cpu_supports(level) ? &entries_[i] : nullptr;
+    }
+    return nullptr;
+  }
+
+  const KernelEntry<Table>* best() const {
+    for (std::size_t i = 0; i + 1 < count_; ++i) {
+      if (cpu_supports(entries_[i].level)) return &entries_[i];
+    }
+    return &entries_[count_ - 1];
+  }
+
+  const KernelEntry<Table>* entries_;
+  std::size_t count_;
+  std::atomic<const KernelEntry<Table>*> active_;
+};
+
+}  // namespace ve
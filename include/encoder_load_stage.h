@@ -0,0 +1,63 @@
+// Encoder load monitoring: queue drops and per-frame encode time driving the CPU ladder
+#pragma once
+
+#include "overload_detector.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+// Forward declare GStreamer types to avoid hard dependency in header
+typedef struct _GstElement GstElement;
+typedef struct _GstPad GstPad;
+
+namespace ve {
+
+// The leaky queue in front of x264enc drops raw frames without telling
+// anyone when the encoder falls behind. This stage counts those drops
+// ("overrun"), times every frame between the encoder's sink and src pads,
+// and once a second feeds the window to an OverloadDetector on the main
+// loop; level changes are reported through the callback.
+class EncoderLoadStage {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using LevelCallback = std::function<void(const CpuLevel&)>;
+
+  EncoderLoadStage();
+  ~EncoderLoadStage();
+
+  bool attach(GstElement* queue, GstElement* encoder, const OverloadConfig& cfg, LevelCallback on_level);
+  void detach();
+
+  // The queue is full and about to drop its oldest frame (upstream thread).
+  void on_overrun();
+  // A raw frame enters / an encoded frame leaves the encoder (streaming thread).
+  void on_encoder_input(std::uint64_t pts);
+  void on_encoder_output(std::uint64_t pts);
+  // Closes the measurement window (main loop). Returns false to stop the timer.
+  bool on_tick();
+
+ private:
+  std::mutex mtx_;
+  OverloadDetector detector_;
+  LevelCallback on_level_;
+  GstElement* queue_ = nullptr;
+  GstPad* sink_pad_ = nullptr;
+  GstPad* src_pad_ = nullptr;
+  unsigned long overrun_id_ = 0;
+  unsigned long input_probe_id_ = 0;
+  unsigned long output_probe_id_ = 0;
+  unsigned int timer_id_ = 0;
+
+  std::deque<std::pair<std::uint64_t, Clock::time_point>> in_flight_;  // pts, entry time
+  Clock::time_point window_start_{};
+  LoadSample sample_;
+  double max_encode_ms_ = 0.0;
+  std::uint64_t total_dropped_ = 0;
+  std::uint64_t switches_ = 0;
+};
+
+}  // namespace ve
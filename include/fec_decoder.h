@@ -0,0 +1,90 @@
+// Receiver-side streaming XOR FEC decoder with a sequence-number reorder window
+#pragma once
+
+#include "rtp_fec.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+namespace ve {
+
+struct FecDecoderConfig {
+  std::uint16_t window = 256;             // reorder window in packets (power of two)
+  std::chrono::milliseconds hold{20};     // max time a hole may block in-order release
+  std::size_t max_fec_packets = 64;       // pending parity packets kept for repair
+};
+
+struct FecDecoderStats {
+  std::uint64_t received = 0;    // media packets accepted
+  std::uint64_t recovered = 0;   // media packets rebuilt from parity
+  std::uint64_t lost = 0;        // holes skipped at release time
+  std::uint64_t late = 0;        // media packets behind the release point
+  std::uint64_t duplicates = 0;
+};
+
+// Accepts RTP media and RFC 5109 parity packets one at a time, in any order.
+// Packets live in a ring buffer indexed by sequence number; a hole is repaired
+// as soon as some parity packet covers it and all its other packets arrived.
+// pop() releases packets in sequence order and gives up on a hole once the
+// packet after it has waited `hold`.
+class FecStreamDecoder {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit FecStreamDecoder(FecDecoderConfig cfg = {});
+
+  void push_media(std::span<const std::uint8_t> rtp, Clock::time_point now);
+  void push_fec(std::span<const std::uint8_t> fec, Clock::time_point now);
+
+  // Copies the next in-order packet into out. Returns false if the next
+  // packet is still missing and its deadline has not passed.
+  bool pop(std::vector<std::uint8_t>& out, Clock::time_point now);
+
+  // When pop() will next make progress on a blocked hole, if one is pending.
+  bool next_deadline(Clock::time_point& out) const;
+
+  const FecDecoderStats& stats() const { return stats_; }
+
+ private:
+  struct Slot {
+    std::vector<std::uint8_t> data;
+    Clock::time_point arrival{};
+    std::uint16_t seq = 0;
+    bool present = false;
+  };
+
+  struct PendingFec {
+    std::vector<std::uint8_t> data;
+    RtpFecHeader header;  // payload views into data
+  };
+
+  enum class Repair { Pending, Repaired, Done };
+
+  Slot& slot(std::uint16_t seq) { return slots_[seq & mask_]; }
+  const Slot& slot(std::uint16_t seq) const { return slots_[seq & mask_]; }
+  bool has(std::uint16_t seq) const;
+  void store(std::uint16_t seq, std::span<const std::uint8_t> data, Clock::time_point now);
+  void advance_to(std::uint16_t seq);
+  Repair try_repair(const PendingFec& fec, Clock::time_point now);
+  // Runs repair passes until nothing changes; the first pass only looks at
+  // parity covering `trigger`, since only those can have become solvable.
+  void repair_from(std::uint16_t trigger, Clock::time_point now);
+  const Slot* first_after_head() const;
+
+  FecDecoderConfig cfg_;
+  std::vector<Slot> slots_;
+  std::uint16_t mask_ = 0;
+  std::uint16_t head_ = 0;     // next sequence number to release
+  std::uint16_t highest_ = 0;  // highest sequence number seen
+  bool started_ = false;
+  std::deque<PendingFec> fec_;
+  std::deque<std::vector<std::uint8_t>> overflow_;  // forced out by window overrun
+  std::vector<std::span<const std::uint8_t>> scratch_;
+  FecDecoderStats stats_;
+};
+
+}  // namespace ve
@@ -0,0 +1,47 @@
+// In-pipeline XOR FEC stage: taps payloader output and sends RFC 5109 parity
+#pragma once
+
+#include "rtp_fec.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+// Forward declare GStreamer types to avoid hard dependency in header
+typedef struct _GstElement GstElement;
+typedef struct _GstPad GstPad;
+
+namespace ve {
+
+class XorFecStage {
+ public:
+  XorFecStage();
+  ~XorFecStage();
+
+  // Installs a buffer probe on pay's src pad; parity packets are pushed into
+  // fec_src (an appsrc linked to the FEC udpsink). Per-class percentages in
+  // cfg enable unequal protection of IDR / parameter-set packets.
+  bool attach(GstElement* pay, GstElement* fec_src, const UepFecConfig& cfg);
+  void detach();
+
+  // Retunes non-IDR redundancy; takes effect at the next group boundary.
+  void set_percentage(int percentage);
+  // Retunes the non-IDR interleave depth; open columns are flushed first.
+  void set_interleave(int depth);
+
+  // Feeds one outgoing media packet (called from the streaming thread).
+  void on_media_packet(std::span<const std::uint8_t> rtp);
+
+ private:
+  void push_parity(std::span<const std::uint8_t> fec);
+
+  std::unique_ptr<UepFecEncoder> encoder_;
+  std::atomic<int> percentage_{0};
+  std::atomic<int> interleave_{1};
+  GstElement* fec_src_ = nullptr;
+  GstPad* pad_ = nullptr;
+  unsigned long probe_id_ = 0;
+};
+
+}  // namespace ve
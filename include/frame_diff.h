@@ -0,0 +1,112 @@
+// Block-hash change detection between consecutive raw frames, with SIMD kernels and runtime CPU dispatch
+#pragma once
+
+#include "cpu_features.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ve {
+
+using HashKernel = SimdLevel;  // Scalar, Sse2, Avx2
+
+// Kernel picked at startup (see KernelDispatch); overridable for benchmarks.
+HashKernel hash_kernel();
+bool hash_kernel_supported(HashKernel kernel);
+bool set_hash_kernel(HashKernel kernel);
+const char* hash_kernel_name(HashKernel kernel);
+
+// 64-bit hash of `rows` rows of `row_bytes` bytes. Four multiply-accumulate
+// lanes over 8-byte words with position-dependent keys, so moved content
+// hashes differently; identical across kernels. Not cryptographic.
+std::uint64_t hash_rows(const std::uint8_t* data, std::size_t stride, std::size_t row_bytes, int rows);
+
+// One plane of a raw frame: `row_bytes` of pixel data per row, padding excluded.
+struct PlaneView {
+  const std::uint8_t* data = nullptr;
+  std::size_t stride = 0;
+  std::size_t row_bytes = 0;
+  int rows = 0;
+};
+
+// Splits every plane into blocks and remembers their hashes, so each frame
+// is compared with the previous one by reading it once; no copy of the
+// previous frame is kept.
+class BlockChangeDetector {
+ public:
+  // Blocks are block_bytes wide (64 BGRx pixels by default) and block_rows tall.
+  explicit BlockChangeDetector(std::size_t block_bytes = 256, int block_rows = 16);
+
+  // Hashes `frame` and returns how many blocks differ from the previous
+  // frame. The first frame, or one with a different layout, counts as
+  // entirely changed.
+  int update(const std::vector<PlaneView>& frame);
+
+  // Blocks per frame in the current layout.
+  int blocks() const { return static_cast<int>(hashes_.size()); }
+  void reset();
+
+ private:
+  std::size_t block_bytes_;
+  int block_rows_;
+  std::vector<PlaneView> layout_;  // data pointers unused, sizes only
+  std::vector<std::uint64_t> hashes_;
+};
+
+struct StaticContentConfig {
+  // Longest gap between forwarded frames while nothing changes, so
+  // receivers and their jitter buffers keep seeing the stream.
+  std::chrono::milliseconds refresh{1000};
+  // Unchanged frames still forwarded after the last change: the encoder
+  // sharpens a freshly changed picture over the next few frames.
+  int settle_frames = 3;
+  // Longest wall time between keyframes once frames have been skipped; the
+  // encoder's keyframe interval counts encoded frames and stalls while
+  // nothing is forwarded. Zero leaves keyframes to the encoder.
+  std::chrono::milliseconds keyframe_interval{0};
+};
+
+// Decides per frame whether it reaches the encoder: changed frames always
+// do, unchanged ones only while settling, at refresh time or when a
+// keyframe is wanted. Time is passed in. Also tracks keyframes and asks
+// for one when skipping has stretched the encoder's interval past
+// keyframe_interval.
+class StaticFrameGate {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit StaticFrameGate(StaticContentConfig cfg = {});
+
+  // True: forward the frame.
+  bool admit(bool changed, Clock::time_point now);
+  // Lets the next frame through whatever it holds (keyframe requests).
+  void force_next() { force_ = true; }
+  // A keyframe left the encoder, or one was requested on its behalf.
+  void keyframe(Clock::time_point now);
+  // True once after admit() let a frame through that must be a keyframe.
+  bool take_key_unit();
+
+  std::uint64_t frames() const { return frames_; }
+  std::uint64_t skipped() const { return skipped_; }
+  std::uint64_t refreshes() const { return refreshes_; }
+  std::uint64_t forced_keyframes() const { return forced_keyframes_; }
+
+ private:
+  StaticContentConfig cfg_;
+  Clock::time_point last_forwarded_{};
+  bool have_forwarded_ = false;
+  int settle_left_ = 0;
+  bool force_ = false;
+  Clock::time_point last_keyframe_{};
+  bool have_keyframe_ = false;
+  bool skipped_since_keyframe_ = false;
+  bool key_due_ = false;
+  std::uint64_t frames_ = 0;
+  std::uint64_t skipped_ = 0;
+  std::uint64_t refreshes_ = 0;
+  std::uint64_t forced_keyframes_ = 0;
+};
+
+}  // namespace ve
@@ -0,0 +1,74 @@
+// Per-frame capture-to-send latency: time to the first and last RTP packet of each frame (no GStreamer dependency)
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace ve {
+
+// Latency percentiles over one reporting window, in milliseconds.
+struct LatencySummary {
+  int frames = 0;            // frames whose last packet was sent in the window
+  int incomplete = 0;        // frames given up on before their last packet
+  double first_p50 = 0.0;    // capture -> first RTP packet
+  double first_p95 = 0.0;
+  double first_max = 0.0;
+  double last_p50 = 0.0;     // capture -> last RTP packet (whole frame on the wire)
+  double last_p95 = 0.0;
+  double interval_p50 = 0.0; // capture-to-capture, the frame time the latencies compare to
+};
+
+// Follows every frame from its capture time to the packets the payloader
+// sends for it, matched by PTS (encoder, parser and payloader keep it).
+// With `streams` > 1 (tiled encoding) a frame is done once that many
+// marker packets went out.
+class FrameLatencyTracker {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit FrameLatencyTracker(int streams = 1);
+
+  // An encoded frame captured at `captured` leaves the encoder; repeats for
+  // the same pts (other strips) are ignored.
+  void on_encoded(std::uint64_t pts, Clock::time_point captured);
+  // An RTP packet of frame `pts` was sent; `marker` ends the frame's stream.
+  void on_packet(std::uint64_t pts, bool marker, Clock::time_point now);
+
+  // Summary of the frames finished since the last call; starts a new window.
+  LatencySummary take_window();
+  // Since construction.
+  std::uint64_t total_frames() const { return total_frames_; }
+  std::uint64_t total_incomplete() const { return total_incomplete_; }
+  double mean_first_ms() const { return total_frames_ > 0 ? total_first_ms_ / total_frames_ : 0.0; }
+  double mean_last_ms() const { return total_frames_ > 0 ? total_last_ms_ / total_frames_ : 0.0; }
+
+ private:
+  struct Frame {
+    std::uint64_t pts = 0;
+    Clock::time_point captured{};
+    Clock::time_point first{};
+    bool sent = false;  // first packet seen
+    int markers = 0;
+  };
+
+  void finish(const Frame& frame, Clock::time_point last);
+
+  int streams_;
+  std::deque<Frame> pending_;
+  std::vector<double> first_ms_;
+  std::vector<double> last_ms_;
+  std::vector<double> interval_ms_;
+  Clock::time_point last_capture_{};
+  bool have_capture_ = false;
+  int incomplete_ = 0;
+
+  std::uint64_t total_frames_ = 0;
+  std::uint64_t total_incomplete_ = 0;
+  double total_first_ms_ = 0.0;
+  double total_last_ms_ = 0.0;
+};
+
+}  // namespace ve
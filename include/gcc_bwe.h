@@ -0,0 +1,139 @@
+// Delay-based bandwidth estimation (GCC: trendline filter, adaptive overuse detector, AIMD)
+#pragma once
+
+#include "twcc.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace ve {
+
+enum class BandwidthUsage { Normal, Underusing, Overusing };
+
+const char* bandwidth_usage_name(BandwidthUsage usage);
+
+struct GccConfig {
+  int start_kbps = 4000;
+  int min_kbps = 300;
+  int max_kbps = 8000;
+  std::size_t trendline_window = 20;  // packet groups in the regression
+  double smoothing = 0.9;             // accumulated-delay EWMA coefficient
+  double threshold_gain = 4.0;
+};
+
+// Least-squares slope of the smoothed one-way delay variation over the last
+// N packet groups, compared against a threshold that adapts to the trend's
+// own magnitude so competing TCP flows do not starve us.
+class TrendlineEstimator {
+ public:
+  explicit TrendlineEstimator(const GccConfig& cfg);
+
+  // One inter-group delta; times in ms. Returns the new detector state.
+  BandwidthUsage update(double recv_delta_ms, double send_delta_ms, double arrival_ms);
+
+  BandwidthUsage state() const { return state_; }
+  double threshold() const { return threshold_; }
+  double modified_trend() const { return prev_modified_trend_; }
+
+ private:
+  void detect(double trend, double send_delta_ms, double now_ms);
+  void update_threshold(double modified_trend, double now_ms);
+
+  std::size_t window_;
+  double smoothing_;
+  double threshold_gain_;
+  int num_deltas_ = 0;
+  double first_arrival_ms_ = -1.0;
+  double accumulated_delay_ = 0.0;
+  double smoothed_delay_ = 0.0;
+  std::deque<std::pair<double, double>> history_;  // (arrival ms, smoothed delay ms)
+
+  double threshold_ = 12.5;
+  double last_threshold_update_ms_ = -1.0;
+  double time_over_using_ = -1.0;
+  int overuse_counter_ = 0;
+  double prev_trend_ = 0.0;
+  double prev_modified_trend_ = 0.0;
+  BandwidthUsage state_ = BandwidthUsage::Normal;
+};
+
+// Additive-increase / multiplicative-decrease on the detector output:
+// overuse cuts to 85% of the measured delivery rate, normal grows 8%/s far
+// from the last congestion point and roughly one packet per RTT near it.
+class AimdRateControl {
+ public:
+  explicit AimdRateControl(const GccConfig& cfg);
+
+  // acked_kbps <= 0 if unknown. Returns the new target in kbps.
+  int update(BandwidthUsage usage, double acked_kbps, double rtt_ms, double now_ms);
+
+  int target_kbps() const { return static_cast<int>(target_kbps_); }
+  void set_target_kbps(int kbps);
+
+ private:
+  enum class State { Hold, Increase, Decrease };
+
+  void update_max_estimate(double acked_kbps);
+
+  double min_kbps_;
+  double max_kbps_;
+  double target_kbps_;
+  State state_ = State::Hold;
+  double last_update_ms_ = -1.0;
+  double last_decrease_ms_ = -1.0;
+  double avg_max_kbps_ = -1.0;  // delivery rate at recent overuse
+  double var_max_kbps_ = 0.4;   // normalised variance of avg_max_kbps_
+};
+
+// Transport-wide feedback in, target bitrate out. Packets are grouped into
+// 5 ms send bursts; each pair of consecutive groups gives one delay-gradient
+// sample for the trendline.
+class DelayBasedBwe {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit DelayBasedBwe(GccConfig cfg = {});
+
+  // Feeds the packets of one feedback message (send order). Returns true if
+  // the target changed.
+  bool on_feedback(std::span<const PacketResult> packets, Clock::time_point now);
+
+  void set_rtt(double rtt_ms) { rtt_ms_ = rtt_ms; }
+  void set_target_kbps(int kbps) { rate_.set_target_kbps(kbps); }
+
+  int target_kbps() const { return rate_.target_kbps(); }
+  double acked_kbps() const { return acked_kbps_; }
+  BandwidthUsage state() const { return trend_.state(); }
+
+ private:
+  struct Group {
+    Clock::time_point first_send{};
+    Clock::time_point last_send{};
+    std::chrono::microseconds first_arrival{0};
+    std::chrono::microseconds last_arrival{0};
+    bool valid = false;
+  };
+
+  void add_packet(const PacketResult& p);
+  void update_acked(const PacketResult& p);
+
+  GccConfig cfg_;
+  TrendlineEstimator trend_;
+  AimdRateControl rate_;
+  Group current_;
+  Group previous_;
+  std::deque<std::pair<std::chrono::microseconds, std::size_t>> acked_;  // (arrival, bytes)
+  std::size_t acked_bytes_ = 0;
+  double acked_kbps_ = 0.0;
+  double rtt_ms_ = 100.0;
+  Clock::time_point epoch_{};
+  bool started_ = false;
+  bool overuse_seen_ = false;
+};
+
+}  // namespace ve
@@ -0,0 +1,32 @@
+// GF(2^8) arithmetic: log/exp tables plus PSHUFB split-nibble region kernels
+#pragma once
+
+#include "cpu_features.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ve {
+
+using GfKernel = SimdLevel;  // Scalar, Ssse3, Avx2
+
+// Field with reducing polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11d).
+std::uint8_t gf_mul(std::uint8_t a, std::uint8_t b);
+std::uint8_t gf_div(std::uint8_t a, std::uint8_t b);  // b != 0
+std::uint8_t gf_inv(std::uint8_t a);                  // a != 0
+std::uint8_t gf_exp(unsigned int power);
+
+// dst[i] = c * src[i]
+void gf_mul_region(std::uint8_t* dst, const std::uint8_t* src, std::uint8_t c, std::size_t len);
+
+// dst[i] ^= c * src[i]
+void gf_mul_add_region(std::uint8_t* dst, const std::uint8_t* src, std::uint8_t c,
+                       std::size_t len);
+
+// Kernel picked at startup (see KernelDispatch); overridable for benchmarks.
+GfKernel gf_kernel();
+bool gf_kernel_supported(GfKernel kernel);
+bool set_gf_kernel(GfKernel kernel);
+const char* gf_kernel_name(GfKernel kernel);
+
+}  // namespace ve
@@ -0,0 +1,50 @@
+// H.264 NAL unit classification and packetization sizes for RTP payloads (RFC 6184)
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace ve {
+
+enum class H264NalType : std::uint8_t {
+  NonIdrSlice = 1,
+  IdrSlice = 5,
+  Sei = 6,
+  Sps = 7,
+  Pps = 8,
+  Aud = 9,
+  StapA = 24,
+  FuA = 28,
+};
+
+// Loss impact class, lowest to highest.
+enum class H264Priority : std::uint8_t { NonIdr = 0, Idr, ParameterSet };
+constexpr int kH264PriorityCount = 3;
+
+// NAL type carried by an H.264 RTP payload; for FU-A the fragmented unit's
+// type is returned, for STAP-A the first aggregated unit's. -1 if empty.
+int h264_payload_nal_type(std::span<const std::uint8_t> payload);
+
+// Priority of an H.264 RTP payload. Aggregation packets take the highest
+// priority of the units they carry.
+H264Priority h264_payload_priority(std::span<const std::uint8_t> payload);
+
+const char* h264_priority_name(H264Priority priority);
+
+// Room kept in every RTP packet for header extensions (transport-wide
+// sequence number: 4-byte extension header plus one padded element).
+constexpr std::size_t kRtpExtensionReserve = 8;
+
+// RTP packets of at most `mtu` bytes a NAL unit of `nal_bytes` (NAL header
+// included, no start code) is sent in: one single-NAL packet when it fits,
+// otherwise FU-A fragments, which carry 2 bytes of FU indicator and header
+// in place of the 1-byte NAL header. Losing any fragment loses the unit.
+std::size_t h264_packets_for_nal(std::size_t nal_bytes, std::size_t mtu);
+
+// x264 `slice-max-size` that keeps each slice within one single-NAL packet
+// of `mtu` bytes. x264 counts the 4-byte start code the payload drops; a
+// further 16 bytes cover its size estimate (emulation prevention bytes).
+std::size_t h264_slice_max_size(std::size_t mtu);
+
+}  // namespace ve
@@ -0,0 +1,40 @@
+// Coalesces receiver keyframe requests (PLI/FIR) into rate-limited encoder IDRs
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace ve {
+
+// Every IDR is several times the size of a P-frame, and after a burst loss
+// each receiver (and each lost packet) can trigger its own PLI. At most one
+// keyframe is forced per min_interval; requests inside the interval are
+// folded into a single keyframe issued when it expires, so the last
+// requester is never left waiting for the next periodic IDR.
+class KeyframeLimiter {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit KeyframeLimiter(std::chrono::milliseconds min_interval = std::chrono::milliseconds(500));
+
+  // A keyframe was requested. True: force one now. False: coalesced.
+  bool request(Clock::time_point now);
+
+  // True once when a coalesced request is due (call per encoded frame).
+  bool poll(Clock::time_point now);
+
+  std::uint64_t requests() const { return requests_; }
+  std::uint64_t forced() const { return forced_; }
+
+ private:
+  bool due(Clock::time_point now) const;
+
+  std::chrono::milliseconds min_interval_;
+  Clock::time_point last_forced_{};
+  bool have_forced_ = false;
+  bool pending_ = false;
+  std::uint64_t requests_ = 0;
+  std::uint64_t forced_ = 0;
+};
+
+}  // namespace ve
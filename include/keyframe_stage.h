@@ -0,0 +1,54 @@
+// Rate-limited keyframe requests: PLI/FIR-driven force-key-unit events into the encoder
+#pragma once
+
+#include "keyframe_limiter.h"
+
+#include <chrono>
+#include <mutex>
+
+// Forward declare GStreamer types to avoid hard dependency in header
+typedef struct _GstElement GstElement;
+typedef struct _GstPad GstPad;
+
+namespace ve {
+
+// rtpbin's session turns incoming PLI and FIR into upstream force-key-unit
+// events. This stage intercepts them on the encoder's src pad and lets
+// KeyframeLimiter decide: forwarded at once, or dropped and re-issued as a
+// single event before the first frame after the interval.
+//
+// With tiled encoding the requests arrive on the funnel merging the strips
+// instead. They are all dropped there and re-issued as one downstream
+// force-key-unit into the tee, so every strip's encoder keys on the same
+// frame.
+class KeyframeStage {
+ public:
+  KeyframeStage();
+  ~KeyframeStage();
+
+  bool attach(GstElement* encoder, std::chrono::milliseconds min_interval);
+  // Tiled encoding: frames enter `tee`, requests arrive on `funnel`'s src pad.
+  bool attach_strips(GstElement* tee, GstElement* funnel, std::chrono::milliseconds min_interval);
+  void detach();
+
+  // A force-key-unit event reached the encoder (upstream event thread).
+  // Returns false to drop it.
+  bool on_key_unit_request();
+
+  // A raw frame is about to enter the encoder(s) (streaming thread).
+  void on_frame();
+
+ private:
+  bool attach_pads(GstPad* src_pad, GstPad* sink_pad, std::chrono::milliseconds min_interval);
+
+  std::mutex mtx_;
+  KeyframeLimiter limiter_;
+  GstPad* src_pad_ = nullptr;
+  GstPad* sink_pad_ = nullptr;
+  unsigned long event_probe_id_ = 0;
+  unsigned long buffer_probe_id_ = 0;
+  bool strips_ = false;
+  bool pending_ = false;  // strips: a forwarded request waits for the next frame
+};
+
+}  // namespace ve
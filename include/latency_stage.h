@@ -0,0 +1,57 @@
+// Capture-to-first-packet latency probes: capture time stamped at the source, matched at the payloader output
+#pragma once
+
+#include "frame_latency.h"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Forward declare GStreamer types to avoid hard dependency in header
+typedef struct _GstElement GstElement;
+typedef struct _GstPad GstPad;
+typedef struct _GstBuffer GstBuffer;
+
+namespace ve {
+
+// Stamps every raw frame with its capture time (a reference timestamp meta
+// on the source's src pad; conversion, videorate and the encoder carry it
+// along), reads it back from each encoded frame on the encoder src pads,
+// and times the payloader's packets for that PTS. Every few seconds the
+// main loop logs capture -> first packet and capture -> last packet.
+class LatencyStage {
+ public:
+  using Clock = FrameLatencyTracker::Clock;
+
+  LatencyStage();
+  ~LatencyStage();
+
+  // One encoder per RTP stream behind `pay` (several when tiled, pay being
+  // the funnel that merges them).
+  bool attach(GstElement* source, const std::vector<GstElement*>& encoders, GstElement* pay,
+              unsigned int report_seconds = 10);
+  void detach();
+
+  // A raw frame leaves the source (streaming thread); stamps it.
+  void on_capture(GstBuffer* buffer);
+  // An encoded frame leaves an encoder (streaming thread).
+  void on_encoded(GstBuffer* buffer, GstElement* encoder);
+  // An RTP packet leaves the payloader (streaming thread).
+  void on_packet(GstBuffer* buffer);
+  // Logs the window (main loop). Returns false to stop the timer.
+  bool on_tick();
+
+ private:
+  std::mutex mtx_;
+  FrameLatencyTracker tracker_;
+  GstPad* source_pad_ = nullptr;
+  GstPad* pay_pad_ = nullptr;
+  std::vector<GstPad*> encoder_pads_;
+  std::vector<unsigned long> encoder_probe_ids_;
+  unsigned long source_probe_id_ = 0;
+  unsigned long pay_probe_id_ = 0;
+  unsigned int timer_id_ = 0;
+  std::uint64_t unstamped_ = 0;  // encoded frames that lost the capture meta
+};
+
+}  // namespace ve
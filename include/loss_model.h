@@ -0,0 +1,134 @@
+// Two-state (Gilbert-Elliott) loss model fitted to per-packet loss traces, and XOR FEC layout choice (no GStreamer dependency)
+#pragma once
+
+#include "rtcp_xr.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace ve {
+
+// Runs of consecutive losses by length 1..15; the last bin holds 16 or more.
+constexpr std::size_t kLossRunBins = 16;
+
+// Gap and burst states in the RFC 3611 VoIP-metrics sense: a burst is a
+// stretch in which losses are fewer than gmin received packets apart,
+// everything else is gap. Each state loses packets at its own rate.
+struct GilbertElliottParams {
+  double p = 0.0;           // gap -> burst, per packet
+  double r = 1.0;           // burst -> gap, per packet
+  double gap_loss = 0.0;    // loss probability in the gap state
+  double burst_loss = 0.0;  // loss probability in the burst state
+
+  double loss_rate() const;  // stationary
+  double mean_burst() const { return r > 0.0 ? 1.0 / r : 0.0; }  // packets
+};
+
+// gmin is 2 rather than the VoIP-metrics 16: the model drives FEC
+// decisions, where only losses a few packets apart matter, and with 16 even
+// 3% random loss reads as bursts.
+struct LossModelConfig {
+  int gmin = 2;
+  double window = 5000.0;  // packets; counts halve once they reach twice this
+  // Likelihood ratio (chi-squared, 1 degree of freedom) the loss runs must
+  // reach before they count as bursty; 10.83 is p < 0.001.
+  double burst_significance = 10.83;
+};
+
+// Fits GilbertElliottParams incrementally from received/lost flags in
+// sequence order. Packets within gmin of the last loss stay unclassified
+// until the burst they may belong to is closed.
+class GilbertElliottEstimator {
+ public:
+  explicit GilbertElliottEstimator(LossModelConfig cfg = {});
+
+  void add(bool received);
+  void add(const std::vector<bool>& received);
+
+  GilbertElliottParams params() const;
+  // True if losses follow losses more often than independent loss at the
+  // same rate explains. The two-state fit finds a "burst" state even in
+  // i.i.d. loss; only a significant excess is worth interleaving for.
+  bool bursty() const;
+  // Classified packets and losses (decayed with the model).
+  double packets() const { return gap_packets_ + burst_packets_; }
+  double losses() const { return gap_losses_ + burst_losses_; }
+  const std::array<double, kLossRunBins>& loss_runs() const { return loss_runs_; }
+
+ private:
+  void close_candidate();
+  void decay();
+
+  LossModelConfig cfg_;
+  double gap_packets_ = 0.0;
+  double gap_losses_ = 0.0;
+  double burst_packets_ = 0.0;
+  double burst_losses_ = 0.0;
+  double bursts_ = 0.0;
+  std::array<double, kLossRunBins> loss_runs_{};
+
+  // Candidate burst: first to last loss, then received packets since.
+  int candidate_packets_ = 0;
+  int candidate_losses_ = 0;
+  int since_loss_ = 0;
+  int loss_run_ = 0;
+};
+
+// Loss models per receiver. Receivers are keyed by the SSRC they report
+// from; transport-wide feedback uses kTransportWideReceiver.
+class LossPatternTracker {
+ public:
+  static constexpr std::uint32_t kTransportWideReceiver = 0;
+
+  explicit LossPatternTracker(LossModelConfig cfg = {});
+
+  void add(std::uint32_t receiver, const std::vector<bool>& received);
+  // Skips thinned blocks and the part of a block an earlier one covered.
+  void add(std::uint32_t receiver, const XrLossRle& block);
+
+  // The receiver losing the most, among those with at least min_packets
+  // classified packets; nullptr if none qualifies.
+  const GilbertElliottEstimator* worst(double min_packets) const;
+  const std::map<std::uint32_t, GilbertElliottEstimator>& receivers() const { return models_; }
+
+ private:
+  GilbertElliottEstimator& model(std::uint32_t receiver);
+
+  LossModelConfig cfg_;
+  std::map<std::uint32_t, GilbertElliottEstimator> models_;
+  std::map<std::uint32_t, std::uint16_t> rle_end_;  // per receiver
+};
+
+// Parity columns of the XOR FEC stream: media packet n joins column
+// n % interleave, and each column emits one parity packet per group_size
+// media packets, right after the last one.
+struct FecLayout {
+  int group_size = 0;
+  int interleave = 1;
+  double residual_loss = 0.0;  // media loss left after repair
+  double recovered = 0.0;      // fraction of media losses repaired
+};
+
+struct FecLayoutConfig {
+  LossModelConfig model;
+  std::chrono::milliseconds max_delay{100};  // repair delay interleaving may add
+  double min_packets = 1000.0;               // observations before the model is used
+  double min_gain = 0.10;                    // relative residual-loss gain to deepen
+  std::chrono::milliseconds hold{5000};      // between interleave changes
+};
+
+// Expected media loss left after one round of XOR repair under `model`.
+double xor_fec_residual(const GilbertElliottParams& model, int group_size, int interleave);
+
+// For the group size fec_percentage pays for, the interleave with the lowest
+// residual loss (so the most repaired packets per parity byte). Columns must
+// fit the 48-packet RFC 5109 mask and group_size * interleave must stay
+// within max_span packets (repair delay); near-ties go to the shallower
+// interleave.
+FecLayout choose_fec_layout(const GilbertElliottParams& model, int fec_percentage, int max_span);
+
+}  // namespace ve
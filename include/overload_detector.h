@@ -0,0 +1,79 @@
+// Encoder CPU overload detection and frame-rate/resolution degradation ladder (no GStreamer dependency)
+#pragma once
+
+#include "utils.h"
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace ve {
+
+// One rung of the CPU ladder, applied on top of whatever profile the network
+// adaptation picked.
+struct CpuLevel {
+  double scale = 1.0;    // width/height factor
+  int fps_divisor = 1;
+};
+
+// Full quality, 3/4 size, 3/4 size at half rate, 1/2 size at half rate.
+std::vector<CpuLevel> make_cpu_ladder();
+
+// `profile` reduced by `level`; never below 320 pixels wide (or the profile's
+// own width if smaller) or 1 fps.
+VideoProfile apply_cpu_level(const VideoProfile& profile, const CpuLevel& level);
+
+// Encoder load over one measurement window.
+struct LoadSample {
+  std::chrono::milliseconds window{1000};
+  int frames = 0;        // frames the encoder finished
+  int dropped = 0;       // raw frames the leaky queue dropped in front of it
+  double busy_ms = 0.0;  // encoder processing time summed over the window
+};
+
+struct OverloadConfig {
+  double high_usage = 0.85;  // busy fraction of the encoding thread
+  double low_usage = 0.70;   // predicted usage on the rung above must stay below this
+  double max_drop_ratio = 0.02;
+  int overuse_windows = 2;   // consecutive busy windows before stepping down
+  std::chrono::milliseconds settle{3000};  // after any switch (reinit + keyframe)
+  std::chrono::milliseconds underuse_hold{10000};
+  std::chrono::milliseconds max_underuse_hold{160000};
+};
+
+// Steps the CPU ladder down one rung when the encoder falls behind (queue
+// drops in a window, or usage above high_usage for overuse_windows) and back
+// up once the usage scaled to the rung above (pixel rate ratio) has stayed
+// below low_usage for underuse_hold. A step up that is followed by a
+// step down within the hold doubles the hold, so a host that cannot sustain
+// the rung above stops oscillating.
+class OverloadDetector {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit OverloadDetector(OverloadConfig cfg = {}, std::vector<CpuLevel> ladder = make_cpu_ladder());
+
+  // Returns true when the level changed.
+  bool update(const LoadSample& sample, Clock::time_point now);
+
+  std::size_t level_index() const { return level_; }
+  const CpuLevel& level() const { return ladder_[level_]; }
+  std::size_t levels() const { return ladder_.size(); }
+  // Encoding cost of `level` relative to the top rung (pixel rate ratio).
+  static double relative_cost(const CpuLevel& level);
+  // Busy fraction of the last window.
+  double usage() const { return usage_; }
+
+ private:
+  OverloadConfig cfg_;
+  std::vector<CpuLevel> ladder_;
+  std::size_t level_ = 0;
+  double usage_ = 0.0;
+  int busy_windows_ = 0;
+  std::chrono::milliseconds underuse_hold_;
+  Clock::time_point idle_since_{};
+  Clock::time_point last_switch_{};
+  Clock::time_point last_up_{};
+};
+
+}  // namespace ve
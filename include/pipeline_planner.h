@@ -0,0 +1,64 @@
+// Raw video chain planner: orders frame dropping, scaling and colour conversion by cost (no GStreamer dependency)
+#pragma once
+
+#include "utils.h"
+
+#include <string>
+#include <vector>
+
+namespace ve {
+
+enum class RawStage {
+  Rate,
+  Scale,
+  Convert,
+  ConvertScale,  // fused packed RGB -> I420 convert + scale (veconvertscale)
+};
+
+// GStreamer factory name of the element implementing `stage`.
+const char* raw_stage_element(RawStage stage);
+
+// What the source is known to produce before negotiation; 0 / empty where
+// its caps still allow a range.
+struct SourceFormat {
+  std::string format;  // GStreamer video format name, e.g. "BGRx"
+  int width = 0;
+  int height = 0;
+  double fps = 0.0;
+};
+
+// Whether adaptation may change the target's size or frame rate at runtime;
+// a stage that is idle now is kept if it may be needed later.
+struct PlanConstraints {
+  bool size_may_change = true;
+  bool fps_may_change = true;
+  // veconvertscale is registered; used for the packed RGB formats it takes.
+  bool fused_convert_scale = false;
+};
+
+struct RawChainPlan {
+  std::vector<RawStage> stages;        // in source-to-capsfilter order
+  double bytes_per_second = 0.0;       // estimated memory traffic of the chain
+  double naive_bytes_per_second = 0.0; // the same for convert -> scale -> rate
+  // "videorate -> videoscale -> videoconvert"
+  std::string describe() const;
+};
+
+// Bytes per pixel of a raw video format; 4 for formats it does not know.
+double format_bytes_per_pixel(const std::string& format);
+
+// Source formats the fused convert + scale stage accepts.
+bool fused_convert_scale_accepts(const std::string& format);
+
+// videorate only drops frames, so it goes first and the other stages see the
+// target rate. Scaling and conversion each read and write every frame; the
+// order moving fewer bytes is picked from the source and target sizes and
+// formats. A strong downscale goes first, but converting 4-byte RGB to I420
+// first can win for a mild one since the scaler then moves 1.5 bytes per
+// pixel. Stages whose input already matches the target and cannot change
+// are left out. When the fused stage is available and takes the source
+// format, it replaces both: it reads the source once and writes I420 once.
+RawChainPlan plan_raw_chain(const SourceFormat& source, const VideoProfile& target,
+                            const PlanConstraints& constraints = {});
+
+}  // namespace ve
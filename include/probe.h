@@ -0,0 +1,76 @@
+// Active bandwidth probing: probe cluster scheduling and delivery-rate measurement
+#pragma once
+
+#include "gcc_bwe.h"
+#include "twcc.h"
+
+#include <chrono>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace ve {
+
+struct ProbeConfig {
+  std::chrono::milliseconds duration{60};   // one cluster
+  int min_packets = 8;                      // received packets for a usable measurement
+  double rate_factor = 2.0;                 // probe at this multiple of the current estimate
+  std::chrono::milliseconds interval{5000}; // periodic probe while the estimate is below max
+  std::chrono::milliseconds max_interval{60000};  // backoff cap after probes that find nothing
+  double drop_ratio = 0.66;                 // below this share of the previous peak: recovery probe
+  std::chrono::milliseconds settle{1000};   // after a drop, before probing back
+  double max_loss = 0.02;                   // no probing above this receiver-reported loss
+};
+
+// One burst sent at target_kbps (media plus padding) during [start, end).
+struct ProbeCluster {
+  int target_kbps = 0;
+  std::chrono::steady_clock::time_point start{};
+  std::chrono::steady_clock::time_point end{};
+};
+
+// Delivery rate of a cluster from its transport-wide results (send order).
+// The send rate is bytes over the send span, the receive rate bytes over the
+// arrival span, each leaving out one edge packet. A receive rate clearly
+// below the send rate means the bottleneck was hit and is returned; else the
+// lower of the two. Empty when too few packets arrived.
+std::optional<int> probe_delivery_kbps(std::span<const PacketResult> packets, int min_packets);
+
+// Decides when to probe and turns cluster feedback into a capacity
+// estimate. Probes go out at start-up, every `interval` while the estimate
+// is below the ceiling (backing off while probes find nothing new), and once
+// after a large drop to check whether the old rate is available again.
+// Time is passed in, as in RateController.
+class BandwidthProber {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit BandwidthProber(ProbeConfig cfg = {});
+
+  // Current estimate after each controller decision; returns a cluster to
+  // send, if one is due.
+  std::optional<ProbeCluster> update(int estimate_kbps, int max_kbps, BandwidthUsage usage,
+                                     double fraction_lost, Clock::time_point now);
+
+  // Transport-wide results; returns the measured capacity once the pending
+  // cluster is fully reported.
+  std::optional<int> on_feedback(std::span<const PacketResult> packets, Clock::time_point now);
+
+  bool probing() const { return active_; }
+
+ private:
+  ProbeConfig cfg_;
+  ProbeCluster cluster_;
+  bool active_ = false;
+  std::vector<PacketResult> results_;
+  int estimate_at_probe_ = 0;
+
+  bool started_ = false;
+  Clock::time_point last_probe_{};
+  std::chrono::milliseconds interval_;
+  int peak_kbps_ = 0;
+  int recovery_kbps_ = 0;  // pre-drop rate to probe back to
+  Clock::time_point drop_time_{};
+};
+
+}  // namespace ve
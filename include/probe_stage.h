@@ -0,0 +1,51 @@
+// Paced padding bursts for bandwidth probing, pushed next to the media RTP stream
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Forward declare GStreamer types to avoid hard dependency in header
+typedef struct _GstElement GstElement;
+
+namespace ve {
+
+// Owns a pacing thread that pushes padding-only RTP packets (RFC 3550 P
+// bit, no payload) into an appsrc feeding the media udpsink, through a
+// funnel so they get transport-wide sequence numbers like media. They go
+// out on the RTX SSRC and payload type, which receivers already expect
+// next to the media and drop once the padding is stripped; the media
+// stream's own sequence numbers stay untouched.
+class ProbeStage {
+ public:
+  ProbeStage();
+  ~ProbeStage();
+
+  bool attach(GstElement* probe_src, std::uint32_t ssrc, unsigned int payload_type);
+  void detach();
+
+  // Sends padding at padding_kbps for duration, paced evenly. A request
+  // while a burst is running replaces it. Returns immediately.
+  void start(int padding_kbps, std::chrono::milliseconds duration);
+
+ private:
+  void run();
+  void push_packet();
+
+  GstElement* probe_src_ = nullptr;
+  std::thread thread_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  bool stopping_ = false;
+  int padding_kbps_ = 0;
+  std::chrono::milliseconds duration_{0};
+  bool pending_ = false;
+  std::uint16_t seq_ = 0;
+  std::uint32_t ssrc_ = 0;
+  unsigned int payload_type_ = 0;
+  std::uint64_t packets_ = 0;
+};
+
+}  // namespace ve
@@ -0,0 +1,48 @@
+// Loss repair selection: FEC, retransmission or both, from round-trip time and loss
+#pragma once
+
+#include <chrono>
+
+namespace ve {
+
+enum class ProtectionMode { Fec, Rtx, Hybrid };
+
+const char* protection_mode_name(ProtectionMode mode);
+
+struct ProtectionConfig {
+  double rtx_window_ms = 200.0;  // receiver jitter-buffer delay available for repairs
+  double hybrid_loss = 0.10;     // smoothed loss above which RTX alone is not trusted
+  double hysteresis = 0.2;       // relative band around each RTT threshold
+  std::chrono::milliseconds hold{5000};  // before dropping protection
+};
+
+// A retransmission arrives about one RTT after the loss is noticed, so it is
+// only useful while the RTT fits inside the receiver's jitter-buffer window;
+// FEC repairs immediately but costs its redundancy all the time.
+// - RTT <= window / 2: RTX only (a second request still fits)
+// - RTT <= window: RTX plus FEC (one retransmission round only)
+// - beyond: FEC only
+// Heavy loss keeps FEC on as well, since RTX would need several rounds.
+// Switches towards more protection apply at once, towards less after `hold`.
+class ProtectionSelector {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit ProtectionSelector(ProtectionConfig cfg = {});
+
+  // Feeds one receiver report; returns true when the mode changed.
+  bool update(double srtt_ms, double fraction_lost, Clock::time_point now);
+
+  ProtectionMode mode() const { return mode_; }
+
+ private:
+  ProtectionMode target(double srtt_ms) const;
+
+  ProtectionConfig cfg_;
+  ProtectionMode mode_ = ProtectionMode::Hybrid;  // until the first RTT sample
+  double loss_ = 0.0;
+  bool have_loss_ = false;
+  Clock::time_point relax_since_{};
+};
+
+}  // namespace ve
@@ -1,43 +1,152 @@
-// QoS controller stub to adapt encoder based on observed loss
+// QoS controller: GStreamer glue feeding RTCP and transport-wide feedback to a RateController
 #pragma once
 
+#include "rate_controller.h"
+#include "seqlock.h"
+#include "twcc.h"
+
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
-#include <thread>
+#include <mutex>
+#include <span>
+#include <vector>
 
 // Forward declare GStreamer types to avoid hard dependency in header
 typedef struct _GstElement GstElement;
 typedef struct _GstBus GstBus;
+typedef struct _GstPad GstPad;
+typedef struct _GObject GObject;
+typedef struct _GstStructure GstStructure;
 
 namespace ve {
 
+// Knobs the controller turns besides the encoder bitrate. Called on the
+// RTCP thread; unset hooks leave that knob alone.
+struct AdaptationHooks {
+  std::function<void(int)> set_fec_percentage;
+  std::function<void(int)> set_fec_interleave;
+  std::function<void(const VideoProfile&)> set_profile;
+  std::function<void(bool)> set_rtx_enabled;
+  std::function<void(int padding_kbps, std::chrono::milliseconds duration)> start_probe;
+};
+
 class QosController {
  public:
+  using Clock = std::chrono::steady_clock;
+
   QosController();
   ~QosController();
 
-  // Provide handles; controller may read stats and adjust encoder properties periodically.
+  // Provide handles; subscribes to RTCP of rtpbin's session 0 so every
+  // receiver report is handled as it arrives (on the RTCP thread).
   void attach(GstElement* rtpbin, GstElement* encoder, GstBus* bus);
 
-  // Starts periodic monitoring with given interval (ms).
+  // Stamps every RTP packet leaving pay with a transport-wide sequence
+  // number (header extension ext_id, 1-14), records send times as packets
+  // enter rtp_sink (renumbering retransmissions there, so each send is timed
+  // on its own), and listens for transport-wide feedback, enabling the
+  // delay-based estimator. Numbering at the payloader keeps the extension
+  // inside what FEC protects, so call this after attach() but before other
+  // probes on pay's src pad (XorFecStage).
+  bool enable_transport_cc(GstElement* pay, GstElement* rtp_sink, int ext_id);
+
+  void set_hooks(AdaptationHooks hooks) { hooks_ = std::move(hooks); }
+
+  // Redundancy configured on the FEC stream. Call after attach().
+  void set_fec_percentage(int fec_percentage);
+
+  // Lets the controller also trade bitrate for FEC redundancy and step
+  // through `ladder` (rung 0 = the configured profile). Call after attach()
+  // and set_hooks().
+  void enable_joint_adaptation(std::vector<VideoProfile> ladder, int fec_percentage);
+
+  // Chooses FEC, retransmission or both from the measured RTT, through the
+  // set_fec_percentage / set_rtx_enabled hooks. Call after attach() and
+  // set_hooks().
+  void enable_protection_selection(const ProtectionConfig& cfg);
+
+  // Sends padding bursts through start_probe to find spare capacity. Needs
+  // enable_transport_cc().
+  void enable_probing(const ProbeConfig& cfg);
+
+  // Fits a burst-loss model from RTCP XR Loss RLE blocks (and transport-wide
+  // feedback, if enabled) and picks the FEC interleave through
+  // set_fec_interleave. Call after attach() and set_hooks().
+  void enable_loss_patterns(const FecLayoutConfig& cfg);
+
+  // Enables adaptation. interval_ms is the hold-off between loss-driven
+  // increases; decreases react to the next report showing loss.
   void start(int interval_ms = 1000);
   void stop();
 
+  // Per-source stats of a remote participant that just sent RTCP; picks up
+  // a new report block about our stream, if any.
+  void on_source_stats(const GstStructure* stats);
+
+  // One report block about our stream: fraction lost (0..1) and round-trip
+  // time in ms (0 if the receiver has not echoed a sender report yet).
+  void on_receiver_report(double fraction_lost, double rtt_ms);
+
+  // Next transport-wide sequence number for a payloaded packet (payloader
+  // streaming thread).
+  std::uint16_t assign_transport_seq();
+  // A packet numbered by assign_transport_seq() reaches the socket (sending
+  // thread). False if the number was sent before (a retransmitted copy).
+  bool on_rtp_sent(std::uint16_t seq, std::size_t bytes);
+  // A packet without a number of its own reaches the socket: one that
+  // bypassed the payloader (FEC parity, probe padding) or an RTX copy.
+  // Returns the number to stamp into it (sending thread).
+  std::uint16_t on_unnumbered_rtp_sent(std::size_t bytes);
+  int transport_cc_ext_id() const { return twcc_ext_id_; }
+
+  // FCI of one transport-wide feedback message.
+  void on_transport_feedback(std::span<const std::uint8_t> fci);
+
+  // One incoming compound RTCP packet; XR blocks feed the loss model.
+  void on_rtcp(std::span<const std::uint8_t> compound);
+
+  // Estimate, loss, RTT, bitrate and FEC as of the last decision. Safe from
+  // any thread; never takes the controller's lock, so bus callbacks and
+  // exporters polling it add no contention to feedback handling.
+  QosStats stats() const { return stats_.load(); }
+
  private:
-  void run_loop();
+  void detach();
+  void detach_transport_cc();
+  void apply(const RateDecision& decision);
 
   GstElement* rtpbin_ = nullptr;
   GstElement* encoder_ = nullptr;
   GstBus* bus_ = nullptr;
+  GObject* session_ = nullptr;
+  unsigned long handler_id_ = 0;
+  unsigned long feedback_id_ = 0;
+  unsigned long xr_id_ = 0;
+  GstPad* pay_pad_ = nullptr;
+  GstPad* rtp_pad_ = nullptr;
+  unsigned long stamp_id_ = 0;
+  unsigned long probe_id_ = 0;
+  int twcc_ext_id_ = 0;
 
+  std::mutex mtx_;  // serialises reports and feedback against start/stop
   std::atomic<bool> running_{false};
-  int interval_ms_ = 1000;
-  std::thread worker_;
+  std::unique_ptr<RateController> rates_;
+  AdaptationHooks hooks_;
+  Seqlock<QosStats> stats_;  // written under mtx_
+
+  std::uint32_t last_rb_ssrc_ = 0;
+  std::uint32_t last_rb_seq_ = 0;
+  std::uint32_t last_rb_lsr_ = 0;
 
-  unsigned int base_bitrate_ = 0;
-  unsigned int min_bitrate_ = 500;
-  unsigned int max_bitrate_ = 8000;
+  std::mutex history_mtx_;
+  TwccSendHistory history_;
+  TwccReferenceUnwrapper twcc_reference_;  // under mtx_
+  std::vector<PacketResult> results_;
+  std::vector<XrReport> xr_;
 };
 
 }  // namespace ve
@@ -0,0 +1,152 @@
+// Rate adaptation decisions (loss ceiling, delay-based estimate, joint policy) without GStreamer
+#pragma once
+
+#include "adaptation_policy.h"
+#include "gcc_bwe.h"
+#include "loss_model.h"
+#include "probe.h"
+#include "protection.h"
+#include "twcc.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace ve {
+
+// What the glue has to apply after an input; *_changed flags say which
+// knobs moved.
+struct RateDecision {
+  unsigned int bitrate_kbps = 0;
+  int fec_percentage = 0;
+  std::size_t profile = 0;
+  ProtectionMode protection = ProtectionMode::Fec;
+  bool bitrate_changed = false;
+  bool fec_changed = false;
+  bool profile_changed = false;
+  bool protection_changed = false;
+  // XOR FEC parity columns (see FecLayout).
+  int fec_interleave = 1;
+  bool fec_interleave_changed = false;
+  // Probe cluster to send now: padding on top of the media rate.
+  int probe_padding_kbps = 0;
+  std::chrono::milliseconds probe_duration{0};
+};
+
+// Current view of the link and of what the controller applied, for
+// observers outside the QoS thread.
+struct QosStats {
+  std::chrono::steady_clock::time_point updated{};  // input behind this view
+  std::uint64_t decisions = 0;
+  unsigned int bitrate_kbps = 0;   // encoder target
+  unsigned int loss_kbps = 0;      // loss-based ceiling
+  int delay_kbps = 0;              // delay-based estimate, 0 without feedback
+  double acked_kbps = 0.0;         // delivery rate from feedback
+  BandwidthUsage usage = BandwidthUsage::Normal;
+  double fraction_lost = 0.0;      // last receiver report
+  double rtt_ms = 0.0;             // smoothed
+  int fec_percentage = 0;
+  int fec_interleave = 1;
+  ProtectionMode protection = ProtectionMode::Fec;  // with protection selection
+  std::size_t profile = 0;         // ladder rung
+};
+
+// The QoS decision logic. Time is always passed in, so the same code runs
+// live (steady_clock) and in the trace simulator (virtual time).
+//
+// - Loss ceiling: -15% on a report with > 8% loss (once per RTT), +5% after
+//   the increase interval when loss stays under 1%.
+// - Delay-based estimate (GCC) from transport-wide feedback, used while
+//   feedback keeps arriving; the encoder gets the lower of the two.
+// - Optional joint policy splitting that budget between video and FEC and
+//   picking a resolution rung.
+// - Optional FEC/RTX selection from the smoothed RTT; FEC is dropped to 0%
+//   while retransmission alone covers losses.
+// - Optional active probing: padding bursts whose delivery rate, measured
+//   from transport-wide feedback, lets both estimates jump to the capacity
+//   found instead of climbing a few percent per second.
+// - Optional loss-pattern tracking: a Gilbert-Elliott model per receiver,
+//   fed by RTCP XR loss RLE and transport-wide feedback, picks the XOR FEC
+//   interleave that repairs the most losses for the redundancy paid.
+class RateController {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Bounds default to 60%..150% of base as before.
+  explicit RateController(unsigned int base_kbps);
+
+  // fec_percentage 0 leaves FEC alone.
+  void enable_joint_adaptation(std::vector<VideoProfile> ladder, int fec_percentage);
+  // Redundancy configured on the FEC stream. Used when no joint policy runs:
+  // restored after RTX-only periods and left out of probe results.
+  void set_fec_percentage(int fec_percentage);
+
+  void enable_protection_selection(ProtectionConfig cfg);
+  // Needs transport-wide feedback.
+  void enable_probing(ProbeConfig cfg);
+  void enable_loss_patterns(FecLayoutConfig cfg);
+  void set_increase_interval(std::chrono::milliseconds interval) { increase_interval_ = interval; }
+
+  RateDecision on_receiver_report(double fraction_lost, double rtt_ms, Clock::time_point now);
+  RateDecision on_transport_feedback(std::span<const PacketResult> packets, Clock::time_point now);
+  // Loss RLE block from an RTCP XR sent by `receiver`; picked up by the next
+  // decision.
+  void on_loss_rle(std::uint32_t receiver, const XrLossRle& block);
+
+  unsigned int bitrate_kbps() const { return applied_kbps_; }
+  unsigned int min_kbps() const { return min_kbps_; }
+  unsigned int max_kbps() const { return max_kbps_; }
+  double srtt_ms() const { return srtt_ms_; }
+  const DelayBasedBwe& bwe() const { return bwe_; }
+  const AdaptationPolicy* policy() const { return policy_.get(); }
+  const ProtectionSelector* protection() const { return protection_.get(); }
+  const BandwidthProber* prober() const { return prober_.get(); }
+  const LossPatternTracker* loss_patterns() const { return patterns_.get(); }
+  // Snapshot as of the last decision.
+  QosStats stats() const;
+
+ private:
+  void reset_bwe();
+  RateDecision decide(Clock::time_point now);
+  void update_fec_layout(RateDecision& d, Clock::time_point now);
+
+  unsigned int base_kbps_;
+  unsigned int min_kbps_;
+  unsigned int max_kbps_;
+  std::chrono::milliseconds increase_interval_{1000};
+
+  double srtt_ms_ = 0.0;
+  Clock::time_point last_decrease_{};
+  Clock::time_point last_change_{};
+  bool have_report_ = false;
+  double last_loss_ = 0.0;
+
+  unsigned int loss_kbps_;
+  DelayBasedBwe bwe_;
+  BandwidthUsage last_usage_ = BandwidthUsage::Normal;
+  Clock::time_point last_feedback_{};
+  bool have_feedback_ = false;
+  unsigned int applied_kbps_;
+  std::uint64_t decisions_ = 0;
+  Clock::time_point last_decision_{};
+
+  std::unique_ptr<AdaptationPolicy> policy_;
+
+  std::unique_ptr<ProtectionSelector> protection_;
+  bool protection_changed_ = false;
+  int static_fec_ = 0;   // without the joint policy
+  int applied_fec_ = 0;
+
+  std::unique_ptr<BandwidthProber> prober_;
+
+  std::unique_ptr<LossPatternTracker> patterns_;
+  FecLayoutConfig layout_cfg_;
+  std::vector<bool> received_;  // scratch for transport-wide feedback
+  int fec_interleave_ = 1;
+  Clock::time_point last_layout_change_{};
+};
+
+}  // namespace ve
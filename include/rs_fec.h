@@ -0,0 +1,40 @@
+// Systematic Cauchy Reed-Solomon erasure codec over GF(256)
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ve {
+
+// (k, m) block code: k data shards plus m parity shards, all the same length.
+// Any m lost shards per block can be rebuilt. Requires k + m <= 256.
+class RsCodec {
+ public:
+  RsCodec(int data_shards, int parity_shards);
+
+  bool valid() const { return k_ > 0 && m_ > 0; }
+  int data_shards() const { return k_; }
+  int parity_shards() const { return m_; }
+
+  // Computes m parity shards from k data shards. Returns false on size mismatch.
+  bool encode(std::span<const std::span<const std::uint8_t>> data,
+              std::span<const std::span<std::uint8_t>> parity) const;
+
+  // shards holds k data shards followed by m parity shards; present[i] marks
+  // which ones arrived. Missing data shards are rebuilt in place (parity shards
+  // are left untouched). Returns false if more than m shards are missing.
+  bool decode(std::span<const std::span<std::uint8_t>> shards,
+              const std::vector<bool>& present) const;
+
+  // Coefficient of data shard col in parity row row.
+  std::uint8_t coefficient(int row, int col) const { return cauchy_[row * k_ + col]; }
+
+ private:
+  int k_ = 0;
+  int m_ = 0;
+  std::vector<std::uint8_t> cauchy_;  // m x k, row-major
+};
+
+}  // namespace ve
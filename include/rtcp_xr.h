@@ -0,0 +1,47 @@
+// RTCP extended reports (RFC 3611): Loss RLE and Statistics Summary blocks
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ve {
+
+constexpr std::uint8_t kRtcpXr = 207;
+constexpr std::uint8_t kXrLossRle = 1;
+constexpr std::uint8_t kXrStatsSummary = 6;
+
+// Loss RLE block: one flag per sequence number in [begin_seq, end_seq).
+// With thinning T only every 2^T-th sequence number is reported.
+struct XrLossRle {
+  std::uint32_t ssrc = 0;         // media source the block is about
+  std::uint8_t thinning = 0;
+  std::uint16_t begin_seq = 0;
+  std::uint16_t end_seq = 0;      // one past the last
+  std::vector<bool> received;
+};
+
+// Statistics Summary block; counts are valid only if their flag is set.
+struct XrStatsSummary {
+  std::uint32_t ssrc = 0;
+  std::uint16_t begin_seq = 0;
+  std::uint16_t end_seq = 0;
+  bool has_loss = false;
+  bool has_dup = false;
+  std::uint32_t lost_packets = 0;
+  std::uint32_t dup_packets = 0;
+};
+
+struct XrReport {
+  std::uint32_t sender_ssrc = 0;  // the receiver that sent the report
+  std::vector<XrLossRle> loss_rle;
+  std::vector<XrStatsSummary> summaries;
+};
+
+// Collects the Loss RLE and Statistics Summary blocks of every XR packet in
+// a compound RTCP packet into `out` (one entry per XR packet). Other packets
+// and block types are skipped. Returns false on malformed input.
+bool parse_rtcp_xr(std::span<const std::uint8_t> compound, std::vector<XrReport>& out);
+
+}  // namespace ve
@@ -0,0 +1,190 @@
+// RTP-aware XOR FEC (RFC 5109 ULP level 0) built on the XOR FEC kernels
+#pragma once
+
+#include "h264_nal.h"
+#include "xor_fec.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace ve {
+
+constexpr std::size_t kRtpHeaderSize = 12;
+constexpr std::size_t kRtpFecHeaderSize = 10;  // RFC 5109 FEC header
+constexpr std::size_t kRtpFecMaxMask = 48;     // long mask (L = 1)
+
+// Minimal view of the fixed RTP header.
+struct RtpHeader {
+  bool marker = false;
+  std::uint8_t payload_type = 0;
+  std::uint16_t seq = 0;
+  std::uint32_t timestamp = 0;
+  std::uint32_t ssrc = 0;
+};
+
+bool parse_rtp_header(std::span<const std::uint8_t> packet, RtpHeader& out);
+
+// Payload of an RTP packet (after CSRCs and header extension, padding
+// stripped). Empty on malformed input.
+std::span<const std::uint8_t> rtp_payload(std::span<const std::uint8_t> packet);
+
+// Parsed FEC packet: RTP header of the FEC stream plus FEC and ULP level 0
+// headers. payload views the protected bytes inside the input packet.
+struct RtpFecHeader {
+  RtpHeader rtp;
+  std::uint8_t recovery_byte0 = 0;  // P, X, CC of the protected packets, XORed
+  std::uint8_t recovery_byte1 = 0;  // M, PT, XORed
+  std::uint16_t sn_base = 0;
+  std::uint32_t ts_recovery = 0;
+  std::uint16_t length_recovery = 0;
+  std::uint16_t protection_length = 0;
+  std::uint64_t mask = 0;           // bit 47 (MSB) is sn_base, bit 46 sn_base + 1, ...
+  std::span<const std::uint8_t> payload;
+
+  // Whether media sequence number seq is covered by this FEC packet.
+  bool covers(std::uint16_t seq) const;
+};
+
+bool parse_rtp_fec(std::span<const std::uint8_t> packet, RtpFecHeader& out);
+
+struct RtpFecConfig {
+  std::uint8_t payload_type = 127;  // FEC stream PT
+  std::uint16_t group_size = 5;     // media packets per parity packet (1..48)
+  std::size_t max_packet = 1500;    // larger media packets are left unprotected
+};
+
+// Sender side: XORs each outgoing media packet into a running parity buffer
+// and emits one RFC 5109 FEC packet per group. Header fields and lengths are
+// protected, so receivers can rebuild packets of different sizes exactly.
+// Parity is accumulated in a pooled buffer; the steady state does not allocate.
+class RtpFecEncoder {
+ public:
+  explicit RtpFecEncoder(RtpFecConfig cfg = {});
+  RtpFecEncoder(const RtpFecEncoder&) = delete;
+  RtpFecEncoder& operator=(const RtpFecEncoder&) = delete;
+
+  // Feeds one media RTP packet. Returns true and fills `out` when the
+  // packet completes a group. Non-RTP input is ignored.
+  bool add(std::span<const std::uint8_t> rtp, std::vector<std::uint8_t>& out);
+  // A sequence gap closes the open group in add(), and the packet after it
+  // can complete the next one as well (group size 1); that second parity
+  // packet is emitted here. Call after every add().
+  bool poll(std::vector<std::uint8_t>& out);
+
+  // Emits parity for a partially filled group (e.g. at end of stream).
+  bool flush(std::vector<std::uint8_t>& out);
+
+  void set_group_size(std::uint16_t group_size);
+  std::uint16_t group_size() const { return cfg_.group_size; }
+
+ private:
+  void reset_group();
+  void build(std::vector<std::uint8_t>& out);
+
+  RtpFecConfig cfg_;
+  ParityBufferPool pool_;
+  XorParityAccumulator parity_;  // XOR of protected bytes (after the RTP header)
+  std::uint8_t byte0_ = 0;
+  std::uint8_t byte1_ = 0;
+  std::uint32_t ts_ = 0;
+  std::uint16_t length_ = 0;
+  std::uint16_t sn_base_ = 0;
+  std::uint64_t mask_ = 0;
+  std::uint16_t count_ = 0;
+  std::uint32_t ssrc_ = 0;
+  std::uint16_t fec_seq_ = 0;
+  std::uint32_t last_ts_ = 0;
+};
+
+// Interleaved RFC 5109 parity: media packet n joins column n % depth, each
+// column a separate RtpFecEncoder, so one parity packet covers packets
+// `depth` apart and a loss burst shorter than depth costs every column at
+// most one packet. Columns are capped so they fit the 48-packet mask.
+class InterleavedFecEncoder {
+ public:
+  explicit InterleavedFecEncoder(RtpFecConfig cfg = {});
+
+  bool add(std::span<const std::uint8_t> rtp, std::vector<std::uint8_t>& out);
+  // RtpFecEncoder::poll for the column the last packet went to.
+  bool poll(std::vector<std::uint8_t>& out);
+  // Emits parity for one partially filled column; call until it returns false.
+  bool flush(std::vector<std::uint8_t>& out);
+
+  void set_group_size(std::uint16_t group_size);
+  // Flush first: packets already in a column stay with it.
+  void set_depth(std::uint16_t depth);
+  std::uint16_t depth() const { return depth_; }
+
+ private:
+  RtpFecConfig cfg_;
+  std::vector<std::unique_ptr<RtpFecEncoder>> columns_;  // grows, never shrinks
+  std::uint16_t depth_ = 1;
+  std::uint16_t next_ = 0;
+  std::uint16_t last_ = 0;
+};
+
+struct UepFecConfig {
+  std::uint8_t payload_type = 127;
+  // Redundancy per H264Priority (non-IDR, IDR, parameter sets); 0 disables.
+  std::array<int, kH264PriorityCount> percentage{20, 20, 20};
+};
+
+struct UepFecStats {
+  std::array<std::uint64_t, kH264PriorityCount> media_bytes{};
+  std::array<std::uint64_t, kH264PriorityCount> parity_bytes{};
+};
+
+// Unequal error protection: classifies each H.264 RTP packet by NAL type and
+// runs a separate RFC 5109 group per class, so IDR slices and SPS/PPS can be
+// protected more heavily than P-slices. IDR and parameter-set groups are
+// flushed at the end of each access unit (RTP marker) so their parity is not
+// held back until the next keyframe. With equal percentages all classes
+// share one group, which is plain RFC 5109.
+class UepFecEncoder {
+ public:
+  using Sink = std::function<void(std::span<const std::uint8_t>)>;
+
+  explicit UepFecEncoder(UepFecConfig cfg = {});
+
+  void set_sink(Sink sink) { sink_ = std::move(sink); }
+  void set_percentage(H264Priority priority, int percentage);
+  int percentage(H264Priority priority) const {
+    return cfg_.percentage[static_cast<int>(priority)];
+  }
+  // Interleave depth of the non-IDR (or shared) group; open columns are
+  // flushed first.
+  void set_interleave(std::uint16_t depth);
+  std::uint16_t interleave() const { return encoders_[0].depth(); }
+
+  // Feeds one media RTP packet; parity packets go to the sink.
+  void add(std::span<const std::uint8_t> rtp);
+
+  const UepFecStats& stats() const { return stats_; }
+
+ private:
+  bool uniform() const;
+  void emit(H264Priority priority);
+
+  UepFecConfig cfg_;
+  std::array<InterleavedFecEncoder, kH264PriorityCount> encoders_;
+  std::vector<std::uint8_t> out_;
+  std::uint16_t fec_seq_ = 0;
+  Sink sink_;
+  UepFecStats stats_;
+};
+
+// Rebuilds the single media packet missing from `fec`'s protection set.
+// received must hold every other covered media packet (any order). Returns
+// the recovered RTP packet, or an empty vector if recovery is impossible.
+std::vector<std::uint8_t> rtp_fec_recover(std::span<const std::span<const std::uint8_t>> received,
+                                          const RtpFecHeader& fec);
+
+// Group size that spends roughly `percentage` of media bandwidth on parity.
+std::uint16_t rtp_fec_group_size(int percentage);
+
+}  // namespace ve
@@ -0,0 +1,58 @@
+// RTP retransmission (RFC 4588) through rtpbin's aux sender, answering RTCP NACKs
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Forward declare GStreamer types to avoid hard dependency in header
+typedef struct _GstElement GstElement;
+typedef struct _GstPad GstPad;
+
+namespace ve {
+
+struct RtxConfig {
+  unsigned int media_pt = 96;
+  unsigned int rtx_pt = 97;
+  // Both set: the RTX stream of media_ssrc uses rtx_ssrc (probe padding
+  // shares it). Otherwise rtprtxsend picks one.
+  std::uint32_t media_ssrc = 0;
+  std::uint32_t rtx_ssrc = 0;
+  unsigned int history_ms = 200;       // requests for older packets would arrive too late
+  unsigned int history_packets = 2048; // hard cap on the packet history
+};
+
+// Installs an rtprtxsend into rtpbin session 0 via "request-aux-sender". The
+// session turns incoming generic NACKs into retransmission requests that
+// rtprtxsend serves from its bounded history, sending RTX packets
+// (SSRC-multiplexed, payload type rtx_pt) on the media port. Must be
+// attached before rtpbin's send_rtp_sink_0 is requested.
+class RtxStage {
+ public:
+  RtxStage();
+  ~RtxStage();
+
+  bool attach(GstElement* rtpbin, const RtxConfig& cfg);
+  void detach();
+
+  // Disabled, retransmissions are dropped at rtprtxsend's output; the
+  // history keeps filling so re-enabling takes effect at once.
+  void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Called by the rtpbin signal handler (application thread).
+  GstElement* make_aux_sender(unsigned int session);
+
+  // Called for every buffer leaving rtprtxsend (streaming thread); false
+  // drops it.
+  bool on_rtx_output(std::uint8_t payload_type);
+
+ private:
+  GstElement* rtpbin_ = nullptr;
+  unsigned long handler_id_ = 0;
+  RtxConfig cfg_;
+  std::atomic<bool> enabled_{true};
+  std::atomic<std::uint64_t> sent_{0};
+  std::atomic<std::uint64_t> dropped_{0};
+};
+
+}  // namespace ve
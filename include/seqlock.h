@@ -0,0 +1,60 @@
+// Single-writer seqlock for publishing small trivially copyable snapshots
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace ve {
+
+// One writer stores a value; any number of readers copy it out without a
+// lock and without ever blocking the writer. A reader that overlaps a store
+// retries, so reads are lock-free rather than wait-free, but a store is a
+// handful of relaxed word writes and retries are rare.
+//
+// The value lives in atomic words, so a torn copy is never a data race; the
+// sequence number (odd while a store is in progress) tells the reader to
+// discard it. Writers must be serialised by the caller.
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable_v<T>, "Seqlock needs a trivially copyable type");
+
+ public:
+  Seqlock() { store(T{}); }
+  Seqlock(const Seqlock&) = delete;
+  Seqlock& operator=(const Seqlock&) = delete;
+
+  void store(const T& value) {
+    std::array<std::uint64_t, kWords> words{};
+    std::memcpy(words.data(), &value, sizeof(T));
+    const std::uint64_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < kWords; ++i) words_[i].store(words[i], std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  T load() const {
+    std::array<std::uint64_t, kWords> words;
+    std::uint64_t before = 0;
+    do {
+      before = seq_.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < kWords; ++i) words[i] = words_[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) != 0 || seq_.load(std::memory_order_relaxed) != before);
+    T value;
+    std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+    return value;
+  }
+
+ private:
+  static constexpr std::size_t kWords = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+  std::atomic<std::uint64_t> seq_{0};
+  std::array<std::atomic<std::uint64_t>, kWords> words_{};
+};
+
+}  // namespace ve
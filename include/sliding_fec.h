@@ -0,0 +1,102 @@
+// Sliding-window random linear FEC over GF(256) (RFC 8681 style)
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace ve {
+
+// Repair packet layout: first source id (16), window size (8), repair key
+// (16), symbol length (16), then the coded symbol. Each source enters the
+// code as a symbol of [16-bit length | packet bytes], zero-padded.
+constexpr std::size_t kSlidingRepairHeaderSize = 7;
+
+struct SlidingFecConfig {
+  std::uint16_t window = 16;          // sources covered by each repair packet (1..255)
+  std::uint16_t repair_interval = 4;  // one repair packet per N source packets
+  std::size_t max_packet = 1500;
+};
+
+// Coefficient of the index-th source of the window for a repair key. Derived
+// from a counter-based hash rather than RFC 8681's TinyMT32; never zero.
+std::uint8_t sliding_fec_coefficient(std::uint16_t repair_key, std::uint16_t index);
+
+// Sender side. Every repair packet is a random linear combination of the last
+// W source packets, so repair latency is set by the window and the repair
+// interval rather than by block boundaries.
+class SlidingWindowEncoder {
+ public:
+  explicit SlidingWindowEncoder(SlidingFecConfig cfg = {});
+
+  // Adds a source packet with its id (e.g. RTP sequence number). Ids are
+  // expected to be consecutive; a jump restarts the window. Returns true and
+  // fills repair when a repair packet is due.
+  bool add(std::uint16_t id, std::span<const std::uint8_t> packet,
+           std::vector<std::uint8_t>& repair);
+
+  // Builds a repair packet over the current window right now.
+  bool make_repair(std::vector<std::uint8_t>& repair);
+
+ private:
+  struct Source {
+    std::vector<std::uint8_t> symbol;  // length prefix + packet
+    std::uint16_t id = 0;
+  };
+
+  SlidingFecConfig cfg_;
+  std::vector<Source> ring_;  // window slots, insertion order
+  std::uint32_t pos_ = 0;     // total sources inserted
+  std::uint16_t next_id_ = 0;
+  std::uint16_t filled_ = 0;
+  std::uint16_t since_repair_ = 0;
+  std::uint16_t repair_key_ = 0;
+};
+
+// Receiver side. Keeps recently received sources and the linear equations
+// contributed by repair packets; whenever the system determines a missing
+// source (directly or after Gaussian elimination) it is queued for pop().
+class SlidingWindowDecoder {
+ public:
+  explicit SlidingWindowDecoder(SlidingFecConfig cfg = {});
+
+  void add_source(std::uint16_t id, std::span<const std::uint8_t> packet);
+  void add_repair(std::span<const std::uint8_t> repair);
+
+  // Next recovered source packet, if any.
+  bool pop_recovered(std::uint16_t& id, std::vector<std::uint8_t>& packet);
+
+  std::uint64_t recovered() const { return recovered_total_; }
+
+ private:
+  struct Slot {
+    std::vector<std::uint8_t> symbol;
+    std::uint16_t id = 0;
+    bool present = false;
+  };
+
+  struct Equation {
+    std::vector<std::pair<std::uint16_t, std::uint8_t>> terms;  // (source id, coefficient)
+    std::vector<std::uint8_t> data;
+  };
+
+  bool known(std::uint16_t id) const;
+  void learn(std::uint16_t id, std::span<const std::uint8_t> symbol, bool recovered);
+  void substitute(Equation& eq) const;
+  void solve();
+  void prune();
+
+  SlidingFecConfig cfg_;
+  std::vector<Slot> slots_;
+  std::uint16_t mask_ = 0;
+  std::uint16_t newest_ = 0;
+  bool started_ = false;
+  std::vector<Equation> equations_;
+  std::deque<std::pair<std::uint16_t, std::vector<std::uint8_t>>> recovered_;
+  std::uint64_t recovered_total_ = 0;
+};
+
+}  // namespace ve
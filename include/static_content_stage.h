@@ -0,0 +1,60 @@
+// Static-content frame skipping: unchanged raw frames are dropped at the source, with periodic refreshes
+#pragma once
+
+#include "frame_diff.h"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Forward declare GStreamer types to avoid hard dependency in header
+typedef struct _GstElement GstElement;
+typedef struct _GstPad GstPad;
+typedef struct _GstCaps GstCaps;
+typedef struct _GstBuffer GstBuffer;
+typedef struct _GstVideoInfo GstVideoInfo;
+
+namespace ve {
+
+// An idle desktop still yields a full frame per tick, each converted,
+// scaled and encoded into an all-skip P-frame. This stage hashes every
+// frame on the source's src pad (BlockChangeDetector) and drops those
+// StaticFrameGate rejects, before the raw chain. Keyframe requests reaching
+// the encoder let the next frame through so an IDR is not held back, and
+// a force-key-unit goes downstream once skipping has kept keyframes away
+// for longer than the configured interval.
+class StaticContentStage {
+ public:
+  StaticContentStage();
+  ~StaticContentStage();
+
+  // encoder may be null where no keyframe requests arrive (tiled encoding).
+  bool attach(GstElement* source, GstElement* encoder, const StaticContentConfig& cfg);
+  void detach();
+
+  // Source caps changed (streaming thread).
+  void on_caps(GstCaps* caps);
+  // A raw frame leaves the source (streaming thread). Returns false to drop it.
+  bool on_buffer(GstBuffer* buffer);
+  // A force-key-unit event reached the encoder (upstream event thread).
+  void on_key_unit_request();
+  // A keyframe left the encoder (encoder streaming thread).
+  void on_keyframe();
+
+ private:
+  // Hashes and gates one frame; sets key_unit when it must be a keyframe.
+  bool admit(GstBuffer* buffer, bool* key_unit);
+
+  std::mutex mtx_;
+  BlockChangeDetector detector_;
+  StaticFrameGate gate_;
+  GstVideoInfo* info_ = nullptr;  // null until caps are known
+  std::vector<PlaneView> planes_;
+  std::uint64_t changed_blocks_ = 0;
+  GstPad* source_pad_ = nullptr;
+  GstPad* encoder_pad_ = nullptr;
+  unsigned long source_probe_id_ = 0;
+  unsigned long event_probe_id_ = 0;
+};
+
+}  // namespace ve
@@ -0,0 +1,34 @@
+// Vertical-strip tiling of a frame for parallel encoding, shared by the sender and the tile compositor
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace ve {
+
+// Tile i is sent as its own RTP stream with SSRC kTileSsrcBase + i.
+constexpr std::uint32_t kTileSsrcBase = 0x7E1E0000u;
+constexpr int kMaxTiles = 16;
+
+// One vertical strip: full height, columns [x, x + width).
+struct Tile {
+  int index = 0;
+  int x = 0;
+  int width = 0;
+  int height = 0;
+};
+
+// Splits the frame into `count` strips whose widths are multiples of
+// `align` (whole macroblocks, so no encoder pads a strip edge) and differ by
+// at most one align unit; the last strip ends at the frame edge. Narrow
+// frames get fewer strips.
+std::vector<Tile> plan_tiles(int width, int height, int count, int align = 16);
+
+std::uint32_t tile_ssrc(int index);
+// Tile index of an SSRC from plan_tiles' streams, or -1.
+int tile_index(std::uint32_t ssrc, int count);
+
+// Share of total_kbps for one strip, by area.
+int tile_bitrate_kbps(const Tile& tile, int frame_width, int total_kbps);
+
+}  // namespace ve
@@ -0,0 +1,91 @@
+// Transport-wide congestion control feedback (draft-holmer-rmcat-transport-wide-cc-extensions-01)
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ve {
+
+constexpr const char* kTwccExtensionUri =
+    "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01";
+constexpr std::uint8_t kRtcpRtpfb = 205;  // RTCP transport layer feedback
+constexpr std::uint8_t kTwccFmt = 15;
+
+struct TwccPacket {
+  std::uint16_t seq = 0;
+  bool received = false;
+  std::chrono::microseconds arrival{0};  // receiver clock; valid if received
+};
+
+struct TwccFeedback {
+  std::uint16_t base_seq = 0;
+  std::uint8_t feedback_count = 0;
+  std::vector<TwccPacket> packets;  // base_seq, base_seq + 1, ...
+};
+
+// Reference time of successive feedback messages as one continuous count of
+// 64 ms units. The 24-bit field is signed and wraps; each value is taken as
+// the shortest signed step from the previous one.
+class TwccReferenceUnwrapper {
+ public:
+  std::int64_t unwrap(std::uint32_t reference);
+
+ private:
+  bool have_last_ = false;
+  std::uint32_t last_ = 0;
+  std::int64_t unwrapped_ = 0;
+};
+
+// Parses the FCI of a transport-wide feedback message (everything after the
+// sender/media SSRCs of the RTPFB header). Returns false on malformed input.
+// Arrival times are continuous across messages parsed with the same
+// `reference` unwrapper; without one the reference time is only
+// sign-extended.
+bool parse_twcc_fci(std::span<const std::uint8_t> fci, TwccFeedback& out,
+                    TwccReferenceUnwrapper* reference = nullptr);
+
+// One transport-wide packet matched against its send record.
+struct PacketResult {
+  std::chrono::steady_clock::time_point send_time{};
+  std::chrono::microseconds arrival{0};  // receiver clock
+  std::size_t bytes = 0;
+  bool received = false;
+};
+
+// Sender-side record of transport sequence numbers. record() hands out the
+// next sequence number and stamps its send time; assign() and sent() do the
+// same in two steps, for numbers written into packets before they reach the
+// socket. resolve() pairs feedback with send times. Packets older than the
+// capacity are forgotten.
+class TwccSendHistory {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit TwccSendHistory(std::size_t capacity = 4096);
+
+  std::uint16_t record(std::size_t bytes, Clock::time_point now);
+  std::uint16_t assign();
+  // First send of an assigned number; false for a repeat or one too old to
+  // be kept.
+  bool sent(std::uint16_t seq, std::size_t bytes, Clock::time_point now);
+
+  // Appends one PacketResult per feedback entry with a known send record.
+  void resolve(const TwccFeedback& feedback, std::vector<PacketResult>& out) const;
+
+ private:
+  struct Sent {
+    Clock::time_point time{};
+    std::size_t bytes = 0;
+    std::uint16_t seq = 0;
+    bool valid = false;
+  };
+
+  std::vector<Sent> ring_;
+  std::uint16_t mask_ = 0;
+  std::uint16_t next_seq_ = 0;
+};
+
+}  // namespace ve
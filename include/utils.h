@@ -30,15 +30,36 @@ struct EngineConfig {
   PortsConfig ports;
   VideoProfile profile;
   std::string source = "ximagesrc";  // or v4l2src/videotestsrc
-  int fec_percentage = 20;            // redundancy, aims to tolerate ~5% loss
-  std::string mode = "rtpbin";       // rtpbin | simple
+  int fec_percentage = -1;            // redundancy, -1 = 20 (aims to tolerate ~5% loss), none with tiles
+  std::string fec_engine = "ulpfec"; // ulpfec (rtpulpfecenc) | xor (in-house RFC 5109)
+  int fec_idr_percentage = -1;        // xor engine: IDR slices, -1 = same as fec_percentage
+  int fec_params_percentage = -1;     // xor engine: SPS/PPS, -1 = same as fec_percentage
+  std::string mode;                  // rtpbin | simple; empty = rtpbin, simple with tiles
   int latency_ms = 50;                // target sender latency hint
+  std::string adapt = "joint";       // joint (bitrate + FEC + resolution ladder) | bitrate
+  int twcc_ext_id = 5;                // transport-wide CC header extension id (1-14), 0 = loss-only QoS
+  std::string protection;            // auto (by RTT) | fec | rtx | both; empty = auto (rtpbin), else fec
+  int rtx_window_ms = 200;            // receiver jitter-buffer delay usable for retransmissions
+  bool probing = true;                // padding bursts to find spare capacity (needs twcc)
+  int gop_seconds = 0;                // max keyframe distance, 0 = 10 s with PLI/FIR (rtpbin), else 2 s
+  bool cpu_adapt = true;              // lower fps/resolution while the encoder cannot keep up
+  bool fused_convert = true;          // one-pass threaded RGB -> I420 convert + scale when possible
+  int static_refresh_ms = 1000;       // skip unchanged frames, forwarding one per interval; 0 = off
+  int tiles = 1;                      // >1: vertical strips encoded in parallel, one SSRC each (simple mode)
+  bool low_delay = false;             // sliced x264 threads, per-slice packetization (first packet before frame end)
+  bool mtu_slices = false;            // cap slices to one RTP packet, so a loss costs a slice rather than a frame
 };
 
 // Parse CLI of form:
 //   video_engine <ip> <p1> <p2> <p3> <p4> [--source=] [--width=] [--height=]
 //                                     [--fps=] [--bitrate=] [--fec=] [--mode=]
-//                                     [--latency=]
+//                                     [--latency=] [--fec-engine=] [--fec-idr=]
+//                                     [--fec-params=] [--twcc-ext=] [--adapt=]
+//                                     [--protection=] [--rtx-window=] [--gop=]
+//                                     [--probe=on|off] [--cpu-adapt=on|off]
+//                                     [--fused-convert=on|off] [--static-refresh=]
+//                                     [--tiles=] [--low-delay=on|off]
+//                                     [--mtu-slices=on|off]
 // Returns std::nullopt and prints help on failure.
 std::optional<EngineConfig> parse_args(int argc, char** argv);
 
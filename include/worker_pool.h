@@ -0,0 +1,50 @@
+// Fork-join worker pool for splitting per-frame work across threads
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ve {
+
+// Fixed helper threads that run one batch at a time: run() hands out task
+// indices to the helpers and the calling thread, and returns once every task
+// has finished. Meant for short data-parallel jobs such as the stripes of a
+// frame, so the helpers block on a condition variable between batches.
+// Only one thread may call run() at a time.
+class WorkerPool {
+ public:
+  // helpers = 0 runs every batch on the caller.
+  explicit WorkerPool(int helpers);
+  ~WorkerPool();
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // Threads a batch runs on, the caller included.
+  int concurrency() const { return static_cast<int>(threads_.size()) + 1; }
+
+  // Calls fn(i) for every i in [0, tasks).
+  void run(int tasks, const std::function<void(int)>& fn);
+
+ private:
+  void worker();
+  void drain();
+
+  std::vector<std::thread> threads_;
+  std::mutex mtx_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  std::uint64_t generation_ = 0;
+  std::size_t busy_ = 0;  // helpers still in the current batch
+  bool stop_ = false;
+
+  const std::function<void(int)>* fn_ = nullptr;
+  int tasks_ = 0;
+  std::atomic<int> next_{0};
+};
+
+}  // namespace ve
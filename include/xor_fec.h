@@ -1,8 +1,9 @@
-// Simple XOR FEC stubs (not integrated in pipeline; using ULPFEC in GStreamer)
+// XOR FEC primitives (RTP framing lives in rtp_fec.h, pipeline stage in fec_stage.h)
 #pragma once
 
 #include <cstddef>
 #include <cstdint>
+#include <span>
 #include <vector>
 
 namespace ve {
@@ -17,9 +18,130 @@ struct FecPacket {
 FecPacket xor_parity(const std::vector<std::vector<std::uint8_t>>& packets,
                      std::uint32_t group_id);
 
+// Same as above over packet views, so callers need not copy into owned vectors.
+FecPacket xor_parity(std::span<const std::span<const std::uint8_t>> packets,
+                     std::uint32_t group_id);
+
 // Attempt to recover one missing packet by XORing the rest with parity.
 // Returns empty vector on failure.
 std::vector<std::uint8_t> xor_recover(const std::vector<std::vector<std::uint8_t>>& received,
                                       const FecPacket& parity);
 
+std::vector<std::uint8_t> xor_recover(std::span<const std::span<const std::uint8_t>> received,
+                                      const FecPacket& parity);
+
+// 2D row/column mode (SMPTE 2022-1 / FlexFEC style). Packets are laid out
+// row-major in `rows` (D) rows of `columns` (L) packets; a burst of up to L
+// consecutive losses hits each column at most once.
+struct FecMatrix {
+  std::uint16_t columns = 0;  // L
+  std::uint16_t rows = 0;     // D
+};
+
+struct FecMatrixParity {
+  std::vector<FecPacket> row_parity;     // D packets, row r covers r*L .. r*L+L-1
+  std::vector<FecPacket> column_parity;  // L packets, column c covers c, c+L, ...
+};
+
+// Builds row and column parity for exactly L*D packets. All parity packets
+// carry the given group_id. Returns empty parity on shape mismatch.
+FecMatrixParity xor_parity_2d(std::span<const std::span<const std::uint8_t>> packets,
+                              FecMatrix shape, std::uint32_t group_id);
+
+// Repairs missing packets in place, alternating row and column passes until
+// nothing changes. packets/present hold L*D slots; a parity packet with
+// count == 0 is treated as lost. Recovered packets are parity-length, i.e.
+// zero-padded to the longest packet of their row/column. Returns the number
+// of packets recovered.
+std::size_t xor_recover_2d(std::vector<std::vector<std::uint8_t>>& packets,
+                           std::vector<bool>& present, FecMatrix shape,
+                           const FecMatrixParity& parity);
+
+// XORs every packet into dst (packets may be shorter than dst, never longer).
+void xor_accumulate(std::span<std::uint8_t> dst,
+                    std::span<const std::span<const std::uint8_t>> packets);
+
+// Fixed set of equally sized parity buffers carved from one arena. All memory
+// is allocated up front; acquire/release only move indices on a free list.
+// Not thread-safe: use one pool per streaming thread.
+class ParityBufferPool {
+ public:
+  static constexpr std::uint32_t kNone = 0xffffffffu;
+
+  ParityBufferPool(std::size_t buffers, std::size_t capacity);
+
+  // Returns a buffer index, or kNone when every buffer is in use.
+  std::uint32_t acquire();
+  void release(std::uint32_t index);
+
+  std::uint8_t* data(std::uint32_t index) { return arena_.data() + index * stride_; }
+  std::size_t capacity() const { return capacity_; }
+  std::size_t available() const { return free_.size(); }
+
+ private:
+  std::size_t capacity_ = 0;
+  std::size_t stride_ = 0;  // capacity rounded up to a cache line
+  std::vector<std::uint8_t> arena_;
+  std::vector<std::uint32_t> free_;
+};
+
+// Parity produced by XorParityAccumulator. Move-only; hands its buffer back
+// to the pool when destroyed or released.
+class PooledParity {
+ public:
+  PooledParity() = default;
+  PooledParity(ParityBufferPool* pool, std::uint32_t index, std::size_t size,
+               std::uint32_t group_id, std::uint16_t count);
+  PooledParity(PooledParity&& other) noexcept;
+  PooledParity& operator=(PooledParity&& other) noexcept;
+  PooledParity(const PooledParity&) = delete;
+  PooledParity& operator=(const PooledParity&) = delete;
+  ~PooledParity() { release(); }
+
+  explicit operator bool() const { return pool_ != nullptr; }
+  std::span<const std::uint8_t> data() const;
+  std::uint32_t group_id() const { return group_id_; }
+  std::uint16_t count() const { return count_; }
+  void release();
+
+ private:
+  ParityBufferPool* pool_ = nullptr;
+  std::uint32_t index_ = ParityBufferPool::kNone;
+  std::size_t size_ = 0;
+  std::uint32_t group_id_ = 0;
+  std::uint16_t count_ = 0;
+};
+
+// Incremental parity: begin a group, add packets one at a time (each is
+// XORed into the running parity right away, so callers can drop it), then
+// finish. Output matches xor_parity over the same packets.
+class XorParityAccumulator {
+ public:
+  explicit XorParityAccumulator(ParityBufferPool& pool) : pool_(pool) {}
+  XorParityAccumulator(const XorParityAccumulator&) = delete;
+  XorParityAccumulator& operator=(const XorParityAccumulator&) = delete;
+  ~XorParityAccumulator() { abort(); }
+
+  // Starts a group. Returns false if the pool is exhausted.
+  bool begin(std::uint32_t group_id);
+  // XORs one packet in. Returns false if no group is open or the packet is
+  // larger than the pool's buffer capacity.
+  bool add(std::span<const std::uint8_t> packet);
+  // Closes the group and hands out its parity (empty if no group was open).
+  PooledParity finish();
+  // Drops the open group, returning its buffer to the pool.
+  void abort();
+
+  bool active() const { return index_ != ParityBufferPool::kNone; }
+  std::uint16_t count() const { return count_; }
+  std::size_t size() const { return size_; }
+
+ private:
+  ParityBufferPool& pool_;
+  std::uint32_t index_ = ParityBufferPool::kNone;
+  std::size_t size_ = 0;
+  std::uint32_t group_id_ = 0;
+  std::uint16_t count_ = 0;
+};
+
 }  // namespace ve
@@ -0,0 +1,24 @@
+// SIMD XOR kernels with runtime CPU dispatch (AVX2 / SSE2 / portable)
+#pragma once
+
+#include "cpu_features.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ve {
+
+using XorKernel = SimdLevel;  // Scalar, Sse2, Avx2
+
+// dst[i] ^= srcs[0][i] ^ ... ^ srcs[n-1][i] for i in [0, len).
+// Works a cache line at a time so every source is streamed once per line.
+void xor_into(std::uint8_t* dst, const std::uint8_t* const* srcs, std::size_t n,
+              std::size_t len);
+
+// Kernel picked at startup (see KernelDispatch); overridable for benchmarks.
+XorKernel xor_kernel();
+bool xor_kernel_supported(XorKernel kernel);
+bool set_xor_kernel(XorKernel kernel);
+const char* xor_kernel_name(XorKernel kernel);
+
+}  // namespace ve
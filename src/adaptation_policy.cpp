@@ -0,0 +1,124 @@
+#include "adaptation_policy.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using namespace ve;
+
+constexpr double kMinBitsPerPixel = 0.04;
+constexpr int kMinWidth = 320;
+
+int round_to_8(double v) { return std::max(8, static_cast<int>(std::lround(v / 8.0)) * 8); }
+
+double pixel_rate(const VideoProfile& p) {
+  return static_cast<double>(p.width) * p.height * p.fps;
+}
+
+}  // namespace
+
+namespace ve {
+
+int profile_min_kbps(const VideoProfile& profile) {
+  return static_cast<int>(pixel_rate(profile) * kMinBitsPerPixel / 1000.0);
+}
+
+std::vector<VideoProfile> make_profile_ladder(const VideoProfile& top) {
+  std::vector<VideoProfile> ladder{top};
+  auto add = [&](double scale, int fps) {
+    VideoProfile p;
+    p.width = round_to_8(top.width * scale);
+    p.height = round_to_8(top.height * scale);
+    p.fps = fps;
+    if (p.width < kMinWidth) return;
+    p.bitrate_kbps = static_cast<int>(top.bitrate_kbps * std::pow(pixel_rate(p) / pixel_rate(top), 0.75));
+    ladder.push_back(p);
+  };
+  for (double scale : {0.75, 0.5, 0.375}) add(scale, top.fps);
+  const VideoProfile smallest = ladder.back();
+  if (top.fps >= 20) add(static_cast<double>(smallest.width) / top.width, top.fps / 2);
+  return ladder;
+}
+
+AdaptationPolicy::AdaptationPolicy(std::vector<VideoProfile> ladder, AdaptationConfig cfg)
+    : ladder_(std::move(ladder)), cfg_(cfg) {
+  if (ladder_.empty()) ladder_.push_back(VideoProfile{});
+  if (cfg_.fec_start <= 0) cfg_.fec_min = cfg_.fec_max = 0;
+  fec_ = std::clamp(cfg_.fec_start, cfg_.fec_min, cfg_.fec_max);
+  applied_fec_ = fec_;
+}
+
+void AdaptationPolicy::report_loss(double fraction_lost) {
+  fraction_lost = std::clamp(fraction_lost, 0.0, 1.0);
+  loss_ = have_loss_ ? 0.7 * loss_ + 0.3 * fraction_lost : fraction_lost;
+  have_loss_ = true;
+}
+
+void AdaptationPolicy::update_fec(Clock::time_point now) {
+  if (!have_loss_ || cfg_.fec_max == 0) return;
+  const int target = std::clamp(
+      static_cast<int>(std::lround(cfg_.fec_min + cfg_.fec_per_loss_pct * loss_ * 100.0)),
+      cfg_.fec_min, cfg_.fec_max);
+
+  if (target >= fec_ + cfg_.fec_step || (target > fec_ && target == cfg_.fec_max)) {
+    fec_ = target;
+    fec_low_since_ = {};
+    return;
+  }
+  if (target <= fec_ - cfg_.fec_step || (target < fec_ && target == cfg_.fec_min)) {
+    if (fec_low_since_ == Clock::time_point{}) fec_low_since_ = now;
+    if (now - fec_low_since_ >= cfg_.fec_down_hold) {
+      fec_ = target;
+      fec_low_since_ = {};
+    }
+    return;
+  }
+  fec_low_since_ = {};
+}
+
+bool AdaptationPolicy::update_profile(double video_kbps, Clock::time_point now) {
+  const bool cooling = last_switch_ != Clock::time_point{} && now - last_switch_ < cfg_.cooldown;
+
+  if (profile_ + 1 < ladder_.size() && video_kbps < profile_min_kbps(ladder_[profile_])) {
+    above_since_ = {};
+    if (below_since_ == Clock::time_point{}) below_since_ = now;
+    if (!cooling && now - below_since_ >= cfg_.down_hold) {
+      ++profile_;
+      below_since_ = {};
+      last_switch_ = now;
+      return true;
+    }
+    return false;
+  }
+  below_since_ = {};
+
+  if (profile_ > 0 && video_kbps >= cfg_.up_margin * profile_min_kbps(ladder_[profile_ - 1])) {
+    if (above_since_ == Clock::time_point{}) above_since_ = now;
+    if (!cooling && now - above_since_ >= cfg_.up_hold) {
+      --profile_;
+      above_since_ = {};
+      last_switch_ = now;
+      return true;
+    }
+    return false;
+  }
+  above_since_ = {};
+  return false;
+}
+
+AdaptationDecision AdaptationPolicy::update(double budget_kbps, Clock::time_point now) {
+  AdaptationDecision d;
+  update_fec(now);
+  const int fec = fec_suspended_ ? 0 : fec_;
+  d.fec_changed = fec != applied_fec_;
+  applied_fec_ = fec;
+  const double video = budget_kbps * 100.0 / (100.0 + fec);
+  d.profile_changed = update_profile(video, now);
+  d.fec_percentage = fec;
+  d.profile = profile_;
+  d.video_kbps = std::clamp(static_cast<int>(video), min_kbps(), std::max(cfg_.max_kbps, min_kbps()));
+  return d;
+}
+
+}  // namespace ve
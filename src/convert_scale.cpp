@@ -0,0 +1,485 @@
+#include "convert_scale.h"
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VE_CONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using namespace ve;
+
+constexpr int kShift = 14;  // fixed-point bits of the colour matrix
+constexpr std::int32_t kLumaBias = (16 << kShift) + (1 << (kShift - 1));
+constexpr std::int32_t kChromaBias = (128 << kShift) + (1 << (kShift - 1));
+
+using Coeffs = std::int16_t[3][4];
+
+// Horizontal bilinear: out[i] = in[x0[i]] * (128 - w) + in[x1[i]] * w, per
+// channel, rounded and >> 7; returns the number of leading pixels done.
+using HScaleFn = int (*)(const std::uint8_t*, const std::int32_t*, const std::int32_t*, const std::int8_t*, int,
+                         std::uint8_t*);
+// out = (a * (128 - w) + b * w + 64) >> 7, per byte.
+using BlendFn = void (*)(const std::uint8_t*, const std::uint8_t*, int, std::uint8_t*, std::size_t);
+// Converts two packed rows into two Y rows and one U and V row; returns the
+// number of leading pixels done (the rest go through rows_scalar).
+using RowsFn = int (*)(const std::uint8_t*, const std::uint8_t*, int, std::uint8_t*, std::uint8_t*,
+                       std::uint8_t*, std::uint8_t*, const Coeffs&);
+
+inline std::uint8_t clamp_u8(std::int32_t v) { return static_cast<std::uint8_t>(std::clamp(v, 0, 255)); }
+
+inline std::uint8_t avg_u8(std::uint8_t a, std::uint8_t b) {
+  return static_cast<std::uint8_t>((a + b + 1) >> 1);
+}
+
+inline std::uint8_t dot(const std::uint8_t* p, const std::int16_t* k, std::int32_t bias) {
+  return clamp_u8((k[0] * p[0] + k[1] * p[1] + k[2] * p[2] + bias) >> kShift);
+}
+
+void hscale_scalar(const std::uint8_t* in, const std::int32_t* x0, const std::int32_t* x1,
+                   const std::int8_t* weights, int from, int n, std::uint8_t* out) {
+  for (int x = from; x < n; ++x) {
+    std::uint32_t a, b;
+    std::memcpy(&a, in + x0[x], 4);
+    std::memcpy(&b, in + x1[x], 4);
+    // Two channels per 32-bit word, 16 bits each: no overflow at 255 * 128.
+    const std::uint32_t iw = static_cast<std::uint32_t>(weights[x * 8]);
+    const std::uint32_t w = static_cast<std::uint32_t>(weights[x * 8 + 1]);
+    const std::uint32_t rb = (((a & 0x00FF00FFu) * iw + (b & 0x00FF00FFu) * w + 0x00400040u) >> 7) & 0x00FF00FFu;
+    const std::uint32_t ga =
+        ((((a >> 8) & 0x00FF00FFu) * iw + ((b >> 8) & 0x00FF00FFu) * w + 0x00400040u) >> 7 & 0x00FF00FFu) << 8;
+    const std::uint32_t px = rb | ga;
+    std::memcpy(out + x * 4, &px, 4);
+  }
+}
+
+int hscale_none(const std::uint8_t*, const std::int32_t*, const std::int32_t*, const std::int8_t*, int,
+                std::uint8_t*) {
+  return 0;
+}
+
+void blend_scalar(const std::uint8_t* a, const std::uint8_t* b, int w, std::uint8_t* out, std::size_t n) {
+  const int iw = 128 - w;
+  for (std::size_t i = 0; i < n; ++i) out[i] = static_cast<std::uint8_t>((a[i] * iw + b[i] * w + 64) >> 7);
+}
+
+void rows_scalar(const std::uint8_t* r0, const std::uint8_t* r1, int from, int width, std::uint8_t* y0,
+                 std::uint8_t* y1, std::uint8_t* u, std::uint8_t* v, const Coeffs& k) {
+  for (int x = from; x < width; x += 2) {
+    const int xr = std::min(x + 1, width - 1);
+    const std::uint8_t* a0 = r0 + x * 4;
+    const std::uint8_t* b0 = r0 + xr * 4;
+    const std::uint8_t* a1 = r1 + x * 4;
+    const std::uint8_t* b1 = r1 + xr * 4;
+    y0[x] = dot(a0, k[0], kLumaBias);
+    y1[x] = dot(a1, k[0], kLumaBias);
+    if (xr != x) {
+      y0[xr] = dot(b0, k[0], kLumaBias);
+      y1[xr] = dot(b1, k[0], kLumaBias);
+    }
+    std::uint8_t c[4];
+    for (int i = 0; i < 4; ++i) c[i] = avg_u8(avg_u8(a0[i], a1[i]), avg_u8(b0[i], b1[i]));
+    u[x / 2] = dot(c, k[1], kChromaBias);
+    v[x / 2] = dot(c, k[2], kChromaBias);
+  }
+}
+
+int rows_none(const std::uint8_t*, const std::uint8_t*, int, std::uint8_t*, std::uint8_t*, std::uint8_t*,
+              std::uint8_t*, const Coeffs&) {
+  return 0;
+}
+
+#ifdef VE_CONVERT_X86
+
+__attribute__((target("sse2")))
+void blend_sse2(const std::uint8_t* a, const std::uint8_t* b, int w, std::uint8_t* out, std::size_t n) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i wa = _mm_set1_epi16(static_cast<short>(128 - w));
+  const __m128i wb = _mm_set1_epi16(static_cast<short>(w));
+  const __m128i half = _mm_set1_epi16(64);
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+                               _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+                               _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, half), 7);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, half), 7);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+  }
+  blend_scalar(a + i, b + i, w, out + i, n - i);
+}
+
+// k . pixel for 4 packed pixels, as 4 x int32 in pixel order.
+__attribute__((target("sse2")))
+inline __m128i dot4_sse2(__m128i px, __m128i k, __m128i bias) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), k);
+  const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), k);
+  const __m128i even = _mm_castps_si128(
+      _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+  const __m128i odd = _mm_castps_si128(
+      _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1)));
+  return _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(even, odd), bias), kShift);
+}
+
+__attribute__((target("sse2")))
+inline void luma8_sse2(const std::uint8_t* p, __m128i k, __m128i bias, std::uint8_t* y) {
+  const __m128i a = dot4_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), k, bias);
+  const __m128i b = dot4_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)), k, bias);
+  const __m128i w = _mm_packs_epi32(a, b);
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(y), _mm_packus_epi16(w, w));
+}
+
+__attribute__((target("sse2")))
+inline void store4_sse2(__m128i v32, std::uint8_t* out) {
+  const __m128i w = _mm_packs_epi32(v32, v32);
+  const int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(w, w));
+  std::memcpy(out, &bytes, 4);
+}
+
+__attribute__((target("sse2")))
+int rows_sse2(const std::uint8_t* r0, const std::uint8_t* r1, int width, std::uint8_t* y0, std::uint8_t* y1,
+              std::uint8_t* u, std::uint8_t* v, const Coeffs& k) {
+  const __m128i ky = _mm_setr_epi16(k[0][0], k[0][1], k[0][2], k[0][3], k[0][0], k[0][1], k[0][2], k[0][3]);
+  const __m128i ku = _mm_setr_epi16(k[1][0], k[1][1], k[1][2], k[1][3], k[1][0], k[1][1], k[1][2], k[1][3]);
+  const __m128i kv = _mm_setr_epi16(k[2][0], k[2][1], k[2][2], k[2][3], k[2][0], k[2][1], k[2][2], k[2][3]);
+  const __m128i luma_bias = _mm_set1_epi32(kLumaBias);
+  const __m128i chroma_bias = _mm_set1_epi32(kChromaBias);
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    const std::uint8_t* p0 = r0 + x * 4;
+    const std::uint8_t* p1 = r1 + x * 4;
+    luma8_sse2(p0, ky, luma_bias, y0 + x);
+    luma8_sse2(p1, ky, luma_bias, y1 + x);
+
+    // Vertical then horizontal rounding average, as in rows_scalar.
+    const __m128i va = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p0)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1)));
+    const __m128i vb = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p0 + 16)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1 + 16)));
+    const __m128i even = _mm_castps_si128(
+        _mm_shuffle_ps(_mm_castsi128_ps(va), _mm_castsi128_ps(vb), _MM_SHUFFLE(2, 0, 2, 0)));
+    const __m128i odd = _mm_castps_si128(
+        _mm_shuffle_ps(_mm_castsi128_ps(va), _mm_castsi128_ps(vb), _MM_SHUFFLE(3, 1, 3, 1)));
+    const __m128i c = _mm_avg_epu8(even, odd);
+    store4_sse2(dot4_sse2(c, ku, chroma_bias), u + x / 2);
+    store4_sse2(dot4_sse2(c, kv, chroma_bias), v + x / 2);
+  }
+  return x;
+}
+
+// Eight pixels per step: gather the left and right source pixels,
+// interleave their bytes and let maddubs apply both weights at once.
+__attribute__((target("avx2")))
+int hscale_avx2(const std::uint8_t* in, const std::int32_t* x0, const std::int32_t* x1, const std::int8_t* weights,
+                int n, std::uint8_t* out) {
+  const auto* base = reinterpret_cast<const int*>(in);
+  const __m256i half = _mm256_set1_epi16(64);
+  int x = 0;
+  for (; x + 8 <= n; x += 8) {
+    const __m256i a = _mm256_i32gather_epi32(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x0 + x)), 1);
+    const __m256i b = _mm256_i32gather_epi32(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x1 + x)), 1);
+    const __m256i w03 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + x * 8));
+    const __m256i w47 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + x * 8 + 32));
+    // unpacklo/hi cover pixels 0-1 | 4-5 and 2-3 | 6-7.
+    const __m256i wlo = _mm256_permute2x128_si256(w03, w47, 0x20);
+    const __m256i whi = _mm256_permute2x128_si256(w03, w47, 0x31);
+    __m256i lo = _mm256_maddubs_epi16(_mm256_unpacklo_epi8(a, b), wlo);
+    __m256i hi = _mm256_maddubs_epi16(_mm256_unpackhi_epi8(a, b), whi);
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, half), 7);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, half), 7);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x * 4), _mm256_packus_epi16(lo, hi));
+  }
+  return x;
+}
+
+__attribute__((target("avx2")))
+void blend_avx2(const std::uint8_t* a, const std::uint8_t* b, int w, std::uint8_t* out, std::size_t n) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i wa = _mm256_set1_epi16(static_cast<short>(128 - w));
+  const __m256i wb = _mm256_set1_epi16(static_cast<short>(w));
+  const __m256i half = _mm256_set1_epi16(64);
+  std::size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), wa),
+                                  _mm256_mullo_epi16(_mm256_unpacklo_epi8(vb, zero), wb));
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), wa),
+                                  _mm256_mullo_epi16(_mm256_unpackhi_epi8(vb, zero), wb));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, half), 7);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, half), 7);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_packus_epi16(lo, hi));
+  }
+  blend_scalar(a + i, b + i, w, out + i, n - i);
+}
+
+// k . pixel for 8 packed pixels, as 8 x int32 in pixel order.
+__attribute__((target("avx2")))
+inline __m256i dot8_avx2(__m256i px, __m256i k, __m256i bias) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(px, zero), k);  // pixels 0-1 | 4-5
+  const __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(px, zero), k);  // pixels 2-3 | 6-7
+  return _mm256_srai_epi32(_mm256_add_epi32(_mm256_hadd_epi32(lo, hi), bias), kShift);
+}
+
+__attribute__((target("avx2")))
+inline void store8_avx2(__m256i v32, std::uint8_t* out) {
+  const __m128i w = _mm_packs_epi32(_mm256_castsi256_si128(v32), _mm256_extracti128_si256(v32, 1));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(w, w));
+}
+
+__attribute__((target("avx2")))
+inline void luma16_avx2(const std::uint8_t* p, __m256i k, __m256i bias, std::uint8_t* y) {
+  const __m256i a = dot8_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), k, bias);
+  const __m256i b = dot8_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32)), k, bias);
+  // packs/packus work per 128-bit lane; the permutes restore pixel order.
+  const __m256i w = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+  const __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(w, w), _MM_SHUFFLE(3, 1, 2, 0));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(y), _mm256_castsi256_si128(bytes));
+}
+
+__attribute__((target("avx2")))
+int rows_avx2(const std::uint8_t* r0, const std::uint8_t* r1, int width, std::uint8_t* y0, std::uint8_t* y1,
+              std::uint8_t* u, std::uint8_t* v, const Coeffs& k) {
+  const __m256i ky = _mm256_setr_epi16(k[0][0], k[0][1], k[0][2], k[0][3], k[0][0], k[0][1], k[0][2], k[0][3],
+                                       k[0][0], k[0][1], k[0][2], k[0][3], k[0][0], k[0][1], k[0][2], k[0][3]);
+  const __m256i ku = _mm256_setr_epi16(k[1][0], k[1][1], k[1][2], k[1][3], k[1][0], k[1][1], k[1][2], k[1][3],
+                                       k[1][0], k[1][1], k[1][2], k[1][3], k[1][0], k[1][1], k[1][2], k[1][3]);
+  const __m256i kv = _mm256_setr_epi16(k[2][0], k[2][1], k[2][2], k[2][3], k[2][0], k[2][1], k[2][2], k[2][3],
+                                       k[2][0], k[2][1], k[2][2], k[2][3], k[2][0], k[2][1], k[2][2], k[2][3]);
+  const __m256i luma_bias = _mm256_set1_epi32(kLumaBias);
+  const __m256i chroma_bias = _mm256_set1_epi32(kChromaBias);
+  const __m256i chroma_order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const std::uint8_t* p0 = r0 + x * 4;
+    const std::uint8_t* p1 = r1 + x * 4;
+    luma16_avx2(p0, ky, luma_bias, y0 + x);
+    luma16_avx2(p1, ky, luma_bias, y1 + x);
+
+    const __m256i va = _mm256_avg_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p0)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p1)));
+    const __m256i vb = _mm256_avg_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p0 + 32)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p1 + 32)));
+    const __m256i even = _mm256_castps_si256(
+        _mm256_shuffle_ps(_mm256_castsi256_ps(va), _mm256_castsi256_ps(vb), _MM_SHUFFLE(2, 0, 2, 0)));
+    const __m256i odd = _mm256_castps_si256(
+        _mm256_shuffle_ps(_mm256_castsi256_ps(va), _mm256_castsi256_ps(vb), _MM_SHUFFLE(3, 1, 3, 1)));
+    // Blocks come out as 0 1 4 5 | 2 3 6 7.
+    const __m256i c = _mm256_permutevar8x32_epi32(_mm256_avg_epu8(even, odd), chroma_order);
+    store8_avx2(dot8_avx2(c, ku, chroma_bias), u + x / 2);
+    store8_avx2(dot8_avx2(c, kv, chroma_bias), v + x / 2);
+  }
+  return x;
+}
+
+#endif  // VE_CONVERT_X86
+
+struct Kernels {
+  HScaleFn hscale;
+  BlendFn blend;
+  RowsFn rows;
+};
+
+constexpr KernelEntry<Kernels> kKernels[] = {
+#ifdef VE_CONVERT_X86
+    {SimdLevel::Avx2, {hscale_avx2, blend_avx2, rows_avx2}},
+    {SimdLevel::Sse2, {hscale_none, blend_sse2, rows_sse2}},
+#endif
+    {SimdLevel::Scalar, {hscale_none, blend_scalar, rows_none}},
+};
+
+KernelDispatch<Kernels>& dispatch() {
+  static KernelDispatch<Kernels> d(kKernels);
+  return d;
+}
+
+// Source coordinate of output sample i when n_src samples map onto n_dst
+// (pixel centres aligned), split into an index and a fixed-point fraction.
+void source_position(int i, int n_src, int n_dst, int one, int& index, int& frac) {
+  const double pos = std::max(0.0, (i + 0.5) * n_src / n_dst - 0.5);
+  index = static_cast<int>(pos);
+  frac = static_cast<int>(std::lround((pos - index) * one));
+  if (frac >= one) {
+    ++index;
+    frac = 0;
+  }
+  if (index >= n_src - 1) {
+    index = n_src - 1;
+    frac = 0;
+  }
+}
+
+}  // namespace
+
+namespace ve {
+
+ConvertKernel convert_kernel() { return dispatch().level(); }
+bool convert_kernel_supported(ConvertKernel kernel) { return dispatch().supports(kernel); }
+bool set_convert_kernel(ConvertKernel kernel) { return dispatch().select(kernel); }
+const char* convert_kernel_name(ConvertKernel kernel) { return simd_level_name(kernel); }
+
+FusedConvertScale::FusedConvertScale(ConvertScaleConfig cfg) : cfg_(cfg) {
+  cfg_.src_width = std::max(cfg_.src_width, 1);
+  cfg_.src_height = std::max(cfg_.src_height, 1);
+  cfg_.dst_width = std::max(cfg_.dst_width, 1);
+  cfg_.dst_height = std::max(cfg_.dst_height, 1);
+  cfg_.stripes = std::clamp(cfg_.stripes, 1, (cfg_.dst_height + 1) / 2);
+
+  hidentity_ = cfg_.src_width == cfg_.dst_width;
+  hx0_.resize(cfg_.dst_width);
+  hx1_.resize(cfg_.dst_width);
+  hweights_.resize(static_cast<std::size_t>(cfg_.dst_width) * 8);
+  for (int x = 0; x < cfg_.dst_width; ++x) {
+    int index = 0, frac = 0;
+    source_position(x, cfg_.src_width, cfg_.dst_width, 128, index, frac);
+    hx0_[x] = index * 4;
+    hx1_[x] = frac == 0 ? hx0_[x] : std::min(index + 1, cfg_.src_width - 1) * 4;
+    const int w = frac == 0 ? 64 : frac;
+    for (int c = 0; c < 4; ++c) {
+      hweights_[x * 8 + c * 2] = static_cast<std::int8_t>(128 - w);
+      hweights_[x * 8 + c * 2 + 1] = static_cast<std::int8_t>(w);
+    }
+  }
+  vtaps_.resize(cfg_.dst_height);
+  for (int y = 0; y < cfg_.dst_height; ++y) {
+    int index = 0, frac = 0;
+    source_position(y, cfg_.src_height, cfg_.dst_height, 128, index, frac);
+    vtaps_[y] = {index, std::min(index + 1, cfg_.src_height - 1), frac};
+  }
+
+  // Limited range: Y 16-235, Cb/Cr 16-240 around 128. Cb and Cr rows sum
+  // to zero so grey stays exactly neutral.
+  const double kr = cfg_.matrix == YuvMatrix::Bt601 ? 0.299 : 0.2126;
+  const double kb = cfg_.matrix == YuvMatrix::Bt601 ? 0.114 : 0.0722;
+  const double kg = 1.0 - kr - kb;
+  const double one = 1 << kShift;
+  const double ys = 219.0 / 255.0 * one;
+  const double cs = 224.0 / 255.0 * one;
+  const std::int16_t yr = static_cast<std::int16_t>(std::lround(kr * ys));
+  const std::int16_t yg = static_cast<std::int16_t>(std::lround(kg * ys));
+  const std::int16_t yb = static_cast<std::int16_t>(std::lround(kb * ys));
+  const std::int16_t ub = static_cast<std::int16_t>(std::lround(0.5 * cs));
+  const std::int16_t ur = static_cast<std::int16_t>(std::lround(-0.5 * kr / (1.0 - kb) * cs));
+  const std::int16_t ug = static_cast<std::int16_t>(-ub - ur);
+  const std::int16_t vr = ub;
+  const std::int16_t vb = static_cast<std::int16_t>(std::lround(-0.5 * kb / (1.0 - kr) * cs));
+  const std::int16_t vg = static_cast<std::int16_t>(-vr - vb);
+  const std::int16_t rows[3][3] = {{yb, yg, yr}, {ub, ug, ur}, {vb, vg, vr}};  // B, G, R
+  for (int c = 0; c < 3; ++c) {
+    coeffs_[c][0] = cfg_.rgb_order ? rows[c][2] : rows[c][0];
+    coeffs_[c][1] = rows[c][1];
+    coeffs_[c][2] = cfg_.rgb_order ? rows[c][0] : rows[c][2];
+    coeffs_[c][3] = 0;
+  }
+
+  scratch_.resize(cfg_.stripes);
+  for (Scratch& s : scratch_) {
+    if (!hidentity_) {
+      s.hrows[0].resize(static_cast<std::size_t>(cfg_.dst_width) * 4);
+      s.hrows[1].resize(static_cast<std::size_t>(cfg_.dst_width) * 4);
+    }
+    s.out[0].resize(static_cast<std::size_t>(cfg_.dst_width) * 4);
+    s.out[1].resize(static_cast<std::size_t>(cfg_.dst_width) * 4);
+  }
+}
+
+std::size_t FusedConvertScale::bytes_per_frame() const {
+  const std::size_t src = static_cast<std::size_t>(cfg_.src_width) * cfg_.src_height * 4;
+  const std::size_t luma = static_cast<std::size_t>(cfg_.dst_width) * cfg_.dst_height;
+  const std::size_t chroma = static_cast<std::size_t>((cfg_.dst_width + 1) / 2) * ((cfg_.dst_height + 1) / 2);
+  return src + luma + 2 * chroma;
+}
+
+const std::uint8_t* FusedConvertScale::source_row(const PackedFrame& src, int y, Scratch& s) {
+  const std::uint8_t* in = src.data + static_cast<std::size_t>(y) * src.stride;
+  if (hidentity_) return in;
+  if (s.hrow_index[0] == y) return s.hrows[0].data();
+  if (s.hrow_index[1] == y) return s.hrows[1].data();
+
+  // Rows are visited in increasing order; replace the older one.
+  const int slot = s.hrow_index[0] < s.hrow_index[1] ? 0 : 1;
+  std::uint8_t* out = s.hrows[slot].data();
+  const int done =
+      dispatch().table().hscale(in, hx0_.data(), hx1_.data(), hweights_.data(), cfg_.dst_width, out);
+  hscale_scalar(in, hx0_.data(), hx1_.data(), hweights_.data(), done, cfg_.dst_width, out);
+  s.hrow_index[slot] = y;
+  return s.hrows[slot].data();
+}
+
+const std::uint8_t* FusedConvertScale::output_row(const PackedFrame& src, int y, Scratch& s, std::uint8_t* out) {
+  const RowTap& t = vtaps_[y];
+  if (t.w == 0) return source_row(src, t.y0, s);
+  const std::uint8_t* a = source_row(src, t.y0, s);
+  const std::uint8_t* b = source_row(src, t.y1, s);
+  dispatch().table().blend(a, b, t.w, out, static_cast<std::size_t>(cfg_.dst_width) * 4);
+  return out;
+}
+
+void FusedConvertScale::process_rows(const PackedFrame& src, const PlanarFrame& dst, int row_begin, int row_end,
+                                     int slot) {
+  Scratch& s = scratch_[slot];
+  s.hrow_index[0] = s.hrow_index[1] = -1;
+  const RowsFn rows = dispatch().table().rows;
+  const int width = cfg_.dst_width;
+  for (int y = row_begin; y < row_end; y += 2) {
+    const bool pair = y + 1 < cfg_.dst_height;
+    const std::uint8_t* r0 = output_row(src, y, s, s.out[0].data());
+    const std::uint8_t* r1 = pair ? output_row(src, y + 1, s, s.out[1].data()) : r0;
+    std::uint8_t* y0 = dst.planes[0] + static_cast<std::size_t>(y) * dst.strides[0];
+    // An odd last row still needs somewhere to put the second luma row.
+    std::uint8_t* y1 = pair ? y0 + dst.strides[0] : s.out[1].data();
+    std::uint8_t* u = dst.planes[1] + static_cast<std::size_t>(y / 2) * dst.strides[1];
+    std::uint8_t* v = dst.planes[2] + static_cast<std::size_t>(y / 2) * dst.strides[2];
+    const int done = rows(r0, r1, width, y0, y1, u, v, coeffs_);
+    rows_scalar(r0, r1, done, width, y0, y1, u, v, coeffs_);
+  }
+}
+
+bool FusedConvertScale::resample(const PackedFrame& src, std::uint8_t* dst, std::size_t dst_stride) {
+  if (!src.data || src.width != cfg_.src_width || src.height != cfg_.src_height || !dst ||
+      dst_stride < static_cast<std::size_t>(cfg_.dst_width) * 4) {
+    return false;
+  }
+  Scratch& s = scratch_[0];
+  s.hrow_index[0] = s.hrow_index[1] = -1;
+  const std::size_t bytes = static_cast<std::size_t>(cfg_.dst_width) * 4;
+  for (int y = 0; y < cfg_.dst_height; ++y) {
+    std::uint8_t* out = dst + static_cast<std::size_t>(y) * dst_stride;
+    const std::uint8_t* row = output_row(src, y, s, out);
+    if (row != out) std::memcpy(out, row, bytes);
+  }
+  return true;
+}
+
+bool FusedConvertScale::process(const PackedFrame& src, const PlanarFrame& dst, WorkerPool* pool) {
+  if (!src.data || src.width != cfg_.src_width || src.height != cfg_.src_height ||
+      src.stride < static_cast<std::size_t>(src.width) * 4 || dst.width != cfg_.dst_width ||
+      dst.height != cfg_.dst_height || !dst.planes[0] || !dst.planes[1] || !dst.planes[2]) {
+    return false;
+  }
+  // Stripes start on even rows so each owns whole chroma rows.
+  const int rows = ((cfg_.dst_height + cfg_.stripes - 1) / cfg_.stripes + 1) & ~1;
+  auto stripe = [&](int i) {
+    const int begin = i * rows;
+    const int end = std::min(cfg_.dst_height, begin + rows);
+    if (begin < end) process_rows(src, dst, begin, end, i);
+  };
+  if (pool) {
+    pool->run(cfg_.stripes, stripe);
+  } else {
+    for (int i = 0; i < cfg_.stripes; ++i) stripe(i);
+  }
+  return true;
+}
+
+}  // namespace ve
@@ -0,0 +1,161 @@
+#include "convert_scale_filter.h"
+#include "convert_scale.h"
+#include "logger.h"
+#include "worker_pool.h"
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include <gst/video/gstvideofilter.h>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+namespace {
+
+using namespace ve;
+
+// C++ state kept behind a pointer: the GObject instance struct is
+// zero-initialised by GLib, not constructed.
+struct ConvertScaleState {
+  std::unique_ptr<FusedConvertScale> converter;
+  std::unique_ptr<WorkerPool> pool;
+};
+
+struct VeConvertScale {
+  GstVideoFilter parent;
+  ConvertScaleState* state;
+};
+
+struct VeConvertScaleClass {
+  GstVideoFilterClass parent_class;
+};
+
+GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE(
+    "sink", GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS(GST_VIDEO_CAPS_MAKE("{ BGRx, BGRA, RGBx, RGBA }")));
+GstStaticPadTemplate src_template =
+    GST_STATIC_PAD_TEMPLATE("src", GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS(GST_VIDEO_CAPS_MAKE("I420")));
+
+G_DEFINE_TYPE(VeConvertScale, ve_convert_scale, GST_TYPE_VIDEO_FILTER)
+
+// Half the cores, leaving the rest to the encoder; beyond four stripes the
+// per-batch wake-ups cost more than the rows save.
+int convert_threads() {
+  return std::clamp(static_cast<int>(std::thread::hardware_concurrency()) / 2, 1, 4);
+}
+
+// Any size on the other side; the pad templates pin the formats.
+GstCaps* transform_caps(GstBaseTransform*, GstPadDirection, GstCaps* caps, GstCaps* filter) {
+  GstCaps* out = gst_caps_new_empty();
+  for (guint i = 0; i < gst_caps_get_size(caps); ++i) {
+    GstStructure* s = gst_structure_copy(gst_caps_get_structure(caps, i));
+    gst_structure_set(s,
+                      "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+                      "height", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+                      NULL);
+    gst_structure_remove_fields(s, "format", "colorimetry", "chroma-site", "pixel-aspect-ratio", NULL);
+    out = gst_caps_merge_structure(out, s);
+  }
+  if (filter) {
+    GstCaps* filtered = gst_caps_intersect_full(filter, out, GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref(out);
+    out = filtered;
+  }
+  return out;
+}
+
+// Keeps the input size when the other side leaves it open.
+GstCaps* fixate_caps(GstBaseTransform*, GstPadDirection, GstCaps* caps, GstCaps* othercaps) {
+  othercaps = gst_caps_truncate(gst_caps_make_writable(othercaps));
+  GstStructure* out = gst_caps_get_structure(othercaps, 0);
+  const GstStructure* in = gst_caps_get_structure(caps, 0);
+  gint width = 0, height = 0;
+  if (gst_structure_get_int(in, "width", &width)) gst_structure_fixate_field_nearest_int(out, "width", width);
+  if (gst_structure_get_int(in, "height", &height)) gst_structure_fixate_field_nearest_int(out, "height", height);
+  return gst_caps_fixate(othercaps);
+}
+
+gboolean set_info(GstVideoFilter* filter, GstCaps*, GstVideoInfo* in_info, GstCaps*, GstVideoInfo* out_info) {
+  ConvertScaleState* state = reinterpret_cast<VeConvertScale*>(filter)->state;
+  const GstVideoFormat format = GST_VIDEO_INFO_FORMAT(in_info);
+  const int threads = convert_threads();
+
+  ConvertScaleConfig cfg;
+  cfg.src_width = GST_VIDEO_INFO_WIDTH(in_info);
+  cfg.src_height = GST_VIDEO_INFO_HEIGHT(in_info);
+  cfg.dst_width = GST_VIDEO_INFO_WIDTH(out_info);
+  cfg.dst_height = GST_VIDEO_INFO_HEIGHT(out_info);
+  cfg.rgb_order = format == GST_VIDEO_FORMAT_RGBx || format == GST_VIDEO_FORMAT_RGBA;
+  // Unset colorimetry defaults to BT.601 below 720 lines, as downstream assumes.
+  cfg.matrix = out_info->colorimetry.matrix == GST_VIDEO_COLOR_MATRIX_BT601 ? YuvMatrix::Bt601 : YuvMatrix::Bt709;
+  cfg.stripes = threads > 1 ? threads * 2 : 1;
+  state->converter = std::make_unique<FusedConvertScale>(cfg);
+  if (threads > 1 && !state->pool) state->pool = std::make_unique<WorkerPool>(threads - 1);
+
+  LOG_INFO(kConvertScaleElement, ": ", gst_video_format_to_string(format), " ", cfg.src_width, "x", cfg.src_height,
+           " -> I420 ", cfg.dst_width, "x", cfg.dst_height, " (",
+           cfg.matrix == YuvMatrix::Bt601 ? "BT.601" : "BT.709", ", ", convert_kernel_name(convert_kernel()), ", ",
+           threads, " threads)");
+  return TRUE;
+}
+
+GstFlowReturn transform_frame(GstVideoFilter* filter, GstVideoFrame* in, GstVideoFrame* out) {
+  ConvertScaleState* state = reinterpret_cast<VeConvertScale*>(filter)->state;
+  if (!state->converter) return GST_FLOW_NOT_NEGOTIATED;
+
+  const PackedFrame src{static_cast<const std::uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(in, 0)),
+                        static_cast<std::size_t>(GST_VIDEO_FRAME_PLANE_STRIDE(in, 0)), GST_VIDEO_FRAME_WIDTH(in),
+                        GST_VIDEO_FRAME_HEIGHT(in)};
+  PlanarFrame dst;
+  for (int i = 0; i < 3; ++i) {
+    dst.planes[i] = static_cast<std::uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(out, i));
+    dst.strides[i] = static_cast<std::size_t>(GST_VIDEO_FRAME_PLANE_STRIDE(out, i));
+  }
+  dst.width = GST_VIDEO_FRAME_WIDTH(out);
+  dst.height = GST_VIDEO_FRAME_HEIGHT(out);
+  if (!state->converter->process(src, dst, state->pool.get())) {
+    LOG_ERROR(kConvertScaleElement, ": frame does not match the negotiated sizes");
+    return GST_FLOW_ERROR;
+  }
+  return GST_FLOW_OK;
+}
+
+void ve_convert_scale_finalize(GObject* object) {
+  delete reinterpret_cast<VeConvertScale*>(object)->state;
+  G_OBJECT_CLASS(ve_convert_scale_parent_class)->finalize(object);
+}
+
+void ve_convert_scale_class_init(VeConvertScaleClass* klass) {
+  G_OBJECT_CLASS(klass)->finalize = ve_convert_scale_finalize;
+
+  GstElementClass* element_class = GST_ELEMENT_CLASS(klass);
+  gst_element_class_set_static_metadata(element_class, "Fused colour convert and scale",
+                                        "Filter/Converter/Video/Scaler",
+                                        "Bilinear scaling and packed RGB to I420 conversion in one pass",
+                                        "video_engine");
+  gst_element_class_add_static_pad_template(element_class, &sink_template);
+  gst_element_class_add_static_pad_template(element_class, &src_template);
+
+  GstBaseTransformClass* trans_class = GST_BASE_TRANSFORM_CLASS(klass);
+  trans_class->transform_caps = transform_caps;
+  trans_class->fixate_caps = fixate_caps;
+
+  GstVideoFilterClass* filter_class = GST_VIDEO_FILTER_CLASS(klass);
+  filter_class->set_info = set_info;
+  filter_class->transform_frame = transform_frame;
+}
+
+void ve_convert_scale_init(VeConvertScale* self) { self->state = new ConvertScaleState(); }
+
+}  // namespace
+
+namespace ve {
+
+bool register_convert_scale_element() {
+  static const bool registered =
+      gst_element_register(nullptr, kConvertScaleElement, GST_RANK_NONE, ve_convert_scale_get_type());
+  if (!registered) LOG_WARN("Failed to register ", kConvertScaleElement, "; using videoscale + videoconvert");
+  return registered;
+}
+
+}  // namespace ve
@@ -0,0 +1,33 @@
+#include "cpu_features.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VE_CPU_X86 1
+#endif
+
+namespace ve {
+
+// CPUID is read once by the compiler runtime; kernels for a level are only
+// compiled in on x86, so elsewhere only the portable one qualifies.
+bool cpu_supports(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::Scalar: return true;
+#ifdef VE_CPU_X86
+    case SimdLevel::Sse2: return __builtin_cpu_supports("sse2");
+    case SimdLevel::Ssse3: return __builtin_cpu_supports("ssse3");
+    case SimdLevel::Avx2: return __builtin_cpu_supports("avx2");
+#endif
+    default: return false;
+  }
+}
+
+const char* simd_level_name(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::Sse2: return "sse2";
+    case SimdLevel::Ssse3: return "ssse3";
+    case SimdLevel::Avx2: return "avx2";
+  }
+  return "unknown";
+}
+
+}  // namespace ve
@@ -0,0 +1,151 @@
+#include "encoder_load_stage.h"
+#include "logger.h"
+
+#include <gst/gst.h>
+
+#include <algorithm>
+
+namespace {
+
+using namespace ve;
+
+// Frames in flight inside the encoder; x264 with zerolatency holds none, so
+// anything beyond this is a frame the encoder discarded.
+constexpr std::size_t kMaxInFlight = 64;
+
+void on_queue_overrun(GstElement*, gpointer user_data) {
+  static_cast<EncoderLoadStage*>(user_data)->on_overrun();
+}
+
+GstPadProbeReturn on_encoder_sink(GstPad*, GstPadProbeInfo* info, gpointer user_data) {
+  GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+  static_cast<EncoderLoadStage*>(user_data)->on_encoder_input(GST_BUFFER_PTS(buffer));
+  return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn on_encoder_src(GstPad*, GstPadProbeInfo* info, gpointer user_data) {
+  GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+  static_cast<EncoderLoadStage*>(user_data)->on_encoder_output(GST_BUFFER_PTS(buffer));
+  return GST_PAD_PROBE_OK;
+}
+
+gboolean on_timer(gpointer user_data) {
+  return static_cast<EncoderLoadStage*>(user_data)->on_tick() ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+}  // namespace
+
+namespace ve {
+
+EncoderLoadStage::EncoderLoadStage() = default;
+EncoderLoadStage::~EncoderLoadStage() { detach(); }
+
+bool EncoderLoadStage::attach(GstElement* queue, GstElement* encoder, const OverloadConfig& cfg,
+                              LevelCallback on_level) {
+  detach();
+  if (!queue || !encoder) return false;
+  sink_pad_ = gst_element_get_static_pad(encoder, "sink");
+  src_pad_ = gst_element_get_static_pad(encoder, "src");
+  if (!sink_pad_ || !src_pad_) {
+    LOG_ERROR("Encoder load: encoder pads unavailable");
+    detach();
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    detector_ = OverloadDetector(cfg);
+    on_level_ = std::move(on_level);
+    in_flight_.clear();
+    sample_ = {};
+    max_encode_ms_ = 0.0;
+    window_start_ = Clock::now();
+  }
+  // "overrun" is only emitted by non-silent queues.
+  g_object_set(queue, "silent", FALSE, NULL);
+  queue_ = GST_ELEMENT(gst_object_ref(queue));
+  overrun_id_ = g_signal_connect(queue_, "overrun", G_CALLBACK(on_queue_overrun), this);
+  input_probe_id_ = gst_pad_add_probe(sink_pad_, GST_PAD_PROBE_TYPE_BUFFER, on_encoder_sink, this, nullptr);
+  output_probe_id_ = gst_pad_add_probe(src_pad_, GST_PAD_PROBE_TYPE_BUFFER, on_encoder_src, this, nullptr);
+  timer_id_ = g_timeout_add(1000, on_timer, this);
+  LOG_INFO("Encoder load: stepping down above ", static_cast<int>(cfg.high_usage * 100),
+           "% encoder usage or ", cfg.max_drop_ratio * 100, "% queue drops");
+  return overrun_id_ != 0 && input_probe_id_ != 0 && output_probe_id_ != 0;
+}
+
+void EncoderLoadStage::detach() {
+  if (timer_id_ != 0) g_source_remove(timer_id_);
+  if (queue_) {
+    if (overrun_id_ != 0) g_signal_handler_disconnect(queue_, overrun_id_);
+    gst_object_unref(queue_);
+    LOG_INFO("Encoder load: ", total_dropped_, " frames dropped before the encoder, ", switches_,
+             " CPU level switches");
+  }
+  if (sink_pad_) {
+    if (input_probe_id_ != 0) gst_pad_remove_probe(sink_pad_, input_probe_id_);
+    gst_object_unref(sink_pad_);
+  }
+  if (src_pad_) {
+    if (output_probe_id_ != 0) gst_pad_remove_probe(src_pad_, output_probe_id_);
+    gst_object_unref(src_pad_);
+  }
+  queue_ = nullptr;
+  sink_pad_ = src_pad_ = nullptr;
+  overrun_id_ = input_probe_id_ = output_probe_id_ = 0;
+  timer_id_ = 0;
+}
+
+void EncoderLoadStage::on_overrun() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  ++sample_.dropped;
+}
+
+void EncoderLoadStage::on_encoder_input(std::uint64_t pts) {
+  const auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (in_flight_.size() >= kMaxInFlight) in_flight_.pop_front();
+  in_flight_.emplace_back(pts, now);
+}
+
+void EncoderLoadStage::on_encoder_output(std::uint64_t pts) {
+  const auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(mtx_);
+  // Output keeps input order (no B-frames); older entries were discarded.
+  const auto it = std::find_if(in_flight_.begin(), in_flight_.end(), [&](const auto& f) { return f.first == pts; });
+  if (it == in_flight_.end()) return;
+  in_flight_.erase(in_flight_.begin(), it);
+  const double ms = std::chrono::duration<double, std::milli>(now - in_flight_.front().second).count();
+  in_flight_.pop_front();
+  ++sample_.frames;
+  sample_.busy_ms += ms;
+  max_encode_ms_ = std::max(max_encode_ms_, ms);
+}
+
+bool EncoderLoadStage::on_tick() {
+  const auto now = Clock::now();
+  LevelCallback notify;
+  CpuLevel level;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    sample_.window = std::chrono::duration_cast<std::chrono::milliseconds>(now - window_start_);
+    const bool changed = detector_.update(sample_, now);
+    LOG_DEBUG("Encoder load: usage ", static_cast<int>(detector_.usage() * 100), "%, ", sample_.frames,
+              " frames, ", sample_.dropped, " dropped, encode mean ",
+              sample_.frames > 0 ? sample_.busy_ms / sample_.frames : 0.0, " ms max ", max_encode_ms_, " ms");
+    if (changed) {
+      level = detector_.level();
+      notify = on_level_;
+      ++switches_;
+      LOG_INFO("Encoder load: usage ", static_cast<int>(detector_.usage() * 100), "%, ", sample_.dropped,
+               " queue drops -> CPU level ", detector_.level_index(), "/", detector_.levels() - 1,
+               " (scale ", level.scale, ", fps /", level.fps_divisor, ")");
+    }
+    total_dropped_ += static_cast<std::uint64_t>(sample_.dropped);
+    sample_ = {};
+    max_encode_ms_ = 0.0;
+    window_start_ = now;
+  }
+  if (notify) notify(level);
+  return true;
+}
+
+}  // namespace ve
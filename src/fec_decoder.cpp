@@ -0,0 +1,197 @@
+#include "fec_decoder.h"
+
+#include <algorithm>
+
+namespace {
+
+std::int16_t seq_diff(std::uint16_t a, std::uint16_t b) {
+  return static_cast<std::int16_t>(static_cast<std::uint16_t>(a - b));
+}
+
+std::uint16_t round_up_pow2(std::uint16_t v) {
+  std::uint16_t p = 16;
+  while (p < v && p < 0x8000) p = static_cast<std::uint16_t>(p << 1);
+  return p;
+}
+
+}  // namespace
+
+namespace ve {
+
+FecStreamDecoder::FecStreamDecoder(FecDecoderConfig cfg) : cfg_(cfg) {
+  cfg_.window = round_up_pow2(cfg_.window);
+  mask_ = static_cast<std::uint16_t>(cfg_.window - 1);
+  slots_.resize(cfg_.window);
+  scratch_.reserve(kRtpFecMaxMask);
+}
+
+bool FecStreamDecoder::has(std::uint16_t seq) const {
+  const Slot& s = slot(seq);
+  return s.present && s.seq == seq;
+}
+
+void FecStreamDecoder::store(std::uint16_t seq, std::span<const std::uint8_t> data,
+                             Clock::time_point now) {
+  Slot& s = slot(seq);
+  s.data.assign(data.begin(), data.end());
+  s.arrival = now;
+  s.seq = seq;
+  s.present = true;
+  if (seq_diff(seq, highest_) > 0) highest_ = seq;
+}
+
+void FecStreamDecoder::advance_to(std::uint16_t seq) {
+  while (seq_diff(seq, head_) > 0) {
+    if (has(head_)) {
+      overflow_.push_back(slot(head_).data);
+    } else {
+      ++stats_.lost;
+    }
+    ++head_;
+  }
+}
+
+void FecStreamDecoder::push_media(std::span<const std::uint8_t> rtp, Clock::time_point now) {
+  RtpHeader h;
+  if (!parse_rtp_header(rtp, h)) return;
+  if (!started_) {
+    head_ = h.seq;
+    highest_ = static_cast<std::uint16_t>(h.seq - 1);
+    started_ = true;
+  }
+  const int d = seq_diff(h.seq, head_);
+  if (d < 0) {
+    ++stats_.late;
+    return;
+  }
+  if (has(h.seq)) {
+    ++stats_.duplicates;
+    return;
+  }
+  if (d >= cfg_.window) advance_to(static_cast<std::uint16_t>(h.seq - cfg_.window + 1));
+
+  store(h.seq, rtp, now);
+  ++stats_.received;
+  repair_from(h.seq, now);
+}
+
+void FecStreamDecoder::push_fec(std::span<const std::uint8_t> fec, Clock::time_point now) {
+  PendingFec entry;
+  entry.data.assign(fec.begin(), fec.end());
+  if (!parse_rtp_fec(entry.data, entry.header)) return;
+  fec_.push_back(std::move(entry));
+  if (fec_.size() > cfg_.max_fec_packets) fec_.pop_front();
+
+  const PendingFec& added = fec_.back();
+  if (!started_) return;
+  switch (try_repair(added, now)) {
+    case Repair::Pending:
+      return;
+    case Repair::Done:
+      fec_.pop_back();
+      return;
+    case Repair::Repaired: {
+      const std::uint16_t base = added.header.sn_base;
+      fec_.pop_back();
+      repair_from(base, now);
+      return;
+    }
+  }
+}
+
+FecStreamDecoder::Repair FecStreamDecoder::try_repair(const PendingFec& fec,
+                                                      Clock::time_point now) {
+  const RtpFecHeader& h = fec.header;
+  scratch_.clear();
+  int missing = 0;
+  int useful_missing = 0;
+  bool any_ahead = false;
+  std::uint16_t target = 0;
+  for (std::uint16_t off = 0; off < kRtpFecMaxMask; ++off) {
+    if (!((h.mask >> (kRtpFecMaxMask - 1 - off)) & 1u)) continue;
+    const std::uint16_t seq = static_cast<std::uint16_t>(h.sn_base + off);
+    const bool ahead = seq_diff(seq, head_) >= 0;
+    any_ahead = any_ahead || ahead;
+    if (has(seq)) {
+      scratch_.push_back(slot(seq).data);
+      continue;
+    }
+    ++missing;
+    if (ahead && seq_diff(seq, head_) < cfg_.window) {
+      ++useful_missing;
+      target = seq;
+    }
+  }
+  if (missing == 0 || !any_ahead) return Repair::Done;
+  if (missing > 1 || useful_missing != 1) return Repair::Pending;
+
+  const auto rec = rtp_fec_recover(scratch_, h);
+  RtpHeader rh;
+  if (rec.empty() || !parse_rtp_header(rec, rh) || rh.seq != target) return Repair::Done;
+  store(target, rec, now);
+  ++stats_.recovered;
+  return Repair::Repaired;
+}
+
+void FecStreamDecoder::repair_from(std::uint16_t trigger, Clock::time_point now) {
+  bool filtered = true;
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (auto it = fec_.begin(); it != fec_.end();) {
+      if (filtered && !it->header.covers(trigger)) {
+        ++it;
+        continue;
+      }
+      const Repair r = try_repair(*it, now);
+      if (r == Repair::Pending) {
+        ++it;
+        continue;
+      }
+      progress = progress || r == Repair::Repaired;
+      it = fec_.erase(it);
+    }
+    filtered = false;
+  }
+}
+
+const FecStreamDecoder::Slot* FecStreamDecoder::first_after_head() const {
+  for (std::uint16_t seq = static_cast<std::uint16_t>(head_ + 1); seq_diff(seq, highest_) <= 0;
+       ++seq) {
+    if (has(seq)) return &slot(seq);
+  }
+  return nullptr;
+}
+
+bool FecStreamDecoder::pop(std::vector<std::uint8_t>& out, Clock::time_point now) {
+  if (!overflow_.empty()) {
+    out.swap(overflow_.front());
+    overflow_.pop_front();
+    return true;
+  }
+  if (!started_) return false;
+  while (seq_diff(highest_, head_) >= 0) {
+    if (has(head_)) {
+      out.assign(slot(head_).data.begin(), slot(head_).data.end());
+      ++head_;
+      return true;
+    }
+    const Slot* next = first_after_head();
+    if (next && now < next->arrival + cfg_.hold) return false;
+    ++stats_.lost;
+    ++head_;
+  }
+  return false;
+}
+
+bool FecStreamDecoder::next_deadline(Clock::time_point& out) const {
+  if (!started_ || !overflow_.empty() || has(head_) || seq_diff(highest_, head_) < 0) {
+    return false;
+  }
+  const Slot* next = first_after_head();
+  if (!next) return false;
+  out = next->arrival + cfg_.hold;
+  return true;
+}
+
+}  // namespace ve
@@ -0,0 +1,107 @@
+#include "fec_stage.h"
+#include "logger.h"
+
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+
+namespace {
+
+using namespace ve;
+
+bool feed_buffer(GstBuffer* buf, XorFecStage* stage) {
+  GstMapInfo map;
+  if (!gst_buffer_map(buf, &map, GST_MAP_READ)) return false;
+  stage->on_media_packet(std::span<const std::uint8_t>(map.data, map.size));
+  gst_buffer_unmap(buf, &map);
+  return true;
+}
+
+GstPadProbeReturn on_pay_output(GstPad*, GstPadProbeInfo* info, gpointer user_data) {
+  auto* stage = static_cast<XorFecStage*>(user_data);
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    feed_buffer(GST_PAD_PROBE_INFO_BUFFER(info), stage);
+  } else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList* list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+    const guint n = gst_buffer_list_length(list);
+    for (guint i = 0; i < n; ++i) feed_buffer(gst_buffer_list_get(list, i), stage);
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+}  // namespace
+
+namespace ve {
+
+XorFecStage::XorFecStage() = default;
+XorFecStage::~XorFecStage() { detach(); }
+
+bool XorFecStage::attach(GstElement* pay, GstElement* fec_src, const UepFecConfig& cfg) {
+  detach();
+  if (!pay || !fec_src) return false;
+  encoder_ = std::make_unique<UepFecEncoder>(cfg);
+  encoder_->set_sink([this](std::span<const std::uint8_t> fec) { push_parity(fec); });
+  percentage_.store(cfg.percentage[static_cast<int>(H264Priority::NonIdr)]);
+
+  GstCaps* caps = gst_caps_new_simple("application/x-rtp",
+                                      "media", G_TYPE_STRING, "video",
+                                      "clock-rate", G_TYPE_INT, 90000,
+                                      "encoding-name", G_TYPE_STRING, "ULPFEC",
+                                      NULL);
+  g_object_set(fec_src,
+               "caps", caps,
+               "is-live", TRUE,
+               "format", GST_FORMAT_TIME,
+               "do-timestamp", TRUE,
+               NULL);
+  gst_caps_unref(caps);
+
+  pad_ = gst_element_get_static_pad(pay, "src");
+  if (!pad_) {
+    LOG_ERROR("XOR FEC: payloader has no src pad");
+    return false;
+  }
+  fec_src_ = GST_ELEMENT(gst_object_ref(fec_src));
+  probe_id_ = gst_pad_add_probe(
+      pad_, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+      on_pay_output, this, nullptr);
+  LOG_INFO("XOR FEC stage attached: non-idr ", cfg.percentage[0], "% idr ", cfg.percentage[1],
+           "% param-set ", cfg.percentage[2], "%");
+  return probe_id_ != 0;
+}
+
+void XorFecStage::detach() {
+  if (pad_) {
+    if (probe_id_ != 0) gst_pad_remove_probe(pad_, probe_id_);
+    gst_object_unref(pad_);
+  }
+  if (fec_src_) gst_object_unref(fec_src_);
+  pad_ = nullptr;
+  fec_src_ = nullptr;
+  probe_id_ = 0;
+}
+
+void XorFecStage::set_percentage(int percentage) { percentage_.store(percentage); }
+
+void XorFecStage::set_interleave(int depth) { interleave_.store(depth); }
+
+void XorFecStage::on_media_packet(std::span<const std::uint8_t> rtp) {
+  const int pct = percentage_.load(std::memory_order_relaxed);
+  if (pct != encoder_->percentage(H264Priority::NonIdr)) {
+    encoder_->set_percentage(H264Priority::NonIdr, pct);
+  }
+  const int depth = interleave_.load(std::memory_order_relaxed);
+  if (depth != encoder_->interleave()) {
+    encoder_->set_interleave(static_cast<std::uint16_t>(depth));
+  }
+  encoder_->add(rtp);
+}
+
+void XorFecStage::push_parity(std::span<const std::uint8_t> fec) {
+  GstBuffer* buf = gst_buffer_new_allocate(nullptr, fec.size(), nullptr);
+  gst_buffer_fill(buf, 0, fec.data(), fec.size());
+  if (gst_app_src_push_buffer(GST_APP_SRC(fec_src_), buf) != GST_FLOW_OK) {
+    LOG_DEBUG("XOR FEC: appsrc refused parity packet");
+  }
+}
+
+}  // namespace ve
@@ -0,0 +1,237 @@
+#include "frame_diff.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VE_HASH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using namespace ve;
+
+constexpr std::size_t kChunk = 32;  // four 8-byte words, one per lane
+// Per-lane starting keys and the per-chunk increment (odd, so keys never repeat within a block).
+constexpr std::uint64_t kKeys[4] = {0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull,
+                                    0xD6E8FEB86659FD93ull};
+constexpr std::uint64_t kKeyStep = 0xA0761D6478BD642Full;
+
+// Accumulates full chunks of every row into acc; returns false if it did
+// not run (the caller falls back to hash_scalar).
+using HashFn = bool (*)(const std::uint8_t*, std::size_t, std::size_t, int, std::uint64_t*);
+
+inline std::uint64_t load64(const std::uint8_t* p) {
+  std::uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline std::uint64_t mix64(std::uint64_t h) {
+  h ^= h >> 30;
+  h *= 0xBF58476D1CE4E5B9ull;
+  h ^= h >> 27;
+  h *= 0x94D049BB133111EBull;
+  return h ^ (h >> 31);
+}
+
+// Word j of a row goes to lane j % 4 with key kKeys[lane] + k * kKeyStep,
+// k counting chunks from the top-left of the block. Each lane adds
+// lo32(d ^ key) * hi32(d ^ key) and the neighbouring lane adds d itself.
+bool hash_scalar(const std::uint8_t* data, std::size_t stride, std::size_t row_bytes, int rows, std::uint64_t* acc) {
+  const std::size_t words = (row_bytes + 7) / 8;
+  std::uint64_t k = 0;
+  for (int r = 0; r < rows; ++r) {
+    const std::uint8_t* p = data + static_cast<std::size_t>(r) * stride;
+    for (std::size_t j = 0; j < words; j += 4, ++k) {
+      for (std::size_t lane = 0; lane < 4 && j + lane < words; ++lane) {
+        const std::size_t off = (j + lane) * 8;
+        std::uint64_t d = 0;
+        if (off + 8 <= row_bytes) {
+          d = load64(p + off);
+        } else {
+          std::memcpy(&d, p + off, row_bytes - off);
+        }
+        const std::uint64_t dk = d ^ (kKeys[lane] + k * kKeyStep);
+        acc[lane] += (dk & 0xFFFFFFFFull) * (dk >> 32);
+        acc[lane ^ 1] += d;
+      }
+    }
+  }
+  return true;
+}
+
+bool hash_none(const std::uint8_t*, std::size_t, std::size_t, int, std::uint64_t*) { return false; }
+
+#ifdef VE_HASH_X86
+
+__attribute__((target("sse2")))
+bool hash_sse2(const std::uint8_t* data, std::size_t stride, std::size_t row_bytes, int rows, std::uint64_t* acc) {
+  if (row_bytes % kChunk != 0) return false;
+  const __m128i step = _mm_set1_epi64x(static_cast<long long>(kKeyStep));
+  __m128i key01 = _mm_set_epi64x(static_cast<long long>(kKeys[1]), static_cast<long long>(kKeys[0]));
+  __m128i key23 = _mm_set_epi64x(static_cast<long long>(kKeys[3]), static_cast<long long>(kKeys[2]));
+  __m128i acc01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc));
+  __m128i acc23 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + 2));
+  for (int r = 0; r < rows; ++r) {
+    const std::uint8_t* p = data + static_cast<std::size_t>(r) * stride;
+    for (std::size_t off = 0; off < row_bytes; off += kChunk) {
+      const __m128i d01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + off));
+      const __m128i d23 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + off + 16));
+      const __m128i dk01 = _mm_xor_si128(d01, key01);
+      const __m128i dk23 = _mm_xor_si128(d23, key23);
+      acc01 = _mm_add_epi64(acc01, _mm_mul_epu32(dk01, _mm_srli_epi64(dk01, 32)));
+      acc23 = _mm_add_epi64(acc23, _mm_mul_epu32(dk23, _mm_srli_epi64(dk23, 32)));
+      acc01 = _mm_add_epi64(acc01, _mm_shuffle_epi32(d01, _MM_SHUFFLE(1, 0, 3, 2)));
+      acc23 = _mm_add_epi64(acc23, _mm_shuffle_epi32(d23, _MM_SHUFFLE(1, 0, 3, 2)));
+      key01 = _mm_add_epi64(key01, step);
+      key23 = _mm_add_epi64(key23, step);
+    }
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(acc), acc01);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + 2), acc23);
+  return true;
+}
+
+__attribute__((target("avx2")))
+bool hash_avx2(const std::uint8_t* data, std::size_t stride, std::size_t row_bytes, int rows, std::uint64_t* acc) {
+  if (row_bytes % kChunk != 0) return false;
+  const __m256i step = _mm256_set1_epi64x(static_cast<long long>(kKeyStep));
+  __m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kKeys));
+  __m256i sum = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc));
+  for (int r = 0; r < rows; ++r) {
+    const std::uint8_t* p = data + static_cast<std::size_t>(r) * stride;
+    for (std::size_t off = 0; off < row_bytes; off += kChunk) {
+      const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + off));
+      const __m256i dk = _mm256_xor_si256(d, key);
+      sum = _mm256_add_epi64(sum, _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32)));
+      sum = _mm256_add_epi64(sum, _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+      key = _mm256_add_epi64(key, step);
+    }
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc), sum);
+  return true;
+}
+
+#endif  // VE_HASH_X86
+
+constexpr KernelEntry<HashFn> kKernels[] = {
+#ifdef VE_HASH_X86
+    {SimdLevel::Avx2, hash_avx2},
+    {SimdLevel::Sse2, hash_sse2},
+#endif
+    {SimdLevel::Scalar, hash_none},
+};
+
+KernelDispatch<HashFn>& dispatch() {
+  static KernelDispatch<HashFn> d(kKernels);
+  return d;
+}
+
+bool same_layout(const std::vector<PlaneView>& a, const std::vector<PlaneView>& b) {
+  if (a.size() != b.size()) return false;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if (a[i].row_bytes != b[i].row_bytes || a[i].rows != b[i].rows) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+namespace ve {
+
+HashKernel hash_kernel() { return dispatch().level(); }
+bool hash_kernel_supported(HashKernel kernel) { return dispatch().supports(kernel); }
+bool set_hash_kernel(HashKernel kernel) { return dispatch().select(kernel); }
+const char* hash_kernel_name(HashKernel kernel) { return simd_level_name(kernel); }
+
+std::uint64_t hash_rows(const std::uint8_t* data, std::size_t stride, std::size_t row_bytes, int rows) {
+  std::uint64_t acc[4] = {0, 0, 0, 0};
+  if (!dispatch().table()(data, stride, row_bytes, rows, acc)) {
+    hash_scalar(data, stride, row_bytes, rows, acc);
+  }
+  std::uint64_t h = mix64(row_bytes * 0x100000001B3ull ^ static_cast<std::uint64_t>(rows));
+  for (std::uint64_t a : acc) h = mix64(h ^ a);
+  return h;
+}
+
+BlockChangeDetector::BlockChangeDetector(std::size_t block_bytes, int block_rows)
+    : block_bytes_(std::max<std::size_t>(block_bytes, 8)), block_rows_(std::max(block_rows, 1)) {}
+
+void BlockChangeDetector::reset() {
+  layout_.clear();
+  hashes_.clear();
+}
+
+int BlockChangeDetector::update(const std::vector<PlaneView>& frame) {
+  const bool fresh = !same_layout(frame, layout_);
+  if (fresh) {
+    layout_ = frame;
+    hashes_.clear();
+  }
+  int changed = 0;
+  std::size_t index = 0;
+  for (const PlaneView& plane : frame) {
+    for (int y = 0; y < plane.rows; y += block_rows_) {
+      const int rows = std::min(block_rows_, plane.rows - y);
+      const std::uint8_t* row = plane.data + static_cast<std::size_t>(y) * plane.stride;
+      for (std::size_t x = 0; x < plane.row_bytes; x += block_bytes_, ++index) {
+        const std::uint64_t h = hash_rows(row + x, plane.stride, std::min(block_bytes_, plane.row_bytes - x), rows);
+        if (fresh) {
+          hashes_.push_back(h);
+          ++changed;
+        } else if (hashes_[index] != h) {
+          hashes_[index] = h;
+          ++changed;
+        }
+      }
+    }
+  }
+  return changed;
+}
+
+StaticFrameGate::StaticFrameGate(StaticContentConfig cfg) : cfg_(cfg) {}
+
+bool StaticFrameGate::admit(bool changed, Clock::time_point now) {
+  ++frames_;
+  // The encoder opens with a keyframe.
+  if (!have_keyframe_) keyframe(now);
+  // Only skipped frames leave the encoder's frame count behind wall time.
+  if (cfg_.keyframe_interval.count() > 0 && skipped_since_keyframe_ &&
+      now - last_keyframe_ >= cfg_.keyframe_interval) {
+    keyframe(now);
+    key_due_ = true;
+    force_ = true;
+    ++forced_keyframes_;
+  }
+  if (changed) {
+    settle_left_ = cfg_.settle_frames;
+  } else if (!force_ && settle_left_ > 0) {
+    --settle_left_;
+  } else if (!force_ && have_forwarded_ && now - last_forwarded_ < cfg_.refresh) {
+    ++skipped_;
+    skipped_since_keyframe_ = true;
+    return false;
+  } else if (!force_) {
+    ++refreshes_;
+  }
+  force_ = false;
+  have_forwarded_ = true;
+  last_forwarded_ = now;
+  return true;
+}
+
+void StaticFrameGate::keyframe(Clock::time_point now) {
+  last_keyframe_ = now;
+  have_keyframe_ = true;
+  skipped_since_keyframe_ = false;
+}
+
+bool StaticFrameGate::take_key_unit() {
+  const bool due = key_due_;
+  key_due_ = false;
+  return due;
+}
+
+}  // namespace ve
@@ -0,0 +1,86 @@
+#include "frame_latency.h"
+
+#include <algorithm>
+
+namespace {
+
+using namespace ve;
+
+// Frames the encoder may have handed out but not yet fully sent; x264 with
+// zerolatency keeps at most one per strip in flight.
+constexpr std::size_t kMaxPending = 64;
+
+double percentile(std::vector<double>& values, double q) {
+  if (values.empty()) return 0.0;
+  const auto nth = values.begin() + static_cast<std::ptrdiff_t>(q * static_cast<double>(values.size() - 1) + 0.5);
+  std::nth_element(values.begin(), nth, values.end());
+  return *nth;
+}
+
+double ms_between(FrameLatencyTracker::Clock::time_point from, FrameLatencyTracker::Clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+}  // namespace
+
+namespace ve {
+
+FrameLatencyTracker::FrameLatencyTracker(int streams) : streams_(std::max(streams, 1)) {}
+
+void FrameLatencyTracker::on_encoded(std::uint64_t pts, Clock::time_point captured) {
+  if (std::any_of(pending_.begin(), pending_.end(), [&](const Frame& f) { return f.pts == pts; })) return;
+  if (pending_.size() >= kMaxPending) {
+    pending_.pop_front();
+    ++incomplete_;
+    ++total_incomplete_;
+  }
+  Frame frame;
+  frame.pts = pts;
+  frame.captured = captured;
+  pending_.push_back(frame);
+  if (have_capture_ && captured > last_capture_) interval_ms_.push_back(ms_between(last_capture_, captured));
+  last_capture_ = captured;
+  have_capture_ = true;
+}
+
+void FrameLatencyTracker::on_packet(std::uint64_t pts, bool marker, Clock::time_point now) {
+  const auto it = std::find_if(pending_.begin(), pending_.end(), [&](const Frame& f) { return f.pts == pts; });
+  if (it == pending_.end()) return;
+  if (!it->sent) {
+    it->sent = true;
+    it->first = now;
+  }
+  if (marker && ++it->markers >= streams_) {
+    finish(*it, now);
+    pending_.erase(it);
+  }
+}
+
+void FrameLatencyTracker::finish(const Frame& frame, Clock::time_point last) {
+  const double first = ms_between(frame.captured, frame.first);
+  const double whole = ms_between(frame.captured, last);
+  first_ms_.push_back(first);
+  last_ms_.push_back(whole);
+  ++total_frames_;
+  total_first_ms_ += first;
+  total_last_ms_ += whole;
+}
+
+LatencySummary FrameLatencyTracker::take_window() {
+  LatencySummary s;
+  s.frames = static_cast<int>(first_ms_.size());
+  s.incomplete = incomplete_;
+  s.first_p50 = percentile(first_ms_, 0.50);
+  s.first_p95 = percentile(first_ms_, 0.95);
+  s.first_max = first_ms_.empty() ? 0.0 : *std::max_element(first_ms_.begin(), first_ms_.end());
+  s.last_p50 = percentile(last_ms_, 0.50);
+  s.last_p95 = percentile(last_ms_, 0.95);
+  s.interval_p50 = percentile(interval_ms_, 0.50);
+  first_ms_.clear();
+  last_ms_.clear();
+  interval_ms_.clear();
+  incomplete_ = 0;
+  return s;
+}
+
+}  // namespace ve
@@ -0,0 +1,258 @@
+#include "gcc_bwe.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using namespace ve;
+
+constexpr double kOverusingTimeThresholdMs = 10.0;
+constexpr int kMinNumDeltas = 60;
+constexpr double kMaxAdaptOffsetMs = 15.0;
+constexpr double kThresholdUp = 0.0087;
+constexpr double kThresholdDown = 0.039;
+constexpr double kBetaDecrease = 0.85;
+constexpr double kPacketKbits = 1200 * 8 / 1000.0;
+
+constexpr auto kGroupLength = std::chrono::milliseconds(5);
+constexpr auto kBurstDelta = std::chrono::milliseconds(5);
+constexpr auto kMaxBurstDuration = std::chrono::milliseconds(100);
+constexpr auto kAckedWindow = std::chrono::milliseconds(500);
+constexpr auto kMinAckedSpan = std::chrono::milliseconds(100);
+
+double to_ms(std::chrono::microseconds d) { return d.count() / 1000.0; }
+
+double to_ms(std::chrono::steady_clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+// Least-squares slope of y over x.
+double linear_fit_slope(const std::deque<std::pair<double, double>>& points, double fallback) {
+  double sum_x = 0.0, sum_y = 0.0;
+  for (const auto& [x, y] : points) {
+    sum_x += x;
+    sum_y += y;
+  }
+  const double mean_x = sum_x / points.size();
+  const double mean_y = sum_y / points.size();
+  double num = 0.0, den = 0.0;
+  for (const auto& [x, y] : points) {
+    num += (x - mean_x) * (y - mean_y);
+    den += (x - mean_x) * (x - mean_x);
+  }
+  return den != 0.0 ? num / den : fallback;
+}
+
+}  // namespace
+
+namespace ve {
+
+const char* bandwidth_usage_name(BandwidthUsage usage) {
+  switch (usage) {
+    case BandwidthUsage::Normal: return "normal";
+    case BandwidthUsage::Underusing: return "underusing";
+    case BandwidthUsage::Overusing: return "overusing";
+  }
+  return "unknown";
+}
+
+TrendlineEstimator::TrendlineEstimator(const GccConfig& cfg)
+    : window_(std::max<std::size_t>(cfg.trendline_window, 2)),
+      smoothing_(cfg.smoothing),
+      threshold_gain_(cfg.threshold_gain) {}
+
+BandwidthUsage TrendlineEstimator::update(double recv_delta_ms, double send_delta_ms,
+                                          double arrival_ms) {
+  num_deltas_ = std::min(num_deltas_ + 1, 1000);
+  if (first_arrival_ms_ < 0.0) first_arrival_ms_ = arrival_ms;
+
+  accumulated_delay_ += recv_delta_ms - send_delta_ms;
+  smoothed_delay_ = smoothing_ * smoothed_delay_ + (1.0 - smoothing_) * accumulated_delay_;
+  history_.emplace_back(arrival_ms - first_arrival_ms_, smoothed_delay_);
+  if (history_.size() > window_) history_.pop_front();
+
+  double trend = prev_trend_;
+  if (history_.size() == window_) trend = linear_fit_slope(history_, prev_trend_);
+  detect(trend, send_delta_ms, arrival_ms);
+  return state_;
+}
+
+void TrendlineEstimator::detect(double trend, double send_delta_ms, double now_ms) {
+  if (num_deltas_ < 2) {
+    state_ = BandwidthUsage::Normal;
+    return;
+  }
+  const double modified_trend = std::min(num_deltas_, kMinNumDeltas) * trend * threshold_gain_;
+  prev_modified_trend_ = modified_trend;
+
+  if (modified_trend > threshold_) {
+    // Overuse only once the trend has stayed above threshold for a while and
+    // is not already falling.
+    time_over_using_ = time_over_using_ < 0.0 ? send_delta_ms / 2 : time_over_using_ + send_delta_ms;
+    ++overuse_counter_;
+    if (time_over_using_ > kOverusingTimeThresholdMs && overuse_counter_ > 1 && trend >= prev_trend_) {
+      time_over_using_ = 0.0;
+      overuse_counter_ = 0;
+      state_ = BandwidthUsage::Overusing;
+    }
+  } else if (modified_trend < -threshold_) {
+    time_over_using_ = -1.0;
+    overuse_counter_ = 0;
+    state_ = BandwidthUsage::Underusing;
+  } else {
+    time_over_using_ = -1.0;
+    overuse_counter_ = 0;
+    state_ = BandwidthUsage::Normal;
+  }
+  prev_trend_ = trend;
+  update_threshold(modified_trend, now_ms);
+}
+
+void TrendlineEstimator::update_threshold(double modified_trend, double now_ms) {
+  if (last_threshold_update_ms_ < 0.0) last_threshold_update_ms_ = now_ms;
+  const double magnitude = std::fabs(modified_trend);
+  if (magnitude > threshold_ + kMaxAdaptOffsetMs) {
+    // Spikes (e.g. a route change) must not drag the threshold along.
+    last_threshold_update_ms_ = now_ms;
+    return;
+  }
+  const double k = magnitude < threshold_ ? kThresholdDown : kThresholdUp;
+  const double dt = std::min(now_ms - last_threshold_update_ms_, 100.0);
+  threshold_ = std::clamp(threshold_ + k * (magnitude - threshold_) * dt, 6.0, 600.0);
+  last_threshold_update_ms_ = now_ms;
+}
+
+AimdRateControl::AimdRateControl(const GccConfig& cfg)
+    : min_kbps_(cfg.min_kbps),
+      max_kbps_(std::max(cfg.max_kbps, cfg.min_kbps)),
+      target_kbps_(std::clamp<double>(cfg.start_kbps, min_kbps_, max_kbps_)) {}
+
+void AimdRateControl::set_target_kbps(int kbps) {
+  target_kbps_ = std::clamp<double>(kbps, min_kbps_, max_kbps_);
+}
+
+void AimdRateControl::update_max_estimate(double acked_kbps) {
+  constexpr double alpha = 0.05;
+  avg_max_kbps_ = avg_max_kbps_ < 0.0 ? acked_kbps : (1 - alpha) * avg_max_kbps_ + alpha * acked_kbps;
+  const double norm = std::max(avg_max_kbps_, 1.0);
+  const double err = avg_max_kbps_ - acked_kbps;
+  var_max_kbps_ = std::clamp((1 - alpha) * var_max_kbps_ + alpha * err * err / norm, 0.4, 2.5);
+}
+
+int AimdRateControl::update(BandwidthUsage usage, double acked_kbps, double rtt_ms, double now_ms) {
+  if (last_update_ms_ < 0.0) last_update_ms_ = now_ms;
+  const double dt_ms = std::clamp(now_ms - last_update_ms_, 0.0, 1000.0);
+  last_update_ms_ = now_ms;
+
+  switch (usage) {
+    case BandwidthUsage::Normal:
+      if (state_ == State::Hold) state_ = State::Increase;
+      break;
+    case BandwidthUsage::Overusing:
+      state_ = State::Decrease;
+      break;
+    case BandwidthUsage::Underusing:
+      state_ = State::Hold;  // queues are draining; let them
+      break;
+  }
+
+  double target = target_kbps_;
+  const double std_max = std::sqrt(var_max_kbps_ * std::max(avg_max_kbps_, 1.0));
+  switch (state_) {
+    case State::Hold:
+      break;
+    case State::Increase: {
+      if (avg_max_kbps_ >= 0.0 && acked_kbps > avg_max_kbps_ + 3 * std_max) avg_max_kbps_ = -1.0;
+      if (avg_max_kbps_ >= 0.0) {
+        // Near the last congestion point: about one packet per response time.
+        target += kPacketKbits * dt_ms / (rtt_ms + 100.0);
+      } else {
+        target *= std::pow(1.08, dt_ms / 1000.0);
+      }
+      // Never run far ahead of what the path is demonstrably delivering.
+      if (acked_kbps > 0.0) target = std::min(target, std::max(target_kbps_, 1.5 * acked_kbps + 10.0));
+      break;
+    }
+    case State::Decrease:
+      if (last_decrease_ms_ >= 0.0 && now_ms - last_decrease_ms_ < rtt_ms) {
+        state_ = State::Hold;  // the previous cut has not reached the queue yet
+        break;
+      }
+      target = std::min(target, kBetaDecrease * (acked_kbps > 0.0 ? acked_kbps : target));
+      if (acked_kbps > 0.0) {
+        if (avg_max_kbps_ >= 0.0 && acked_kbps < avg_max_kbps_ - 3 * std_max) avg_max_kbps_ = -1.0;
+        update_max_estimate(acked_kbps);
+      }
+      last_decrease_ms_ = now_ms;
+      state_ = State::Hold;
+      break;
+  }
+  target_kbps_ = std::clamp(target, min_kbps_, max_kbps_);
+  return target_kbps();
+}
+
+DelayBasedBwe::DelayBasedBwe(GccConfig cfg) : cfg_(cfg), trend_(cfg_), rate_(cfg_) {}
+
+void DelayBasedBwe::update_acked(const PacketResult& p) {
+  acked_.emplace_back(p.arrival, p.bytes);
+  acked_bytes_ += p.bytes;
+  while (!acked_.empty() && p.arrival - acked_.front().first > kAckedWindow) {
+    acked_bytes_ -= acked_.front().second;
+    acked_.pop_front();
+  }
+  const auto span = acked_.back().first - acked_.front().first;
+  if (span >= kMinAckedSpan) acked_kbps_ = acked_bytes_ * 8.0 / to_ms(span);
+}
+
+void DelayBasedBwe::add_packet(const PacketResult& p) {
+  auto start_group = [&] {
+    current_.first_send = current_.last_send = p.send_time;
+    current_.first_arrival = current_.last_arrival = p.arrival;
+    current_.valid = true;
+  };
+  if (!current_.valid) {
+    start_group();
+    return;
+  }
+  if (p.send_time < current_.first_send) return;  // reordered behind the group
+
+  const auto arrival_delta = p.arrival - current_.last_arrival;
+  const auto send_delta = p.send_time - current_.last_send;
+  const bool burst = send_delta == Clock::duration::zero() ||
+                     (to_ms(arrival_delta) < to_ms(send_delta) && arrival_delta <= kBurstDelta &&
+                      p.arrival - current_.first_arrival < kMaxBurstDuration);
+  if (p.send_time - current_.first_send <= kGroupLength || burst) {
+    current_.last_send = std::max(current_.last_send, p.send_time);
+    current_.last_arrival = std::max(current_.last_arrival, p.arrival);
+    return;
+  }
+
+  if (previous_.valid) {
+    trend_.update(to_ms(current_.last_arrival - previous_.last_arrival),
+                  to_ms(current_.last_send - previous_.last_send), to_ms(current_.last_arrival));
+    if (trend_.state() == BandwidthUsage::Overusing) overuse_seen_ = true;
+  }
+  previous_ = current_;
+  start_group();
+}
+
+bool DelayBasedBwe::on_feedback(std::span<const PacketResult> packets, Clock::time_point now) {
+  if (!started_) {
+    epoch_ = now;
+    started_ = true;
+  }
+  overuse_seen_ = false;
+  for (const PacketResult& p : packets) {
+    if (!p.received) continue;
+    update_acked(p);
+    add_packet(p);
+  }
+
+  // Any overuse inside this feedback wins over the state it ended in.
+  const BandwidthUsage usage = overuse_seen_ ? BandwidthUsage::Overusing : trend_.state();
+  const int before = rate_.target_kbps();
+  return rate_.update(usage, acked_kbps_, rtt_ms_, to_ms(now - epoch_)) != before;
+}
+
+}  // namespace ve
@@ -0,0 +1,167 @@
+#include "gf256.h"
+#include "xor_kernels.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VE_GF_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using namespace ve;
+
+struct Tables {
+  std::array<std::uint8_t, 512> exp{};
+  std::array<std::uint8_t, 256> log{};
+  std::array<std::array<std::uint8_t, 256>, 256> mul{};
+
+  Tables() {
+    unsigned int x = 1;
+    for (int i = 0; i < 255; ++i) {
+      exp[i] = static_cast<std::uint8_t>(x);
+      log[x] = static_cast<std::uint8_t>(i);
+      x <<= 1;
+      if (x & 0x100) x ^= 0x11d;
+    }
+    for (int i = 255; i < 512; ++i) exp[i] = exp[i - 255];
+    for (int a = 1; a < 256; ++a) {
+      for (int b = 1; b < 256; ++b) mul[a][b] = exp[log[a] + log[b]];
+    }
+  }
+};
+
+const Tables& tables() {
+  static const Tables t;
+  return t;
+}
+
+using RegionFn = void (*)(std::uint8_t*, const std::uint8_t*, std::uint8_t, std::size_t, bool);
+
+void region_scalar(std::uint8_t* dst, const std::uint8_t* src, std::uint8_t c, std::size_t len,
+                   bool add) {
+  const auto& row = tables().mul[c];
+  if (add) {
+    for (std::size_t i = 0; i < len; ++i) dst[i] ^= row[src[i]];
+  } else {
+    for (std::size_t i = 0; i < len; ++i) dst[i] = row[src[i]];
+  }
+}
+
+#ifdef VE_GF_X86
+
+// Split-nibble multiply: c*x = lo[x & 0xf] ^ hi[x >> 4], both 16-entry tables
+// looked up with PSHUFB.
+void nibble_tables(std::uint8_t c, std::uint8_t* lo, std::uint8_t* hi) {
+  const auto& row = tables().mul[c];
+  for (int i = 0; i < 16; ++i) {
+    lo[i] = row[i];
+    hi[i] = row[i << 4];
+  }
+}
+
+__attribute__((target("ssse3")))
+void region_ssse3(std::uint8_t* dst, const std::uint8_t* src, std::uint8_t c, std::size_t len,
+                  bool add) {
+  alignas(16) std::uint8_t lo_t[16];
+  alignas(16) std::uint8_t hi_t[16];
+  nibble_tables(c, lo_t, hi_t);
+  const __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(lo_t));
+  const __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(hi_t));
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  std::size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i r = _mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(x, mask)),
+                              _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(x, 4), mask)));
+    auto* d = reinterpret_cast<__m128i*>(dst + i);
+    if (add) r = _mm_xor_si128(r, _mm_loadu_si128(d));
+    _mm_storeu_si128(d, r);
+  }
+  region_scalar(dst + i, src + i, c, len - i, add);
+}
+
+__attribute__((target("avx2")))
+void region_avx2(std::uint8_t* dst, const std::uint8_t* src, std::uint8_t c, std::size_t len,
+                 bool add) {
+  alignas(16) std::uint8_t lo_t[16];
+  alignas(16) std::uint8_t hi_t[16];
+  nibble_tables(c, lo_t, hi_t);
+  const __m256i lo = _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<const __m128i*>(lo_t)));
+  const __m256i hi = _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<const __m128i*>(hi_t)));
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  std::size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i r = _mm256_xor_si256(
+        _mm256_shuffle_epi8(lo, _mm256_and_si256(x, mask)),
+        _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(x, 4), mask)));
+    auto* d = reinterpret_cast<__m256i*>(dst + i);
+    if (add) r = _mm256_xor_si256(r, _mm256_loadu_si256(d));
+    _mm256_storeu_si256(d, r);
+  }
+  region_scalar(dst + i, src + i, c, len - i, add);
+}
+
+#endif  // VE_GF_X86
+
+constexpr KernelEntry<RegionFn> kKernels[] = {
+#ifdef VE_GF_X86
+    {SimdLevel::Avx2, region_avx2},
+    {SimdLevel::Ssse3, region_ssse3},
+#endif
+    {SimdLevel::Scalar, region_scalar},
+};
+
+KernelDispatch<RegionFn>& dispatch() {
+  static KernelDispatch<RegionFn> d(kKernels);
+  return d;
+}
+
+}  // namespace
+
+namespace ve {
+
+std::uint8_t gf_mul(std::uint8_t a, std::uint8_t b) { return tables().mul[a][b]; }
+
+std::uint8_t gf_div(std::uint8_t a, std::uint8_t b) {
+  if (a == 0 || b == 0) return 0;
+  const auto& t = tables();
+  return t.exp[t.log[a] + 255 - t.log[b]];
+}
+
+std::uint8_t gf_inv(std::uint8_t a) { return gf_div(1, a); }
+
+std::uint8_t gf_exp(unsigned int power) { return tables().exp[power % 255]; }
+
+void gf_mul_region(std::uint8_t* dst, const std::uint8_t* src, std::uint8_t c, std::size_t len) {
+  if (len == 0) return;
+  if (c == 0) {
+    std::memset(dst, 0, len);
+  } else if (c == 1) {
+    if (dst != src) std::memmove(dst, src, len);
+  } else {
+    dispatch().table()(dst, src, c, len, false);
+  }
+}
+
+void gf_mul_add_region(std::uint8_t* dst, const std::uint8_t* src, std::uint8_t c,
+                       std::size_t len) {
+  if (len == 0 || c == 0) return;
+  if (c == 1) {
+    xor_into(dst, &src, 1, len);
+  } else {
+    dispatch().table()(dst, src, c, len, true);
+  }
+}
+
+GfKernel gf_kernel() { return dispatch().level(); }
+bool gf_kernel_supported(GfKernel kernel) { return dispatch().supports(kernel); }
+bool set_gf_kernel(GfKernel kernel) { return dispatch().select(kernel); }
+const char* gf_kernel_name(GfKernel kernel) { return simd_level_name(kernel); }
+
+}  // namespace ve
@@ -0,0 +1,81 @@
+#include "h264_nal.h"
+#include "rtp_fec.h"
+
+#include <algorithm>
+
+namespace {
+
+using namespace ve;
+
+H264Priority priority_of(int nal_type) {
+  switch (nal_type) {
+    case static_cast<int>(H264NalType::Sps):
+    case static_cast<int>(H264NalType::Pps):
+      return H264Priority::ParameterSet;
+    case static_cast<int>(H264NalType::IdrSlice):
+      return H264Priority::Idr;
+    default:
+      return H264Priority::NonIdr;
+  }
+}
+
+}  // namespace
+
+namespace ve {
+
+int h264_payload_nal_type(std::span<const std::uint8_t> payload) {
+  if (payload.empty()) return -1;
+  const int type = payload[0] & 0x1f;
+  if (type == static_cast<int>(H264NalType::FuA)) {
+    return payload.size() >= 2 ? (payload[1] & 0x1f) : -1;
+  }
+  if (type == static_cast<int>(H264NalType::StapA)) {
+    return payload.size() >= 4 ? (payload[3] & 0x1f) : -1;
+  }
+  return type;
+}
+
+H264Priority h264_payload_priority(std::span<const std::uint8_t> payload) {
+  if (payload.empty()) return H264Priority::NonIdr;
+  if ((payload[0] & 0x1f) != static_cast<int>(H264NalType::StapA)) {
+    return priority_of(h264_payload_nal_type(payload));
+  }
+  // STAP-A: [hdr][size16][nal]...[size16][nal]...
+  H264Priority best = H264Priority::NonIdr;
+  std::size_t off = 1;
+  while (off + 2 < payload.size()) {
+    const std::size_t size = (static_cast<std::size_t>(payload[off]) << 8) | payload[off + 1];
+    off += 2;
+    if (size == 0 || off + size > payload.size()) break;
+    best = std::max(best, priority_of(payload[off] & 0x1f));
+    off += size;
+  }
+  return best;
+}
+
+const char* h264_priority_name(H264Priority priority) {
+  switch (priority) {
+    case H264Priority::NonIdr: return "non-idr";
+    case H264Priority::Idr: return "idr";
+    case H264Priority::ParameterSet: return "param-set";
+  }
+  return "unknown";
+}
+
+std::size_t h264_packets_for_nal(std::size_t nal_bytes, std::size_t mtu) {
+  if (nal_bytes == 0) return 0;
+  const std::size_t overhead = kRtpHeaderSize + kRtpExtensionReserve;
+  const std::size_t room = std::max(mtu, overhead + 3) - overhead;
+  if (nal_bytes <= room) return 1;
+  const std::size_t fragment = room - 2;  // FU indicator + FU header
+  return (nal_bytes - 1 + fragment - 1) / fragment;
+}
+
+std::size_t h264_slice_max_size(std::size_t mtu) {
+  constexpr std::size_t kStartCode = 4;
+  constexpr std::size_t kEstimateMargin = 16;
+  const std::size_t overhead = kRtpHeaderSize + kRtpExtensionReserve + kEstimateMargin;
+  return std::max(mtu, overhead + 64) - overhead + kStartCode;
+}
+
+}  // namespace ve
@@ -0,0 +1,33 @@
+#include "keyframe_limiter.h"
+
+namespace ve {
+
+KeyframeLimiter::KeyframeLimiter(std::chrono::milliseconds min_interval)
+    : min_interval_(min_interval) {}
+
+bool KeyframeLimiter::due(Clock::time_point now) const {
+  return !have_forced_ || now - last_forced_ >= min_interval_;
+}
+
+bool KeyframeLimiter::request(Clock::time_point now) {
+  ++requests_;
+  if (!due(now)) {
+    pending_ = true;
+    return false;
+  }
+  last_forced_ = now;
+  have_forced_ = true;
+  pending_ = false;
+  ++forced_;
+  return true;
+}
+
+bool KeyframeLimiter::poll(Clock::time_point now) {
+  if (!pending_ || !due(now)) return false;
+  last_forced_ = now;
+  pending_ = false;
+  ++forced_;
+  return true;
+}
+
+}  // namespace ve
@@ -0,0 +1,113 @@
+#include "keyframe_stage.h"
+#include "logger.h"
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+namespace {
+
+using namespace ve;
+
+// Marks events the stage issues itself so its own probe lets them through.
+constexpr const char* kCoalescedField = "ve-coalesced";
+
+GstPadProbeReturn on_encoder_event(GstPad*, GstPadProbeInfo* info, gpointer user_data) {
+  GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+  if (!gst_video_event_is_force_key_unit(event)) return GST_PAD_PROBE_OK;
+  const GstStructure* s = gst_event_get_structure(event);
+  if (s && gst_structure_has_field(s, kCoalescedField)) return GST_PAD_PROBE_OK;
+  return static_cast<KeyframeStage*>(user_data)->on_key_unit_request() ? GST_PAD_PROBE_OK
+                                                                         : GST_PAD_PROBE_DROP;
+}
+
+GstPadProbeReturn on_encoder_input(GstPad*, GstPadProbeInfo*, gpointer user_data) {
+  static_cast<KeyframeStage*>(user_data)->on_frame();
+  return GST_PAD_PROBE_OK;
+}
+
+}  // namespace
+
+namespace ve {
+
+KeyframeStage::KeyframeStage() = default;
+KeyframeStage::~KeyframeStage() { detach(); }
+
+bool KeyframeStage::attach(GstElement* encoder, std::chrono::milliseconds min_interval) {
+  detach();
+  if (!encoder) return false;
+  strips_ = false;
+  return attach_pads(gst_element_get_static_pad(encoder, "src"), gst_element_get_static_pad(encoder, "sink"),
+                     min_interval);
+}
+
+bool KeyframeStage::attach_strips(GstElement* tee, GstElement* funnel, std::chrono::milliseconds min_interval) {
+  detach();
+  if (!tee || !funnel) return false;
+  strips_ = true;
+  return attach_pads(gst_element_get_static_pad(funnel, "src"), gst_element_get_static_pad(tee, "sink"),
+                     min_interval);
+}
+
+bool KeyframeStage::attach_pads(GstPad* src_pad, GstPad* sink_pad, std::chrono::milliseconds min_interval) {
+  limiter_ = KeyframeLimiter(min_interval);
+  pending_ = false;
+  src_pad_ = src_pad;
+  sink_pad_ = sink_pad;
+  if (!src_pad_ || !sink_pad_) {
+    LOG_ERROR("Keyframes: encoder pads unavailable");
+    detach();
+    return false;
+  }
+  event_probe_id_ = gst_pad_add_probe(src_pad_, GST_PAD_PROBE_TYPE_EVENT_UPSTREAM, on_encoder_event, this, nullptr);
+  buffer_probe_id_ = gst_pad_add_probe(sink_pad_, GST_PAD_PROBE_TYPE_BUFFER, on_encoder_input, this, nullptr);
+  LOG_INFO("Keyframes: PLI/FIR forced at most every ", min_interval.count(), " ms",
+           strips_ ? ", on all strips at once" : "");
+  return event_probe_id_ != 0 && buffer_probe_id_ != 0;
+}
+
+void KeyframeStage::detach() {
+  if (src_pad_) {
+    if (event_probe_id_ != 0) gst_pad_remove_probe(src_pad_, event_probe_id_);
+    gst_object_unref(src_pad_);
+  }
+  if (sink_pad_) {
+    if (buffer_probe_id_ != 0) gst_pad_remove_probe(sink_pad_, buffer_probe_id_);
+    gst_object_unref(sink_pad_);
+    LOG_INFO("Keyframes: ", limiter_.requests(), " requests, ", limiter_.forced(), " forced");
+  }
+  src_pad_ = sink_pad_ = nullptr;
+  event_probe_id_ = buffer_probe_id_ = 0;
+}
+
+bool KeyframeStage::on_key_unit_request() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  const bool forward = limiter_.request(KeyframeLimiter::Clock::now());
+  LOG_DEBUG("Keyframes: request ", forward ? "forwarded" : "coalesced");
+  if (!strips_) return forward;
+  // The funnel would hand the event to each strip on its own, and each
+  // encoder would key on whichever frame it is at.
+  pending_ = pending_ || forward;
+  return false;
+}
+
+void KeyframeStage::on_frame() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    const bool due = limiter_.poll(KeyframeLimiter::Clock::now());
+    if (!due && !pending_) return;
+    pending_ = false;
+  }
+  if (strips_) {
+    // Serialized ahead of this frame on every branch of the tee.
+    gst_pad_send_event(sink_pad_, gst_video_event_new_downstream_force_key_unit(
+                                      GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, TRUE, 0));
+    LOG_DEBUG("Keyframes: request forced on all strips");
+    return;
+  }
+  GstEvent* event = gst_video_event_new_upstream_force_key_unit(GST_CLOCK_TIME_NONE, TRUE, 0);
+  gst_structure_set(gst_event_writable_structure(event), kCoalescedField, G_TYPE_BOOLEAN, TRUE, NULL);
+  gst_pad_send_event(src_pad_, event);
+  LOG_DEBUG("Keyframes: coalesced request forced");
+}
+
+}  // namespace ve
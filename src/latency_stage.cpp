@@ -0,0 +1,188 @@
+#include "latency_stage.h"
+#include "logger.h"
+
+#include <gst/gst.h>
+#include <gst/rtp/rtp.h>
+
+#include <algorithm>
+#include <string>
+
+namespace {
+
+using namespace ve;
+
+// Reference timestamp meta carrying the steady-clock capture time in ns.
+GstStaticCaps kCaptureCaps = GST_STATIC_CAPS("timestamp/x-ve-capture");
+
+GstClockTime to_ns(LatencyStage::Clock::time_point t) {
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch());
+  return static_cast<GstClockTime>(ns.count());
+}
+
+LatencyStage::Clock::time_point from_ns(GstClockTime ns) {
+  return LatencyStage::Clock::time_point(
+      std::chrono::duration_cast<LatencyStage::Clock::duration>(std::chrono::nanoseconds(ns)));
+}
+
+GstPadProbeReturn on_source_buffer(GstPad*, GstPadProbeInfo* info, gpointer user_data) {
+  // Source buffers normally have a single owner here, so this does not copy.
+  GstBuffer* buffer = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+  GST_PAD_PROBE_INFO_DATA(info) = buffer;
+  static_cast<LatencyStage*>(user_data)->on_capture(buffer);
+  return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn on_encoder_output(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+  static_cast<LatencyStage*>(user_data)->on_encoded(GST_PAD_PROBE_INFO_BUFFER(info), GST_PAD_PARENT(pad));
+  return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn on_pay_output(GstPad*, GstPadProbeInfo* info, gpointer user_data) {
+  auto* stage = static_cast<LatencyStage*>(user_data);
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    stage->on_packet(GST_PAD_PROBE_INFO_BUFFER(info));
+  } else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList* list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+    const guint n = gst_buffer_list_length(list);
+    for (guint i = 0; i < n; ++i) stage->on_packet(gst_buffer_list_get(list, i));
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+gboolean on_timer(gpointer user_data) {
+  return static_cast<LatencyStage*>(user_data)->on_tick() ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+}  // namespace
+
+namespace ve {
+
+LatencyStage::LatencyStage() = default;
+LatencyStage::~LatencyStage() { detach(); }
+
+bool LatencyStage::attach(GstElement* source, const std::vector<GstElement*>& encoders, GstElement* pay,
+                          unsigned int report_seconds) {
+  detach();
+  if (!source || encoders.empty() || !pay) return false;
+  source_pad_ = gst_element_get_static_pad(source, "src");
+  pay_pad_ = gst_element_get_static_pad(pay, "src");
+  for (GstElement* encoder : encoders) {
+    GstPad* pad = encoder ? gst_element_get_static_pad(encoder, "src") : nullptr;
+    if (pad) encoder_pads_.push_back(pad);
+  }
+  if (!source_pad_ || !pay_pad_ || encoder_pads_.size() != encoders.size()) {
+    LOG_ERROR("Latency: source, encoder or payloader pad unavailable");
+    detach();
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    tracker_ = FrameLatencyTracker(static_cast<int>(encoders.size()));
+    unstamped_ = 0;
+  }
+  source_probe_id_ = gst_pad_add_probe(source_pad_, GST_PAD_PROBE_TYPE_BUFFER, on_source_buffer, this, nullptr);
+  for (GstPad* pad : encoder_pads_) {
+    encoder_probe_ids_.push_back(gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_encoder_output, this, nullptr));
+  }
+  pay_probe_id_ = gst_pad_add_probe(
+      pay_pad_, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+      on_pay_output, this, nullptr);
+  timer_id_ = g_timeout_add_seconds(report_seconds, on_timer, this);
+  return source_probe_id_ != 0 && pay_probe_id_ != 0 &&
+         std::find(encoder_probe_ids_.begin(), encoder_probe_ids_.end(), 0ul) == encoder_probe_ids_.end();
+}
+
+void LatencyStage::detach() {
+  if (timer_id_ != 0) g_source_remove(timer_id_);
+  if (source_pad_) {
+    if (source_probe_id_ != 0) gst_pad_remove_probe(source_pad_, source_probe_id_);
+    gst_object_unref(source_pad_);
+    LOG_INFO("Latency: ", tracker_.total_frames(), " frames, capture to first packet ", tracker_.mean_first_ms(),
+             " ms, to last packet ", tracker_.mean_last_ms(), " ms on average, ", tracker_.total_incomplete(),
+             " incomplete");
+  }
+  for (std::size_t i = 0; i < encoder_pads_.size(); ++i) {
+    if (i < encoder_probe_ids_.size() && encoder_probe_ids_[i] != 0) {
+      gst_pad_remove_probe(encoder_pads_[i], encoder_probe_ids_[i]);
+    }
+    gst_object_unref(encoder_pads_[i]);
+  }
+  if (pay_pad_) {
+    if (pay_probe_id_ != 0) gst_pad_remove_probe(pay_pad_, pay_probe_id_);
+    gst_object_unref(pay_pad_);
+  }
+  encoder_pads_.clear();
+  encoder_probe_ids_.clear();
+  source_pad_ = pay_pad_ = nullptr;
+  source_probe_id_ = pay_probe_id_ = 0;
+  timer_id_ = 0;
+}
+
+void LatencyStage::on_capture(GstBuffer* buffer) {
+  GstCaps* caps = gst_static_caps_get(&kCaptureCaps);
+  const GstClockTime now = to_ns(Clock::now());
+  if (GstReferenceTimestampMeta* meta = gst_buffer_get_reference_timestamp_meta(buffer, caps)) {
+    meta->timestamp = now;  // a recycled buffer that kept its meta
+  } else {
+    gst_buffer_add_reference_timestamp_meta(buffer, caps, now, GST_CLOCK_TIME_NONE);
+  }
+  gst_caps_unref(caps);
+}
+
+void LatencyStage::on_encoded(GstBuffer* buffer, GstElement* encoder) {
+  const auto now = Clock::now();
+  const GstClockTime pts = GST_BUFFER_PTS(buffer);
+  if (!GST_CLOCK_TIME_IS_VALID(pts)) return;
+  GstCaps* caps = gst_static_caps_get(&kCaptureCaps);
+  const GstReferenceTimestampMeta* meta = gst_buffer_get_reference_timestamp_meta(buffer, caps);
+  gst_caps_unref(caps);
+
+  Clock::time_point captured;
+  if (meta) {
+    captured = from_ns(meta->timestamp);
+  } else {
+    // Meta dropped on the way: the live source's PTS is its capture running
+    // time, shifted by at most half a frame where videorate re-times frames.
+    GstClock* clock = encoder ? gst_element_get_clock(encoder) : nullptr;
+    if (!clock) return;
+    const GstClockTime running = gst_clock_get_time(clock) - gst_element_get_base_time(encoder);
+    gst_object_unref(clock);
+    if (running < pts) return;
+    captured = now - std::chrono::nanoseconds(running - pts);
+  }
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (!meta) ++unstamped_;
+  tracker_.on_encoded(pts, captured);
+}
+
+void LatencyStage::on_packet(GstBuffer* buffer) {
+  const auto now = Clock::now();
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  if (!gst_rtp_buffer_map(buffer, GST_MAP_READ, &rtp)) return;
+  const bool marker = gst_rtp_buffer_get_marker(&rtp);
+  gst_rtp_buffer_unmap(&rtp);
+  std::lock_guard<std::mutex> lock(mtx_);
+  tracker_.on_packet(GST_BUFFER_PTS(buffer), marker, now);
+}
+
+bool LatencyStage::on_tick() {
+  LatencySummary s;
+  std::uint64_t unstamped = 0;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    s = tracker_.take_window();
+    unstamped = unstamped_;
+  }
+  if (s.frames == 0) return true;
+  const double frame_share = s.interval_p50 > 0.0 ? s.first_p50 / s.interval_p50 : 0.0;
+  LOG_INFO("Latency: capture to first packet p50 ", s.first_p50, " ms (", frame_share, " frame), p95 ",
+           s.first_p95, " ms, max ", s.first_max, " ms; to last packet p50 ", s.last_p50, " ms, p95 ", s.last_p95,
+           " ms; frame time ", s.interval_p50, " ms, ", s.frames, " frames",
+           s.incomplete > 0 ? ", " + std::to_string(s.incomplete) + " incomplete" : std::string());
+  if (unstamped > 0) {
+    LOG_DEBUG("Latency: ", unstamped, " frames timed from their PTS (capture meta not carried through)");
+  }
+  return true;
+}
+
+}  // namespace ve
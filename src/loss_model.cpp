@@ -0,0 +1,227 @@
+#include "loss_model.h"
+#include "rtp_fec.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+
+using namespace ve;
+
+using Matrix = std::array<std::array<double, 2>, 2>;  // [from][to], 0 = gap, 1 = burst
+
+Matrix multiply(const Matrix& a, const Matrix& b) {
+  Matrix m{};
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 2; ++j) m[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j];
+  }
+  return m;
+}
+
+Matrix power(Matrix m, int n) {
+  Matrix result{{{1.0, 0.0}, {0.0, 1.0}}};
+  for (; n > 0; n >>= 1) {
+    if (n & 1) result = multiply(result, m);
+    m = multiply(m, m);
+  }
+  return result;
+}
+
+// Near-ties (relative) are resolved towards less repair delay.
+constexpr double kTieMargin = 1.05;
+
+}  // namespace
+
+namespace ve {
+
+double GilbertElliottParams::loss_rate() const {
+  if (p + r <= 0.0) return gap_loss;
+  return (r * gap_loss + p * burst_loss) / (p + r);
+}
+
+GilbertElliottEstimator::GilbertElliottEstimator(LossModelConfig cfg) : cfg_(cfg) {
+  cfg_.gmin = std::max(cfg_.gmin, 1);
+}
+
+void GilbertElliottEstimator::add(bool received) {
+  if (!received) {
+    ++loss_run_;
+    if (candidate_losses_ > 0) {
+      candidate_packets_ += since_loss_ + 1;
+      ++candidate_losses_;
+    } else {
+      candidate_packets_ = candidate_losses_ = 1;
+    }
+    since_loss_ = 0;
+    return;
+  }
+
+  if (loss_run_ > 0) {
+    loss_runs_[std::min<std::size_t>(loss_run_, kLossRunBins) - 1] += 1.0;
+    loss_run_ = 0;
+  }
+  if (candidate_losses_ == 0) {
+    gap_packets_ += 1.0;
+  } else if (++since_loss_ >= cfg_.gmin) {
+    close_candidate();
+  }
+  if (packets() >= 2.0 * cfg_.window) decay();
+}
+
+void GilbertElliottEstimator::add(const std::vector<bool>& received) {
+  for (bool r : received) add(r);
+}
+
+void GilbertElliottEstimator::close_candidate() {
+  if (candidate_losses_ >= 2) {
+    burst_packets_ += candidate_packets_;
+    burst_losses_ += candidate_losses_;
+    bursts_ += 1.0;
+  } else {
+    // An isolated loss belongs to the gap.
+    gap_packets_ += 1.0;
+    gap_losses_ += 1.0;
+  }
+  gap_packets_ += since_loss_;
+  candidate_packets_ = candidate_losses_ = since_loss_ = 0;
+}
+
+void GilbertElliottEstimator::decay() {
+  for (double* v : {&gap_packets_, &gap_losses_, &burst_packets_, &burst_losses_, &bursts_}) *v *= 0.5;
+  for (double& bin : loss_runs_) bin *= 0.5;
+}
+
+GilbertElliottParams GilbertElliottEstimator::params() const {
+  GilbertElliottParams m;
+  if (gap_packets_ > 0.0) {
+    m.p = std::min(1.0, bursts_ / gap_packets_);
+    m.gap_loss = gap_losses_ / gap_packets_;
+  }
+  if (burst_packets_ > 0.0) {
+    m.r = std::min(1.0, bursts_ / burst_packets_);
+    m.burst_loss = burst_losses_ / burst_packets_;
+  }
+  return m;
+}
+
+bool GilbertElliottEstimator::bursty() const {
+  // Every loss run of length k is k - 1 losses following a loss and one
+  // received packet following one. Bernoulli loss at rate q continues a
+  // run with probability q; compare with the observed continuation rate.
+  double runs = 0.0, continued = 0.0;
+  for (std::size_t i = 0; i < kLossRunBins; ++i) {
+    runs += loss_runs_[i];
+    continued += loss_runs_[i] * static_cast<double>(i);
+  }
+  const double q = packets() > 0.0 ? losses() / packets() : 0.0;
+  if (runs <= 0.0 || continued <= 0.0 || q <= 0.0 || q >= 1.0) return false;
+  const double c = continued / (continued + runs);
+  if (c <= q) return false;
+  const double ratio = 2.0 * (continued * std::log(c / q) + runs * std::log((1.0 - c) / (1.0 - q)));
+  return ratio > cfg_.burst_significance;
+}
+
+LossPatternTracker::LossPatternTracker(LossModelConfig cfg) : cfg_(cfg) {}
+
+GilbertElliottEstimator& LossPatternTracker::model(std::uint32_t receiver) {
+  return models_.try_emplace(receiver, cfg_).first->second;
+}
+
+void LossPatternTracker::add(std::uint32_t receiver, const std::vector<bool>& received) {
+  model(receiver).add(received);
+}
+
+void LossPatternTracker::add(std::uint32_t receiver, const XrLossRle& block) {
+  // Thinned blocks no longer show which losses were adjacent.
+  if (block.thinning != 0) return;
+  std::size_t skip = 0;
+  auto [it, first] = rle_end_.try_emplace(receiver, block.end_seq);
+  if (!first) {
+    const auto overlap = static_cast<std::int16_t>(it->second - block.begin_seq);
+    if (overlap > 0) skip = static_cast<std::size_t>(overlap);
+    if (static_cast<std::int16_t>(block.end_seq - it->second) > 0) it->second = block.end_seq;
+  }
+  GilbertElliottEstimator& m = model(receiver);
+  for (std::size_t i = skip; i < block.received.size(); ++i) m.add(block.received[i]);
+}
+
+const GilbertElliottEstimator* LossPatternTracker::worst(double min_packets) const {
+  const GilbertElliottEstimator* worst = nullptr;
+  double worst_loss = -1.0;
+  for (const auto& [receiver, m] : models_) {
+    if (m.packets() < min_packets) continue;
+    const double loss = m.params().loss_rate();
+    if (loss > worst_loss) {
+      worst = &m;
+      worst_loss = loss;
+    }
+  }
+  return worst;
+}
+
+double xor_fec_residual(const GilbertElliottParams& model, int group_size, int interleave) {
+  const double loss = model.loss_rate();
+  if (group_size < 1 || loss <= 0.0) return loss;
+  const std::array<double, 2> e{model.gap_loss, model.burst_loss};
+  const Matrix step{{{1.0 - model.p, model.p}, {model.r, 1.0 - model.r}}};
+  const Matrix stride = power(step, std::max(interleave, 1));
+  const double total = model.p + model.r;
+  const std::array<double, 2> stationary =
+      total > 0.0 ? std::array<double, 2>{model.r / total, model.p / total} : std::array<double, 2>{1.0, 0.0};
+
+  // alpha[s][k]: in state s at the current media packet with k losses so far
+  // among the column's media packets (k = 2 means two or more).
+  std::array<std::array<double, 3>, 2> alpha{};
+  for (int s = 0; s < 2; ++s) {
+    alpha[s][0] = stationary[s] * (1.0 - e[s]);
+    alpha[s][1] = stationary[s] * e[s];
+  }
+  for (int i = 1; i < group_size; ++i) {
+    std::array<std::array<double, 3>, 2> next{};
+    for (int s = 0; s < 2; ++s) {
+      for (int t = 0; t < 2; ++t) {
+        for (int k = 0; k < 3; ++k) {
+          const double w = alpha[s][k] * stride[s][t];
+          next[t][k] += w * (1.0 - e[t]);
+          next[t][std::min(k + 1, 2)] += w * e[t];
+        }
+      }
+    }
+    alpha = next;
+  }
+  // One media loss is repaired if the parity, sent right after the column's
+  // last packet, arrives.
+  double repaired = 0.0;
+  for (int s = 0; s < 2; ++s) {
+    for (int t = 0; t < 2; ++t) repaired += alpha[s][1] * step[s][t] * (1.0 - e[t]);
+  }
+  return std::max(0.0, loss - repaired / group_size);
+}
+
+FecLayout choose_fec_layout(const GilbertElliottParams& model, int fec_percentage, int max_span) {
+  FecLayout best;
+  best.group_size = rtp_fec_group_size(fec_percentage);
+  if (best.group_size == 0) return best;
+  const double loss = model.loss_rate();
+
+  std::vector<double> residual;
+  residual.push_back(xor_fec_residual(model, best.group_size, 1));
+  for (int d = 2; best.group_size > 1 && (best.group_size - 1) * d < static_cast<int>(kRtpFecMaxMask) &&
+                  best.group_size * d <= max_span;
+       ++d) {
+    residual.push_back(xor_fec_residual(model, best.group_size, d));
+  }
+  const double lowest = *std::min_element(residual.begin(), residual.end());
+  for (std::size_t i = 0; i < residual.size(); ++i) {
+    if (residual[i] <= lowest * kTieMargin + 1e-9) {
+      best.interleave = static_cast<int>(i) + 1;
+      best.residual_loss = residual[i];
+      break;
+    }
+  }
+  best.recovered = loss > 0.0 ? 1.0 - best.residual_loss / loss : 0.0;
+  return best;
+}
+
+}  // namespace ve
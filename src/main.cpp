@@ -1,14 +1,30 @@
+#include "convert_scale_filter.h"
+#include "encoder_load_stage.h"
+#include "fec_stage.h"
+#include "h264_nal.h"
+#include "keyframe_stage.h"
+#include "latency_stage.h"
 #include "logger.h"
+#include "overload_detector.h"
+#include "pipeline_planner.h"
+#include "probe_stage.h"
 #include "qos_controller.h"
+#include "rtx_stage.h"
+#include "static_content_stage.h"
+#include "tile_layout.h"
 #include "utils.h"
+#include "xor_kernels.h"
 
 #include <gst/gst.h>
 #include <gst/rtp/rtp.h>
 
 #include <algorithm>
+#include <chrono>
 #include <csignal>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace ve;
@@ -17,6 +33,11 @@ namespace {
 
 GMainLoop* g_loop = nullptr;
 
+// RTP packet size the payloaders fragment to.
+constexpr std::size_t kRtpMtu = 1200;
+// Slices per frame in low-delay mode, whatever the thread count.
+constexpr int kLowDelaySlices = 4;
+
 struct PipelineElements {
   GstElement* pipeline = nullptr;
   GstElement* source = nullptr;
@@ -27,6 +48,7 @@ struct PipelineElements {
   GstElement* queue = nullptr;
   GstElement* encoder = nullptr;
   GstElement* parser = nullptr;
+  GstElement* parser_caps = nullptr;
   GstElement* pay = nullptr;
   GstElement* rtpbin = nullptr;
   GstElement* tee = nullptr;
@@ -34,6 +56,10 @@ struct PipelineElements {
   GstElement* udpsink_fec = nullptr;
   GstElement* udpsink_rtcp = nullptr;
   GstElement* udpsrc_rtcp = nullptr;
+  GstElement* fec_src = nullptr;
+  GstElement* rtp_funnel = nullptr;
+  GstElement* probe_src = nullptr;
+  GstElement* tile_tee = nullptr;
 };
 
 GstElement* make_checked(const char* factory, const char* name) {
@@ -46,6 +72,7 @@ GstElement* make_checked(const char* factory, const char* name) {
 
 void configure_source(GstElement* source, const EngineConfig& cfg) {
   if (cfg.source == "ximagesrc") {
+    // Whole frames every tick; StaticContentStage drops the unchanged ones.
     g_object_set(source,
                  "use-damage", FALSE,
                  "show-pointer", FALSE,
@@ -63,6 +90,28 @@ void configure_source(GstElement* source, const EngineConfig& cfg) {
   }
 }
 
+// What the source can produce, left unset where its caps allow a range or a
+// choice. Sources only report their real caps once open (READY).
+SourceFormat query_source_format(GstElement* source) {
+  SourceFormat f;
+  if (gst_element_set_state(source, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE) return f;
+  GstPad* pad = gst_element_get_static_pad(source, "src");
+  GstCaps* caps = pad ? gst_pad_query_caps(pad, nullptr) : nullptr;
+  if (caps && gst_caps_get_size(caps) == 1) {
+    const GstStructure* s = gst_caps_get_structure(caps, 0);
+    const GValue* format = gst_structure_get_value(s, "format");
+    if (format && G_VALUE_HOLDS_STRING(format)) f.format = g_value_get_string(format);
+    gint width = 0, height = 0, num = 0, den = 0;
+    if (gst_structure_get_int(s, "width", &width)) f.width = width;
+    if (gst_structure_get_int(s, "height", &height)) f.height = height;
+    if (gst_structure_get_fraction(s, "framerate", &num, &den) && den > 0) f.fps = static_cast<double>(num) / den;
+  }
+  if (caps) gst_caps_unref(caps);
+  if (pad) gst_object_unref(pad);
+  gst_element_set_state(source, GST_STATE_NULL);
+  return f;
+}
+
 void configure_caps(GstElement* capsfilter, const VideoProfile& profile) {
   GstCaps* caps = gst_caps_new_simple("video/x-raw",
                                       "width", G_TYPE_INT, profile.width,
@@ -93,23 +142,49 @@ void configure_queue(GstElement* queue, int latency_ms) {
                NULL);
 }
 
-void configure_encoder(GstElement* encoder, const VideoProfile& profile) {
+void configure_encoder(GstElement* encoder, const VideoProfile& profile, const EngineConfig& cfg) {
+  std::string options = "repeat-headers=1";
+  if (cfg.mtu_slices) {
+    // Every slice fits one single-NAL RTP packet: a lost packet costs one
+    // slice instead of every FU-A fragment's frame.
+    options += ":slice-max-size=" + std::to_string(h264_slice_max_size(kRtpMtu));
+  } else if (cfg.low_delay) {
+    options += ":slices=" + std::to_string(kLowDelaySlices);
+  }
+  // Strips decide scene cuts on their own content; only count-based and
+  // forced keyframes land on the same frame in every strip.
+  if (cfg.tiles > 1) options += ":scenecut=0";
   g_object_set(encoder,
                "tune", 0x00000004,          // zerolatency
                "speed-preset", 1,          // ultrafast
-               "key-int-max", profile.fps * 2,
+               "key-int-max", profile.fps * cfg.gop_seconds,
                "bitrate", profile.bitrate_kbps,
                "byte-stream", TRUE,
                "bframes", 0,
-               "option-string", "repeat-headers=1",
+               "option-string", options.c_str(),
                NULL);
+  // x264enc overrides zerolatency's sliced threads with its own default
+  // (frame threads, each holding a frame in flight). Sliced threads encode
+  // the slices of one frame side by side instead.
+  if (cfg.low_delay) g_object_set(encoder, "sliced-threads", TRUE, NULL);
+}
+
+// h264parse hands out single NAL units, so the payloader sends each slice
+// as soon as the parser has it instead of waiting for the whole access unit.
+void configure_parser_caps(GstElement* capsfilter) {
+  GstCaps* caps = gst_caps_new_simple("video/x-h264",
+                                      "stream-format", G_TYPE_STRING, "byte-stream",
+                                      "alignment", G_TYPE_STRING, "nal",
+                                      NULL);
+  g_object_set(capsfilter, "caps", caps, NULL);
+  gst_caps_unref(caps);
 }
 
 void configure_payloader(GstElement* pay) {
   g_object_set(pay,
                "pt", 96,
                "config-interval", 1,
-               "mtu", 1200,
+               "mtu", static_cast<guint>(kRtpMtu),
                NULL);
 }
 
@@ -125,6 +200,69 @@ void configure_sink(GstElement* sink, const std::string& host, int port) {
                NULL);
 }
 
+// One queue -> videocrop -> x264enc -> h264parse -> rtph264pay branch per
+// strip, each queue starting its own streaming thread so the strips encode
+// in parallel. The payloaders share a timestamp offset, so all strips of a
+// frame carry the same RTP timestamp, and each sends under its own SSRC.
+// Returns the encoders, or nothing if a branch could not be built.
+std::vector<GstElement*> build_tile_branches(GstElement* pipeline, GstElement* tee, GstElement* funnel,
+                                             const EngineConfig& cfg) {
+  const std::vector<Tile> tiles = plan_tiles(cfg.profile.width, cfg.profile.height, cfg.tiles);
+  const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  const int threads = std::max(1, cores / static_cast<int>(tiles.size()));
+  const guint timestamp_offset = g_random_int();
+  std::vector<GstElement*> encoders;
+  for (const Tile& tile : tiles) {
+    const std::string n = std::to_string(tile.index);
+    GstElement* queue = make_checked("queue", ("tile_queue_" + n).c_str());
+    GstElement* crop = make_checked("videocrop", ("tile_crop_" + n).c_str());
+    GstElement* encoder = make_checked("x264enc", ("tile_encoder_" + n).c_str());
+    GstElement* parser = make_checked("h264parse", ("tile_parser_" + n).c_str());
+    GstElement* parser_caps =
+        cfg.low_delay ? make_checked("capsfilter", ("tile_parser_caps_" + n).c_str()) : nullptr;
+    GstElement* pay = make_checked("rtph264pay", ("tile_pay_" + n).c_str());
+    if (!queue || !crop || !encoder || !parser || !pay || (cfg.low_delay && !parser_caps)) return {};
+
+    VideoProfile profile = cfg.profile;
+    profile.width = tile.width;
+    profile.bitrate_kbps = tile_bitrate_kbps(tile, cfg.profile.width, cfg.profile.bitrate_kbps);
+    configure_queue(queue, cfg.latency_ms);
+    g_object_set(crop,
+                 "left", tile.x,
+                 "right", cfg.profile.width - tile.x - tile.width,
+                 NULL);
+    configure_encoder(encoder, profile, cfg);
+    g_object_set(encoder, "threads", threads, NULL);
+    if (parser_caps) configure_parser_caps(parser_caps);
+    configure_payloader(pay);
+    g_object_set(pay,
+                 "ssrc", tile_ssrc(tile.index),
+                 "timestamp-offset", timestamp_offset,
+                 NULL);
+
+    std::vector<GstElement*> branch = {queue, crop, encoder, parser};
+    if (parser_caps) branch.push_back(parser_caps);
+    branch.push_back(pay);
+    GstElement* upstream = tee;
+    for (GstElement* element : branch) {
+      gst_bin_add(GST_BIN(pipeline), element);
+      if (!gst_element_link(upstream, element)) {
+        LOG_ERROR("Failed to link tile ", tile.index, " branch at ", GST_ELEMENT_NAME(element));
+        return {};
+      }
+      upstream = element;
+    }
+    if (!gst_element_link(pay, funnel)) {
+      LOG_ERROR("Failed to link tile ", tile.index, " branch to the funnel");
+      return {};
+    }
+    encoders.push_back(encoder);
+  }
+  LOG_INFO("Tiled encoding: ", tiles.size(), " strips of ", tiles.front().width, "-", tiles.back().width, "x",
+           cfg.profile.height, ", ", threads, " x264 threads each, SSRC ", kTileSsrcBase, "+<strip>");
+  return encoders;
+}
+
 struct PadLinkCtx {
   GstElement* udpsink_rtp;
   GstElement* udpsink_fec;
@@ -151,7 +289,9 @@ void attach_rtpbin_links(GstElement* rtpbin, GstElement* pay,
         auto* c = static_cast<PadLinkCtx*>(user_data);
         const gchar* name = GST_PAD_NAME(new_pad);
         if (g_str_has_prefix(name, "send_rtp_src_0")) {
+          // udpsink, or the funnel merging probe padding in front of it
           GstPad* sinkpad = gst_element_get_static_pad(c->udpsink_rtp, "sink");
+          if (!sinkpad) sinkpad = gst_element_get_request_pad(c->udpsink_rtp, "sink_%u");
           if (gst_pad_link(new_pad, sinkpad) == GST_PAD_LINK_OK) {
             LOG_INFO("Linked ", name, " -> udpsink_rtp");
           } else {
@@ -189,6 +329,35 @@ void attach_rtpbin_links(GstElement* rtpbin, GstElement* pay,
   if (rtpbin_rtcp_sink) gst_object_unref(rtpbin_rtcp_sink);
 }
 
+// Retunes every rtpulpfecenc in the pipeline, including those rtpbin creates
+// internally from "fec-encoders".
+void set_ulpfec_percentage(GstElement* pipeline, int percentage) {
+  GstIterator* it = gst_bin_iterate_recurse(GST_BIN(pipeline));
+  GValue item = G_VALUE_INIT;
+  bool done = false;
+  while (!done) {
+    switch (gst_iterator_next(it, &item)) {
+      case GST_ITERATOR_OK: {
+        GstElement* element = GST_ELEMENT(g_value_get_object(&item));
+        GstElementFactory* factory = gst_element_get_factory(element);
+        if (factory && g_strcmp0(GST_OBJECT_NAME(factory), "rtpulpfecenc") == 0) {
+          g_object_set(element, "percentage", percentage, NULL);
+        }
+        g_value_reset(&item);
+        break;
+      }
+      case GST_ITERATOR_RESYNC:
+        gst_iterator_resync(it);
+        break;
+      default:
+        done = true;
+        break;
+    }
+  }
+  g_value_unset(&item);
+  gst_iterator_free(it);
+}
+
 gboolean bus_call(GstBus*, GstMessage* msg, gpointer) {
   switch (GST_MESSAGE_TYPE(msg)) {
     case GST_MESSAGE_ERROR: {
@@ -229,6 +398,17 @@ gboolean bus_call(GstBus*, GstMessage* msg, gpointer) {
   return TRUE;
 }
 
+// Reads the controller's published snapshot; never waits on the RTCP thread.
+gboolean log_qos_stats(gpointer user_data) {
+  const QosStats s = static_cast<const QosController*>(user_data)->stats();
+  if (s.decisions == 0) return TRUE;
+  LOG_INFO("Stats: bitrate ", s.bitrate_kbps, " kbps (loss ceiling ", s.loss_kbps, ", delay estimate ",
+           s.delay_kbps, ", acked ", static_cast<int>(s.acked_kbps), ", ", bandwidth_usage_name(s.usage),
+           "), loss ", s.fraction_lost * 100.0, "%, rtt ", s.rtt_ms, " ms, FEC ", s.fec_percentage,
+           "% x", s.fec_interleave, ", ", protection_mode_name(s.protection), ", rung ", s.profile);
+  return TRUE;
+}
+
 void handle_sigint(int) {
   if (g_loop) g_main_loop_quit(g_loop);
 }
@@ -251,16 +431,56 @@ int main(int argc, char** argv) {
   }
 
   el.source = make_checked(cfg.source.c_str(), "source");
-  el.convert = make_checked("videoconvert", "convert");
-  el.scale = make_checked("videoscale", "scale");
-  el.rate = make_checked("videorate", "rate");
+  std::vector<GstElement*> raw_chain;
+  if (el.source) {
+    configure_source(el.source, cfg);
+    const SourceFormat source_format = query_source_format(el.source);
+    PlanConstraints constraints;
+    constraints.size_may_change = constraints.fps_may_change = cfg.adapt == "joint" || cfg.cpu_adapt;
+    constraints.fused_convert_scale = cfg.fused_convert && register_convert_scale_element();
+    const RawChainPlan plan = plan_raw_chain(source_format, cfg.profile, constraints);
+    for (RawStage stage : plan.stages) {
+      GstElement* element = make_checked(raw_stage_element(stage), raw_stage_element(stage));
+      if (stage == RawStage::Rate) el.rate = element;
+      if (stage == RawStage::Scale) el.scale = element;
+      if (stage == RawStage::Convert || stage == RawStage::ConvertScale) el.convert = element;
+      raw_chain.push_back(element);
+    }
+    LOG_INFO("Raw video chain: ", cfg.source, " (", source_format.format.empty() ? "any format" : source_format.format,
+             " ", source_format.width, "x", source_format.height, "@", source_format.fps, ") -> ", plan.describe(),
+             " -> capsfilter, ~", static_cast<int>(plan.bytes_per_second / 1e6), " MB/s of frame traffic (",
+             static_cast<int>(plan.naive_bytes_per_second / 1e6), " MB/s converting first)");
+  }
   el.capsfilter = make_checked("capsfilter", "caps");
-  el.queue = make_checked("queue", "buffer");
-  el.encoder = make_checked("x264enc", "encoder");
-  el.parser = make_checked("h264parse", "parser");
-  el.pay = make_checked("rtph264pay", "pay");
+  // Tiled: the frame is split after the capsfilter and the strips' RTP
+  // streams merge again in a funnel that stands in for the payloader.
+  const bool tiled = cfg.tiles > 1;
+  std::vector<GstElement*> encode_chain;
+  if (tiled) {
+    el.tile_tee = make_checked("tee", "tile_tee");
+    el.pay = make_checked("funnel", "tile_funnel");
+    encode_chain = {el.tile_tee};
+  } else {
+    el.queue = make_checked("queue", "buffer");
+    el.encoder = make_checked("x264enc", "encoder");
+    el.parser = make_checked("h264parse", "parser");
+    el.pay = make_checked("rtph264pay", "pay");
+    encode_chain = {el.queue, el.encoder, el.parser};
+    if (cfg.low_delay) {
+      el.parser_caps = make_checked("capsfilter", "parser_caps");
+      encode_chain.push_back(el.parser_caps);
+    }
+    encode_chain.push_back(el.pay);
+  }
   el.udpsink_rtp = make_checked("udpsink", "udpsink_rtp");
   el.udpsink_fec = make_checked("udpsink", "udpsink_fec");
+  const bool xor_fec = cfg.fec_engine == "xor";
+  if (xor_fec) el.fec_src = make_checked("appsrc", "fec_src");
+  const bool probing = cfg.mode == "rtpbin" && cfg.twcc_ext_id > 0 && cfg.probing;
+  if (probing) {
+    el.rtp_funnel = make_checked("funnel", "rtp_funnel");
+    el.probe_src = make_checked("appsrc", "probe_src");
+  }
 
   if (cfg.mode == "rtpbin") {
     el.rtpbin = make_checked("rtpbin", "rtpbin");
@@ -271,10 +491,11 @@ int main(int argc, char** argv) {
   }
 
   std::vector<GstElement*> mandatory = {
-      el.source, el.convert, el.scale, el.rate, el.capsfilter,
-      el.queue, el.encoder, el.parser, el.pay,
+      el.source, el.capsfilter, el.pay,
       el.udpsink_rtp, el.udpsink_fec,
   };
+  mandatory.insert(mandatory.end(), raw_chain.begin(), raw_chain.end());
+  mandatory.insert(mandatory.end(), encode_chain.begin(), encode_chain.end());
   if (std::any_of(mandatory.begin(), mandatory.end(), [](GstElement* e){ return e == nullptr; })) {
     LOG_ERROR("Element creation failed. Ensure required GStreamer plugins are installed.");
     return 1;
@@ -283,16 +504,32 @@ int main(int argc, char** argv) {
     LOG_ERROR("RTP bin mode requires rtpbin/RTCP elements");
     return 1;
   }
+  if (probing && (!el.rtp_funnel || !el.probe_src)) {
+    LOG_ERROR("Bandwidth probing requires funnel/appsrc");
+    return 1;
+  }
+  if (xor_fec && !el.fec_src) {
+    LOG_ERROR("XOR FEC engine requires appsrc");
+    return 1;
+  }
   if (cfg.mode == "simple" && !el.tee) {
     LOG_ERROR("Simple mode requires tee element");
     return 1;
   }
 
-  configure_source(el.source, cfg);
+  // Fixed SSRCs let rtprtxsend pair its RTX stream with the media one, so
+  // probe padding can go out on it too.
+  const guint media_ssrc = tiled ? tile_ssrc(0) : g_random_int();
+  const guint rtx_ssrc = g_random_int();
+
   configure_caps(el.capsfilter, cfg.profile);
-  configure_queue(el.queue, cfg.latency_ms);
-  configure_encoder(el.encoder, cfg.profile);
-  configure_payloader(el.pay);
+  if (!tiled) {
+    configure_queue(el.queue, cfg.latency_ms);
+    configure_encoder(el.encoder, cfg.profile, cfg);
+    if (el.parser_caps) configure_parser_caps(el.parser_caps);
+    configure_payloader(el.pay);
+    g_object_set(el.pay, "ssrc", media_ssrc, NULL);
+  }
   configure_sink(el.udpsink_rtp, cfg.dest_ip, cfg.ports.rtp_port);
   configure_sink(el.udpsink_fec, cfg.dest_ip, cfg.ports.fec_port);
   if (el.rate) configure_videorate(el.rate, cfg.profile);
@@ -300,47 +537,87 @@ int main(int argc, char** argv) {
     configure_sink(el.udpsink_rtcp, cfg.dest_ip, cfg.ports.rtcp_send_port);
     g_object_set(el.udpsrc_rtcp, "port", cfg.ports.rtcp_recv_port, NULL);
 
-    GstStructure* fecmap = gst_structure_new_empty("fec");
-    std::string fec_desc = "rtpulpfecenc percentage=" + std::to_string(cfg.fec_percentage);
-    gst_structure_set(fecmap, "0", G_TYPE_STRING, fec_desc.c_str(), NULL);
-    g_object_set(el.rtpbin, "fec-encoders", fecmap, NULL);
-    gst_structure_free(fecmap);
+    if (!xor_fec) {
+      GstStructure* fecmap = gst_structure_new_empty("fec");
+      std::string fec_desc = "rtpulpfecenc percentage=" + std::to_string(cfg.fec_percentage);
+      gst_structure_set(fecmap, "0", G_TYPE_STRING, fec_desc.c_str(), NULL);
+      g_object_set(el.rtpbin, "fec-encoders", fecmap, NULL);
+      gst_structure_free(fecmap);
+    }
     g_object_set(el.rtpbin, "latency", cfg.latency_ms, NULL);
+    // AVPF lets the receiver send NACKs as soon as it sees a gap.
+    if (cfg.protection != "fec") g_object_set(el.rtpbin, "rtp-profile", GST_RTP_PROFILE_AVPF, NULL);
   }
 
   gst_bin_add_many(GST_BIN(el.pipeline),
-                   el.source, el.convert, el.scale, el.rate, el.capsfilter,
-                   el.queue, el.encoder, el.parser, el.pay,
+                   el.source, el.capsfilter,
                    el.udpsink_rtp, el.udpsink_fec,
                    NULL);
+  for (GstElement* element : raw_chain) gst_bin_add(GST_BIN(el.pipeline), element);
+  for (GstElement* element : encode_chain) gst_bin_add(GST_BIN(el.pipeline), element);
+  if (tiled) gst_bin_add(GST_BIN(el.pipeline), el.pay);
   if (cfg.mode == "rtpbin") {
     gst_bin_add_many(GST_BIN(el.pipeline), el.rtpbin, el.udpsink_rtcp, el.udpsrc_rtcp, NULL);
   } else {
     gst_bin_add(GST_BIN(el.pipeline), el.tee);
   }
+  if (probing) {
+    gst_bin_add_many(GST_BIN(el.pipeline), el.rtp_funnel, el.probe_src, NULL);
+    if (!gst_element_link_many(el.probe_src, el.rtp_funnel, el.udpsink_rtp, NULL)) {
+      LOG_ERROR("Failed to link probe source through funnel to udpsink_rtp");
+      return 1;
+    }
+  }
+  if (xor_fec) {
+    gst_bin_add(GST_BIN(el.pipeline), el.fec_src);
+    if (!gst_element_link(el.fec_src, el.udpsink_fec)) {
+      LOG_ERROR("Failed to link XOR FEC source to udpsink_fec");
+      return 1;
+    }
+  }
 
-  if (!gst_element_link_many(el.source, el.convert, el.scale, el.rate, el.capsfilter,
-                             el.queue, el.encoder, el.parser, el.pay, NULL)) {
-    LOG_ERROR("Failed to link main video chain");
-    return 1;
+  std::vector<GstElement*> video_chain = {el.source};
+  video_chain.insert(video_chain.end(), raw_chain.begin(), raw_chain.end());
+  video_chain.push_back(el.capsfilter);
+  video_chain.insert(video_chain.end(), encode_chain.begin(), encode_chain.end());
+  for (std::size_t i = 1; i < video_chain.size(); ++i) {
+    if (!gst_element_link(video_chain[i - 1], video_chain[i])) {
+      LOG_ERROR("Failed to link main video chain at ", GST_ELEMENT_NAME(video_chain[i]));
+      return 1;
+    }
+  }
+  std::vector<GstElement*> encoders = {el.encoder};
+  if (tiled) {
+    encoders = build_tile_branches(el.pipeline, el.tile_tee, el.pay, cfg);
+    if (encoders.empty()) {
+      LOG_ERROR("Failed to build tiled encoder branches");
+      return 1;
+    }
+  }
+
+  RtxStage rtx_stage;
+  if (cfg.protection != "fec") {
+    RtxConfig rtx;
+    rtx.history_ms = static_cast<unsigned int>(cfg.rtx_window_ms);
+    rtx.media_ssrc = media_ssrc;
+    rtx.rtx_ssrc = rtx_ssrc;
+    if (!rtx_stage.attach(el.rtpbin, rtx)) {
+      LOG_ERROR("Failed to attach RTX stage");
+      return 1;
+    }
   }
 
   if (cfg.mode == "rtpbin") {
-    attach_rtpbin_links(el.rtpbin, el.pay, el.udpsink_rtp, el.udpsink_fec,
+    attach_rtpbin_links(el.rtpbin, el.pay, probing ? el.rtp_funnel : el.udpsink_rtp, el.udpsink_fec,
                         el.udpsink_rtcp, el.udpsrc_rtcp);
   } else {
     GstElement* q_rtp = make_checked("queue", "queue_rtp");
-    GstElement* q_fec = make_checked("queue", "queue_fec");
-    GstElement* fecenc = make_checked("rtpulpfecenc", "fecenc");
-    if (!q_rtp || !q_fec || !fecenc) {
-      LOG_ERROR("Failed to create FEC branch elements");
+    if (!q_rtp) {
+      LOG_ERROR("Failed to create RTP branch queue");
       return 1;
     }
     configure_queue(q_rtp, cfg.latency_ms);
-    configure_queue(q_fec, cfg.latency_ms);
-    g_object_set(fecenc, "percentage", cfg.fec_percentage, NULL);
-
-    gst_bin_add_many(GST_BIN(el.pipeline), q_rtp, q_fec, fecenc, NULL);
+    gst_bin_add(GST_BIN(el.pipeline), q_rtp);
 
     if (!gst_element_link(el.pay, el.tee)) {
       LOG_ERROR("Failed to link payloader to tee");
@@ -350,21 +627,146 @@ int main(int argc, char** argv) {
       LOG_ERROR("Failed to link tee RTP branch");
       return 1;
     }
-    if (!gst_element_link_many(el.tee, q_fec, fecenc, el.udpsink_fec, NULL)) {
-      LOG_ERROR("Failed to link tee FEC branch");
-      return 1;
+
+    if (!xor_fec) {
+      GstElement* q_fec = make_checked("queue", "queue_fec");
+      GstElement* fecenc = make_checked("rtpulpfecenc", "fecenc");
+      if (!q_fec || !fecenc) {
+        LOG_ERROR("Failed to create FEC branch elements");
+        return 1;
+      }
+      configure_queue(q_fec, cfg.latency_ms);
+      g_object_set(fecenc, "percentage", cfg.fec_percentage, NULL);
+      gst_bin_add_many(GST_BIN(el.pipeline), q_fec, fecenc, NULL);
+      if (!gst_element_link_many(el.tee, q_fec, fecenc, el.udpsink_fec, NULL)) {
+        LOG_ERROR("Failed to link tee FEC branch");
+        return 1;
+      }
     }
   }
 
   GstBus* bus = gst_element_get_bus(el.pipeline);
+  // Transport-wide numbers go in on the payloader's src pad, ahead of the
+  // XOR FEC tap added below and rtpbin's FEC encoder, so parity covers the
+  // packets as sent.
+  QosController qos;
+  qos.attach(el.rtpbin, el.encoder, bus);
+  qos.set_fec_percentage(cfg.fec_percentage);
+  if (cfg.mode == "rtpbin" && cfg.twcc_ext_id > 0 &&
+      !qos.enable_transport_cc(el.pay, el.udpsink_rtp, cfg.twcc_ext_id)) {
+    LOG_WARN("Transport-wide CC unavailable; bitrate adapts to loss only");
+  }
+
+  XorFecStage xor_stage;
+  UepFecConfig uep;
+  uep.percentage = {cfg.fec_percentage, cfg.fec_idr_percentage, cfg.fec_params_percentage};
+  if (xor_fec && !xor_stage.attach(el.pay, el.fec_src, uep)) {
+    LOG_ERROR("Failed to attach XOR FEC stage");
+    return 1;
+  }
+
+  ProbeStage probe_stage;
+  if (probing && !probe_stage.attach(el.probe_src, rtx_ssrc, RtxConfig{}.rtx_pt)) {
+    LOG_ERROR("Failed to attach probe stage");
+    return 1;
+  }
+
+  // Coalesce receiver keyframe requests; a storm after a burst loss would
+  // otherwise turn most frames into IDRs.
+  KeyframeStage keyframes;
+  if (cfg.mode == "rtpbin") {
+    const std::chrono::milliseconds interval(500);
+    if (tiled ? !keyframes.attach_strips(el.tile_tee, el.pay, interval) : !keyframes.attach(el.encoder, interval)) {
+      LOG_WARN("Keyframe request limiter unavailable; PLI/FIR reach the encoder unthrottled");
+    }
+  }
+
+  // Cameras never repeat a frame exactly; screens and test patterns do.
+  StaticContentStage static_content;
+  if (cfg.static_refresh_ms > 0 && cfg.source != "v4l2src") {
+    StaticContentConfig static_cfg;
+    static_cfg.refresh = std::chrono::milliseconds(cfg.static_refresh_ms);
+    static_cfg.keyframe_interval = std::chrono::seconds(cfg.gop_seconds);
+    if (!static_content.attach(el.source, el.encoder, static_cfg)) {
+      LOG_WARN("Static content detection unavailable; unchanged frames are encoded");
+    }
+  }
+
+  LatencyStage latency;
+  if (!latency.attach(el.source, encoders, el.pay)) {
+    LOG_WARN("Latency probes unavailable; capture to packet delay is not reported");
+  }
+
   g_loop = g_main_loop_new(nullptr, FALSE);
   guint bus_watch_id = 0;
   if (bus) {
     bus_watch_id = gst_bus_add_watch(bus, bus_call, nullptr);
   }
 
-  QosController qos;
-  qos.attach(el.rtpbin, el.encoder, bus);
+  // The network policy picks a rung of the profile ladder; the CPU ladder
+  // reduces it further while the encoder cannot keep up.
+  std::mutex caps_mtx;
+  VideoProfile network_profile = cfg.profile;
+  CpuLevel cpu_level;
+  auto update_caps = [&] { configure_caps(el.capsfilter, apply_cpu_level(network_profile, cpu_level)); };
+
+  EncoderLoadStage encoder_load;
+  if (cfg.cpu_adapt) {
+    auto on_level = [&](const CpuLevel& level) {
+      std::lock_guard<std::mutex> lock(caps_mtx);
+      cpu_level = level;
+      update_caps();
+    };
+    if (!encoder_load.attach(el.queue, el.encoder, OverloadConfig{}, on_level)) {
+      LOG_WARN("Encoder load monitoring unavailable; frames dropped by the encoder queue go unnoticed");
+    }
+  }
+
+  AdaptationHooks hooks;
+  if (cfg.fec_percentage > 0) {
+    hooks.set_fec_percentage = [&](int percentage) {
+      if (xor_fec) {
+        xor_stage.set_percentage(percentage);
+      } else {
+        set_ulpfec_percentage(el.pipeline, percentage);
+      }
+    };
+  }
+  if (xor_fec && cfg.fec_percentage > 0) {
+    hooks.set_fec_interleave = [&](int depth) { xor_stage.set_interleave(depth); };
+  }
+  if (cfg.adapt == "joint") {
+    hooks.set_profile = [&](const VideoProfile& profile) {
+      std::lock_guard<std::mutex> lock(caps_mtx);
+      network_profile = profile;
+      update_caps();
+    };
+  }
+  if (cfg.protection == "auto") {
+    hooks.set_rtx_enabled = [&](bool enabled) { rtx_stage.set_enabled(enabled); };
+  }
+  if (probing) {
+    hooks.start_probe = [&](int padding_kbps, std::chrono::milliseconds duration) {
+      probe_stage.start(padding_kbps, duration);
+    };
+  }
+  qos.set_hooks(std::move(hooks));
+  if (cfg.adapt == "joint") {
+    qos.enable_joint_adaptation(make_profile_ladder(cfg.profile), cfg.fec_percentage);
+  }
+  if (cfg.protection == "auto") {
+    ProtectionConfig protection;
+    protection.rtx_window_ms = cfg.rtx_window_ms;
+    qos.enable_protection_selection(protection);
+  }
+  if (probing) qos.enable_probing(ProbeConfig{});
+  if (xor_fec && cfg.fec_percentage > 0) {
+    // Interleaved parity waits for a whole column; keep that within half
+    // the receiver's jitter-buffer budget.
+    FecLayoutConfig layout;
+    layout.max_delay = std::chrono::milliseconds(cfg.rtx_window_ms / 2);
+    qos.enable_loss_patterns(layout);
+  }
   qos.start(1000);
 
   LOG_INFO("Starting pipeline to ", cfg.dest_ip,
@@ -374,13 +776,27 @@ int main(int argc, char** argv) {
            " rtcp_recv=", cfg.ports.rtcp_recv_port,
             ", profile ", cfg.profile.width, "x", cfg.profile.height, "@", cfg.profile.fps,
            ", bitrate=", cfg.profile.bitrate_kbps, "kbps, fec=", cfg.fec_percentage,
-           "%, latency=", cfg.latency_ms, "ms");
+           "% (", cfg.fec_engine, "), protection=", cfg.protection, ", gop=", cfg.gop_seconds,
+           "s, latency=", cfg.latency_ms, "ms", cfg.low_delay ? " (low-delay slices)" : "",
+           cfg.mtu_slices ? ", MTU-sized slices" : "",
+           tiled ? ", tiles=" + std::to_string(cfg.tiles) : std::string());
+  LOG_DEBUG("XOR FEC kernel: ", xor_kernel_name(xor_kernel()));
+
+  const guint stats_id = g_timeout_add_seconds(10, log_qos_stats, &qos);
 
   gst_element_set_state(el.pipeline, GST_STATE_PLAYING);
   g_main_loop_run(g_loop);
 
+  g_source_remove(stats_id);
   qos.stop();
+  probe_stage.detach();
   gst_element_set_state(el.pipeline, GST_STATE_NULL);
+  xor_stage.detach();
+  rtx_stage.detach();
+  keyframes.detach();
+  static_content.detach();
+  latency.detach();
+  encoder_load.detach();
   if (bus_watch_id != 0) g_source_remove(bus_watch_id);
   if (bus) gst_object_unref(bus);
   if (g_loop) { g_main_loop_unref(g_loop); g_loop = nullptr; }
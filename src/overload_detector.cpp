@@ -0,0 +1,81 @@
+#include "overload_detector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using namespace ve;
+
+constexpr int kMinWidth = 320;
+
+int round_to_8(double v) { return std::max(8, static_cast<int>(std::lround(v / 8.0)) * 8); }
+
+}  // namespace
+
+namespace ve {
+
+std::vector<CpuLevel> make_cpu_ladder() {
+  return {{1.0, 1}, {0.75, 1}, {0.75, 2}, {0.5, 2}};
+}
+
+VideoProfile apply_cpu_level(const VideoProfile& profile, const CpuLevel& level) {
+  VideoProfile p = profile;
+  double scale = std::min(level.scale, 1.0);
+  if (profile.width * scale < kMinWidth) scale = std::min(1.0, static_cast<double>(kMinWidth) / profile.width);
+  if (scale < 1.0) {
+    p.width = round_to_8(profile.width * scale);
+    p.height = round_to_8(profile.height * scale);
+  }
+  p.fps = std::max(1, profile.fps / std::max(1, level.fps_divisor));
+  return p;
+}
+
+double OverloadDetector::relative_cost(const CpuLevel& level) {
+  return level.scale * level.scale / std::max(1, level.fps_divisor);
+}
+
+OverloadDetector::OverloadDetector(OverloadConfig cfg, std::vector<CpuLevel> ladder)
+    : cfg_(cfg), ladder_(std::move(ladder)), underuse_hold_(cfg.underuse_hold) {
+  if (ladder_.empty()) ladder_.push_back(CpuLevel{});
+}
+
+bool OverloadDetector::update(const LoadSample& sample, Clock::time_point now) {
+  if (sample.window.count() <= 0) return false;
+  usage_ = sample.busy_ms / static_cast<double>(sample.window.count());
+  const int offered = sample.frames + sample.dropped;
+  const bool dropping = offered > 0 && sample.dropped > cfg_.max_drop_ratio * offered;
+  busy_windows_ = usage_ > cfg_.high_usage ? busy_windows_ + 1 : 0;
+
+  // Measurements straddling a switch describe the old rung.
+  if (last_switch_ != Clock::time_point{} && now - last_switch_ < cfg_.settle) {
+    idle_since_ = {};
+    return false;
+  }
+
+  if (dropping || busy_windows_ >= cfg_.overuse_windows) {
+    idle_since_ = {};
+    busy_windows_ = 0;
+    if (level_ + 1 >= ladder_.size()) return false;
+    if (last_up_ != Clock::time_point{} && now - last_up_ < underuse_hold_) {
+      underuse_hold_ = std::min(underuse_hold_ * 2, cfg_.max_underuse_hold);
+    }
+    ++level_;
+    last_switch_ = now;
+    return true;
+  }
+
+  if (level_ == 0 || sample.dropped > 0 ||
+      usage_ * relative_cost(ladder_[level_ - 1]) / relative_cost(ladder_[level_]) >= cfg_.low_usage) {
+    idle_since_ = {};
+    return false;
+  }
+  if (idle_since_ == Clock::time_point{}) idle_since_ = now;
+  if (now - idle_since_ < underuse_hold_) return false;
+  --level_;
+  idle_since_ = {};
+  last_switch_ = last_up_ = now;
+  return true;
+}
+
+}  // namespace ve
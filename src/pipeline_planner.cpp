@@ -0,0 +1,139 @@
+#include "pipeline_planner.h"
+
+#include <algorithm>
+
+namespace {
+
+using namespace ve;
+
+constexpr const char* kTargetFormat = "I420";
+
+// Frame geometry and rate as it flows through the chain.
+struct FrameFlow {
+  double width = 0.0;
+  double height = 0.0;
+  double bpp = 0.0;
+  double fps = 0.0;
+  bool converted = false;
+};
+
+// Memory traffic (bytes read plus written per second) of running `stages`
+// on `source`; stages that would be passthrough cost nothing.
+double chain_cost(const std::vector<RawStage>& stages, const SourceFormat& source, const VideoProfile& target) {
+  FrameFlow f;
+  f.width = source.width > 0 ? source.width : target.width;
+  f.height = source.height > 0 ? source.height : target.height;
+  f.bpp = format_bytes_per_pixel(source.format);
+  f.fps = source.fps > 0.0 ? source.fps : target.fps;
+  f.converted = source.format == kTargetFormat;
+
+  double cost = 0.0;
+  for (RawStage stage : stages) {
+    switch (stage) {
+      case RawStage::Rate:
+        // Drop-only: forwards buffers by reference.
+        f.fps = std::min(f.fps, static_cast<double>(target.fps));
+        break;
+      case RawStage::Scale:
+        if (f.width != target.width || f.height != target.height) {
+          cost += f.fps * f.bpp * (f.width * f.height + static_cast<double>(target.width) * target.height);
+          f.width = target.width;
+          f.height = target.height;
+        }
+        break;
+      case RawStage::Convert:
+        if (!f.converted) {
+          const double out_bpp = format_bytes_per_pixel(kTargetFormat);
+          cost += f.fps * f.width * f.height * (f.bpp + out_bpp);
+          f.bpp = out_bpp;
+          f.converted = true;
+        }
+        break;
+      case RawStage::ConvertScale:
+        if (!f.converted) {
+          const double out_bpp = format_bytes_per_pixel(kTargetFormat);
+          cost += f.fps * (f.bpp * f.width * f.height + out_bpp * target.width * target.height);
+          f.width = target.width;
+          f.height = target.height;
+          f.bpp = out_bpp;
+          f.converted = true;
+        }
+        break;
+    }
+  }
+  return cost;
+}
+
+}  // namespace
+
+namespace ve {
+
+const char* raw_stage_element(RawStage stage) {
+  switch (stage) {
+    case RawStage::Rate: return "videorate";
+    case RawStage::Scale: return "videoscale";
+    case RawStage::Convert: return "videoconvert";
+    case RawStage::ConvertScale: return "veconvertscale";
+  }
+  return "?";
+}
+
+std::string RawChainPlan::describe() const {
+  std::string out;
+  for (RawStage stage : stages) {
+    if (!out.empty()) out += " -> ";
+    out += raw_stage_element(stage);
+  }
+  return out.empty() ? "(passthrough)" : out;
+}
+
+double format_bytes_per_pixel(const std::string& format) {
+  if (format == "I420" || format == "YV12" || format == "NV12" || format == "NV21") return 1.5;
+  if (format == "YUY2" || format == "UYVY" || format == "YVYU" || format == "NV16") return 2.0;
+  if (format == "RGB" || format == "BGR" || format == "Y444") return 3.0;
+  if (format == "GRAY8") return 1.0;
+  return 4.0;  // BGRx, RGBA, ... and unknown
+}
+
+bool fused_convert_scale_accepts(const std::string& format) {
+  return format == "BGRx" || format == "BGRA" || format == "RGBx" || format == "RGBA";
+}
+
+RawChainPlan plan_raw_chain(const SourceFormat& source, const VideoProfile& target,
+                            const PlanConstraints& constraints) {
+  RawChainPlan plan;
+  plan.naive_bytes_per_second = chain_cost({RawStage::Convert, RawStage::Scale, RawStage::Rate}, source, target);
+
+  const std::vector<RawStage> scale_first = {RawStage::Rate, RawStage::Scale, RawStage::Convert};
+  const std::vector<RawStage> convert_first = {RawStage::Rate, RawStage::Convert, RawStage::Scale};
+  // Ties go to scaling first: the ladders only ever shrink the picture.
+  const double scale_cost = chain_cost(scale_first, source, target);
+  const double convert_cost = chain_cost(convert_first, source, target);
+  const bool scale_wins = scale_cost <= convert_cost;
+
+  const bool rate_idle = source.fps > 0.0 && source.fps <= target.fps && !constraints.fps_may_change;
+  const bool scale_idle = source.width == target.width && source.height == target.height &&
+                          !constraints.size_may_change;
+  const bool convert_idle = source.format == kTargetFormat;
+  // Reads the source once and writes only I420, so it beats either order.
+  if (constraints.fused_convert_scale && fused_convert_scale_accepts(source.format)) {
+    const std::vector<RawStage> fused = {RawStage::Rate, RawStage::ConvertScale};
+    for (RawStage stage : fused) {
+      if (stage == RawStage::Rate && rate_idle) continue;
+      plan.stages.push_back(stage);
+    }
+    plan.bytes_per_second = chain_cost(fused, source, target);
+    return plan;
+  }
+  for (RawStage stage : scale_wins ? scale_first : convert_first) {
+    if ((stage == RawStage::Rate && rate_idle) || (stage == RawStage::Scale && scale_idle) ||
+        (stage == RawStage::Convert && convert_idle)) {
+      continue;
+    }
+    plan.stages.push_back(stage);
+  }
+  plan.bytes_per_second = std::min(scale_cost, convert_cost);
+  return plan;
+}
+
+}  // namespace ve
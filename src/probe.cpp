@@ -0,0 +1,117 @@
+#include "probe.h"
+
+#include <algorithm>
+
+namespace {
+
+using namespace ve;
+
+// Feedback for a cluster normally arrives one RTT after it ends.
+constexpr auto kClusterTimeout = std::chrono::seconds(1);
+
+double to_ms(std::chrono::steady_clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+}  // namespace
+
+namespace ve {
+
+std::optional<int> probe_delivery_kbps(std::span<const PacketResult> packets, int min_packets) {
+  std::vector<const PacketResult*> received;
+  received.reserve(packets.size());
+  for (const auto& p : packets) {
+    if (p.received) received.push_back(&p);
+  }
+  if (static_cast<int>(received.size()) < std::max(min_packets, 2) || packets.size() < 2) {
+    return std::nullopt;
+  }
+
+  std::size_t sent_bytes = 0;
+  for (std::size_t i = 0; i + 1 < packets.size(); ++i) sent_bytes += packets[i].bytes;
+  const double send_ms = to_ms(packets.back().send_time - packets.front().send_time);
+
+  std::sort(received.begin(), received.end(),
+            [](const PacketResult* a, const PacketResult* b) { return a->arrival < b->arrival; });
+  std::size_t recv_bytes = 0;
+  for (std::size_t i = 1; i < received.size(); ++i) recv_bytes += received[i]->bytes;
+  const double recv_ms =
+      std::chrono::duration<double, std::milli>(received.back()->arrival - received.front()->arrival).count();
+  if (send_ms <= 0.0 || recv_ms <= 0.0) return std::nullopt;
+
+  const double send_kbps = sent_bytes * 8.0 / send_ms;
+  const double recv_kbps = recv_bytes * 8.0 / recv_ms;
+  if (recv_kbps < 0.9 * send_kbps) return static_cast<int>(recv_kbps * 0.95);
+  return static_cast<int>(std::min(send_kbps, recv_kbps));
+}
+
+BandwidthProber::BandwidthProber(ProbeConfig cfg) : cfg_(cfg), interval_(cfg.interval) {}
+
+std::optional<ProbeCluster> BandwidthProber::update(int estimate_kbps, int max_kbps, BandwidthUsage usage,
+                                                    double fraction_lost, Clock::time_point now) {
+  if (estimate_kbps >= peak_kbps_) {
+    peak_kbps_ = estimate_kbps;
+  } else if (estimate_kbps < cfg_.drop_ratio * peak_kbps_) {
+    // Large drop: remember where we were, and start over from here.
+    recovery_kbps_ = peak_kbps_;
+    drop_time_ = now;
+    peak_kbps_ = estimate_kbps;
+  }
+
+  if (active_ || usage == BandwidthUsage::Overusing || fraction_lost > cfg_.max_loss) return std::nullopt;
+  if (estimate_kbps >= 0.95 * max_kbps) {
+    recovery_kbps_ = 0;
+    return std::nullopt;
+  }
+
+  int target = 0;
+  if (recovery_kbps_ > estimate_kbps && now - drop_time_ >= cfg_.settle) {
+    target = recovery_kbps_;
+    recovery_kbps_ = 0;
+  } else if (!started_ || now - last_probe_ >= interval_) {
+    target = static_cast<int>(estimate_kbps * cfg_.rate_factor);
+  } else {
+    return std::nullopt;
+  }
+
+  started_ = true;
+  active_ = true;
+  last_probe_ = now;
+  estimate_at_probe_ = estimate_kbps;
+  results_.clear();
+  cluster_.target_kbps = std::min(target, max_kbps);
+  cluster_.start = now;
+  cluster_.end = now + cfg_.duration;
+  return cluster_;
+}
+
+std::optional<int> BandwidthProber::on_feedback(std::span<const PacketResult> packets,
+                                                Clock::time_point now) {
+  if (!active_) return std::nullopt;
+  bool complete = false;
+  for (const auto& p : packets) {
+    if (p.send_time >= cluster_.end) {
+      complete = true;
+    } else if (p.send_time >= cluster_.start) {
+      results_.push_back(p);
+    }
+  }
+  if (!complete) {
+    if (now - cluster_.end > kClusterTimeout) active_ = false;
+    return std::nullopt;
+  }
+
+  active_ = false;
+  const std::optional<int> kbps = probe_delivery_kbps(results_, cfg_.min_packets);
+  results_.clear();
+  // Probes that find no headroom back off, so a link at capacity is not
+  // pushed into its queue every few seconds.
+  if (kbps && *kbps > estimate_at_probe_ * 1.1) {
+    interval_ = cfg_.interval;
+  } else {
+    interval_ = std::min(interval_ * 2, cfg_.max_interval);
+  }
+  return kbps;
+}
+
+}  // namespace ve
@@ -0,0 +1,119 @@
+#include "probe_stage.h"
+#include "logger.h"
+
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/rtp/rtp.h>
+
+
+namespace {
+
+// The padding length is a single octet, so a padding-only packet carries
+// at most 255 bytes after the header.
+constexpr guint kProbePaddingSize = 255;
+
+}  // namespace
+
+namespace ve {
+
+ProbeStage::ProbeStage() = default;
+ProbeStage::~ProbeStage() { detach(); }
+
+bool ProbeStage::attach(GstElement* probe_src, std::uint32_t ssrc, unsigned int payload_type) {
+  detach();
+  if (!probe_src) return false;
+  GstCaps* caps = gst_caps_new_simple("application/x-rtp",
+                                      "media", G_TYPE_STRING, "video",
+                                      "clock-rate", G_TYPE_INT, 90000,
+                                      "payload", G_TYPE_INT, static_cast<gint>(payload_type),
+                                      NULL);
+  g_object_set(probe_src,
+               "caps", caps,
+               "is-live", TRUE,
+               "format", GST_FORMAT_TIME,
+               "do-timestamp", TRUE,
+               NULL);
+  gst_caps_unref(caps);
+
+  probe_src_ = GST_ELEMENT(gst_object_ref(probe_src));
+  ssrc_ = ssrc;
+  payload_type_ = payload_type;
+  seq_ = static_cast<std::uint16_t>(g_random_int());
+  stopping_ = false;
+  thread_ = std::thread([this] { run(); });
+  return true;
+}
+
+void ProbeStage::detach() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) thread_.join();
+  if (probe_src_) {
+    LOG_INFO("Probing: ", packets_, " padding packets sent");
+    gst_object_unref(probe_src_);
+  }
+  probe_src_ = nullptr;
+}
+
+void ProbeStage::start(int padding_kbps, std::chrono::milliseconds duration) {
+  if (padding_kbps <= 0 || duration.count() <= 0) return;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    padding_kbps_ = padding_kbps;
+    duration_ = duration;
+    pending_ = true;
+  }
+  cv_.notify_all();
+}
+
+void ProbeStage::run() {
+  using Clock = std::chrono::steady_clock;
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (true) {
+    cv_.wait(lock, [this] { return stopping_ || pending_; });
+    if (stopping_) return;
+    pending_ = false;
+
+    const double bits = (kProbePaddingSize + 12) * 8.0;
+    const auto gap = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(bits / padding_kbps_));
+    const auto end = Clock::now() + duration_;
+    LOG_DEBUG("Probing: ", padding_kbps_, " kbps padding for ", duration_.count(), " ms");
+
+    // Paced with the lock released; a new request or stop wakes the wait.
+    auto next = Clock::now();
+    while (next < end) {
+      lock.unlock();
+      push_packet();
+      lock.lock();
+      next += gap;
+      if (cv_.wait_until(lock, next, [this] { return stopping_ || pending_; })) break;
+    }
+  }
+}
+
+void ProbeStage::push_packet() {
+  // Sets the P bit and writes the padding length into the last octet.
+  GstBuffer* buf = gst_rtp_buffer_new_allocate(0, kProbePaddingSize, 0);
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  if (gst_rtp_buffer_map(buf, GST_MAP_WRITE, &rtp)) {
+    gst_rtp_buffer_set_payload_type(&rtp, static_cast<guint8>(payload_type_));
+    gst_rtp_buffer_set_ssrc(&rtp, ssrc_);
+    gst_rtp_buffer_set_seq(&rtp, seq_++);
+    // 90 kHz media clock, so receivers' jitter estimates stay sane.
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    gst_rtp_buffer_set_timestamp(
+        &rtp, static_cast<guint32>(std::chrono::duration_cast<std::chrono::microseconds>(now).count() * 9 / 100));
+    gst_rtp_buffer_unmap(&rtp);
+  }
+  if (gst_app_src_push_buffer(GST_APP_SRC(probe_src_), buf) == GST_FLOW_OK) {
+    ++packets_;
+  } else {
+    LOG_DEBUG("Probing: appsrc refused padding packet");
+  }
+}
+
+}  // namespace ve
@@ -0,0 +1,75 @@
+#include "protection.h"
+
+#include <algorithm>
+
+namespace {
+
+using namespace ve;
+
+// Ordered by how much redundancy goes on the wire.
+int strength(ProtectionMode mode) {
+  switch (mode) {
+    case ProtectionMode::Rtx: return 0;
+    case ProtectionMode::Hybrid: return 1;
+    case ProtectionMode::Fec: return 2;
+  }
+  return 2;
+}
+
+}  // namespace
+
+namespace ve {
+
+const char* protection_mode_name(ProtectionMode mode) {
+  switch (mode) {
+    case ProtectionMode::Fec: return "fec";
+    case ProtectionMode::Rtx: return "rtx";
+    case ProtectionMode::Hybrid: return "fec+rtx";
+  }
+  return "unknown";
+}
+
+ProtectionSelector::ProtectionSelector(ProtectionConfig cfg) : cfg_(cfg) {
+  cfg_.rtx_window_ms = std::max(cfg_.rtx_window_ms, 1.0);
+  cfg_.hysteresis = std::clamp(cfg_.hysteresis, 0.0, 0.9);
+}
+
+ProtectionMode ProtectionSelector::target(double srtt_ms) const {
+  // Each threshold is pushed away from the current mode, so an RTT hovering
+  // at a boundary does not flip the mode back and forth.
+  const double rtx_limit = cfg_.rtx_window_ms / 2.0 *
+                           (mode_ == ProtectionMode::Rtx ? 1.0 + cfg_.hysteresis : 1.0 - cfg_.hysteresis);
+  const double hybrid_limit = cfg_.rtx_window_ms *
+                              (mode_ == ProtectionMode::Fec ? 1.0 - cfg_.hysteresis : 1.0 + cfg_.hysteresis);
+
+  ProtectionMode mode = ProtectionMode::Fec;
+  if (srtt_ms <= rtx_limit) {
+    mode = ProtectionMode::Rtx;
+  } else if (srtt_ms <= hybrid_limit) {
+    mode = ProtectionMode::Hybrid;
+  }
+  if (mode == ProtectionMode::Rtx && loss_ > cfg_.hybrid_loss) mode = ProtectionMode::Hybrid;
+  return mode;
+}
+
+bool ProtectionSelector::update(double srtt_ms, double fraction_lost, Clock::time_point now) {
+  fraction_lost = std::clamp(fraction_lost, 0.0, 1.0);
+  loss_ = have_loss_ ? 0.7 * loss_ + 0.3 * fraction_lost : fraction_lost;
+  have_loss_ = true;
+  if (srtt_ms <= 0.0) return false;
+
+  const ProtectionMode want = target(srtt_ms);
+  if (want == mode_) {
+    relax_since_ = {};
+    return false;
+  }
+  if (strength(want) < strength(mode_)) {
+    if (relax_since_ == Clock::time_point{}) relax_since_ = now;
+    if (now - relax_since_ < cfg_.hold) return false;
+  }
+  mode_ = want;
+  relax_since_ = {};
+  return true;
+}
+
+}  // namespace ve
@@ -2,63 +2,125 @@
 #include "logger.h"
 
 #include <gst/gst.h>
-#include <chrono>
-#include <thread>
+#include <gst/rtp/rtp.h>
 #include <algorithm>
+#include <array>
+#include <cstring>
 
 namespace {
 
 using namespace ve;
 
-bool extract_field_from_value(const GValue* value, const char* field, double& out) {
-  if (!value) return false;
-  if (GST_VALUE_HOLDS_STRUCTURE(value)) {
-    const GstStructure* st = gst_value_get_structure(value);
-    if (gst_structure_has_field(st, field)) {
-      double tmp = 0.0;
-      if (gst_structure_get_double(st, field, &tmp)) {
-        out = tmp;
-        return true;
-      }
-    }
-    for (gint i = 0; i < gst_structure_n_fields(st); ++i) {
-      const char* name = gst_structure_nth_field_name(st, i);
-      if (extract_field_from_value(gst_structure_get_value(st, name), field, out)) {
-        return true;
-      }
-    }
-  } else if (GST_VALUE_HOLDS_ARRAY(value)) {
-    for (guint i = 0; i < gst_value_array_get_size(value); ++i) {
-      if (extract_field_from_value(gst_value_array_get_value(value, i), field, out)) {
-        return true;
-      }
-    }
-  } else if (GST_VALUE_HOLDS_LIST(value)) {
-    for (guint i = 0; i < gst_value_list_get_size(value); ++i) {
-      if (extract_field_from_value(gst_value_list_get_value(value, i), field, out)) {
-        return true;
-      }
-    }
+// RTPSession "on-ssrc-active": emitted on the RTCP thread after an SR/RR from
+// src has been processed, so its report-block fields are current.
+void on_ssrc_active(GObject*, GObject* src, gpointer user_data) {
+  GstStructure* stats = nullptr;
+  g_object_get(src, "stats", &stats, NULL);
+  if (!stats) return;
+  static_cast<QosController*>(user_data)->on_source_stats(stats);
+  gst_structure_free(stats);
+}
+
+// RTPSession "on-feedback-rtcp": fci excludes the sender/media SSRCs.
+void on_feedback_rtcp(GObject*, guint type, guint fbtype, guint, guint, GstBuffer* fci,
+                      gpointer user_data) {
+  if (type != kRtcpRtpfb || fbtype != kTwccFmt || !fci) return;
+  GstMapInfo map;
+  if (!gst_buffer_map(fci, &map, GST_MAP_READ)) return;
+  static_cast<QosController*>(user_data)->on_transport_feedback(
+      std::span<const std::uint8_t>(map.data, map.size));
+  gst_buffer_unmap(fci, &map);
+}
+
+// RTPSession "on-receiving-rtcp": the whole compound packet, before the
+// session parses it (it ignores XR blocks it does not know).
+void on_receiving_rtcp(GObject*, GstBuffer* buffer, gpointer user_data) {
+  GstMapInfo map;
+  if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) return;
+  static_cast<QosController*>(user_data)->on_rtcp(std::span<const std::uint8_t>(map.data, map.size));
+  gst_buffer_unmap(buffer, &map);
+}
+
+// Writes a transport-wide sequence number as an RFC 8285 one-byte header
+// extension, replacing the one the packet carries, if any.
+void stamp_buffer(GstBuffer* buffer, std::uint16_t seq, int ext_id) {
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  if (!gst_rtp_buffer_map(buffer, GST_MAP_READWRITE, &rtp)) return;
+  const guint8 data[2] = {static_cast<guint8>(seq >> 8), static_cast<guint8>(seq)};
+  gpointer current = nullptr;
+  guint size = 0;
+  if (gst_rtp_buffer_get_extension_onebyte_header(&rtp, static_cast<guint8>(ext_id), 0, &current, &size) &&
+      size == sizeof(data)) {
+    std::memcpy(current, data, sizeof(data));
+  } else {
+    gst_rtp_buffer_add_extension_onebyte_header(&rtp, static_cast<guint8>(ext_id), data, sizeof(data));
+  }
+  gst_rtp_buffer_unmap(&rtp);
+}
+
+// Records the first send of a packet numbered at the payloader. False if it
+// needs a number of its own: none yet, or a retransmitted copy repeating its
+// original's.
+bool record_numbered(GstBuffer* buffer, QosController* qos) {
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  if (!gst_rtp_buffer_map(buffer, GST_MAP_READ, &rtp)) return true;  // not RTP: leave alone
+  gpointer data = nullptr;
+  guint size = 0;
+  bool numbered = gst_rtp_buffer_get_extension_onebyte_header(
+                      &rtp, static_cast<guint8>(qos->transport_cc_ext_id()), 0, &data, &size) &&
+                  size >= 2;
+  if (numbered) {
+    const auto* bytes = static_cast<const guint8*>(data);
+    numbered = qos->on_rtp_sent(static_cast<std::uint16_t>((bytes[0] << 8) | bytes[1]), gst_buffer_get_size(buffer));
   }
-  return false;
+  gst_rtp_buffer_unmap(&rtp);
+  return numbered;
 }
 
-bool extract_field_from_structure(const GstStructure* st, const char* field, double& out) {
-  if (!st) return false;
-  if (gst_structure_has_field(st, field)) {
-    double tmp = 0.0;
-    if (gst_structure_get_double(st, field, &tmp)) {
-      out = tmp;
-      return true;
+void renumber(GstBuffer* buffer, QosController* qos) {
+  stamp_buffer(buffer, qos->on_unnumbered_rtp_sent(gst_buffer_get_size(buffer)), qos->transport_cc_ext_id());
+}
+
+// Payloader output, ahead of rtpbin's FEC encoder and the XOR FEC tap.
+GstPadProbeReturn on_rtp_payloaded(GstPad*, GstPadProbeInfo* info, gpointer user_data) {
+  auto* qos = static_cast<QosController*>(user_data);
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer* buffer = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+    stamp_buffer(buffer, qos->assign_transport_seq(), qos->transport_cc_ext_id());
+    GST_PAD_PROBE_INFO_DATA(info) = buffer;
+  } else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList* list = gst_buffer_list_make_writable(GST_PAD_PROBE_INFO_BUFFER_LIST(info));
+    const guint n = gst_buffer_list_length(list);
+    for (guint i = 0; i < n; ++i) {
+      stamp_buffer(gst_buffer_list_get_writable(list, i), qos->assign_transport_seq(), qos->transport_cc_ext_id());
     }
+    GST_PAD_PROBE_INFO_DATA(info) = list;
   }
-  for (gint i = 0; i < gst_structure_n_fields(st); ++i) {
-    const char* name = gst_structure_nth_field_name(st, i);
-    if (extract_field_from_value(gst_structure_get_value(st, name), field, out)) {
-      return true;
+  return GST_PAD_PROBE_OK;
+}
+
+// Socket input: send times only, except for packets that join the RTP
+// stream after the payloader (FEC parity, probe padding) and RTX copies,
+// which get a fresh number here. Feedback then times a retransmission
+// against its own send, not the lost original's.
+GstPadProbeReturn on_rtp_out(GstPad*, GstPadProbeInfo* info, gpointer user_data) {
+  auto* qos = static_cast<QosController*>(user_data);
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    if (!record_numbered(GST_PAD_PROBE_INFO_BUFFER(info), qos)) {
+      GstBuffer* buffer = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+      renumber(buffer, qos);
+      GST_PAD_PROBE_INFO_DATA(info) = buffer;
+    }
+  } else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList* list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+    for (guint i = 0; i < gst_buffer_list_length(list); ++i) {
+      if (record_numbered(gst_buffer_list_get(list, i), qos)) continue;
+      list = gst_buffer_list_make_writable(list);
+      GST_PAD_PROBE_INFO_DATA(info) = list;
+      renumber(gst_buffer_list_get_writable(list, i), qos);
     }
   }
-  return false;
+  return GST_PAD_PROBE_OK;
 }
 
 }  // namespace
@@ -66,93 +128,249 @@ bool extract_field_from_structure(const GstStructure* st, const char* field, dou
 namespace ve {
 
 QosController::QosController() = default;
-QosController::~QosController() { stop(); }
+QosController::~QosController() {
+  stop();
+  detach();
+}
 
 void QosController::attach(GstElement* rtpbin, GstElement* encoder, GstBus* bus) {
+  detach();
   rtpbin_ = rtpbin;
   encoder_ = encoder;
   bus_ = bus;
   if (encoder_) {
     unsigned int bitrate = 0;
     g_object_get(encoder_, "bitrate", &bitrate, NULL);
-    base_bitrate_ = bitrate > 0 ? bitrate : 4000;
-    min_bitrate_ = std::max(500u, static_cast<unsigned int>(base_bitrate_ * 6 / 10));
-    max_bitrate_ = std::max(base_bitrate_, static_cast<unsigned int>(base_bitrate_ * 15 / 10));
+    rates_ = std::make_unique<RateController>(bitrate);
+  }
+  if (!rtpbin_) {
+    LOG_DEBUG("QoS: no rtpbin, RTCP feedback disabled");
+    return;
+  }
+
+  g_signal_emit_by_name(rtpbin_, "get-internal-session", 0, &session_);
+  if (!session_) {
+    LOG_WARN("QoS: rtpbin has no session 0, RTCP feedback disabled");
+    return;
+  }
+  handler_id_ = g_signal_connect(session_, "on-ssrc-active", G_CALLBACK(on_ssrc_active), this);
+}
+
+void QosController::enable_joint_adaptation(std::vector<VideoProfile> ladder, int fec_percentage) {
+  if (!rates_ || ladder.empty()) return;
+  rates_->enable_joint_adaptation(std::move(ladder), hooks_.set_fec_percentage ? fec_percentage : 0);
+  const AdaptationPolicy* policy = rates_->policy();
+  LOG_INFO("QoS: joint adaptation over ", policy->ladder().size(), " profiles, ", rates_->min_kbps(),
+           "-", rates_->max_kbps(), " kbps, FEC ", policy->fec_percentage(), "%");
+}
+
+void QosController::set_fec_percentage(int fec_percentage) {
+  if (rates_) rates_->set_fec_percentage(fec_percentage);
+}
+
+void QosController::enable_protection_selection(const ProtectionConfig& cfg) {
+  if (!rates_ || !session_) return;
+  rates_->enable_protection_selection(cfg);
+  const ProtectionMode mode = rates_->protection()->mode();
+  if (hooks_.set_rtx_enabled) hooks_.set_rtx_enabled(mode != ProtectionMode::Fec);
+  LOG_INFO("QoS: loss repair chosen from RTT (RTX below ", cfg.rtx_window_ms / 2.0, " ms, FEC above ",
+           cfg.rtx_window_ms, " ms), starting with ", protection_mode_name(mode));
+}
+
+void QosController::enable_probing(const ProbeConfig& cfg) {
+  if (!rates_ || !rtp_pad_ || !hooks_.start_probe) return;
+  rates_->enable_probing(cfg);
+  LOG_INFO("QoS: bandwidth probing with ", cfg.duration.count(), " ms clusters every ",
+           cfg.interval.count() / 1000, " s or more");
+}
+
+void QosController::enable_loss_patterns(const FecLayoutConfig& cfg) {
+  if (!rates_ || !session_ || !hooks_.set_fec_interleave || xr_id_ != 0) return;
+  rates_->enable_loss_patterns(cfg);
+  xr_id_ = g_signal_connect(session_, "on-receiving-rtcp", G_CALLBACK(on_receiving_rtcp), this);
+  LOG_INFO("QoS: FEC interleave from RTCP XR loss patterns", rtp_pad_ ? " and transport-wide feedback" : "",
+           ", repair delay up to ", cfg.max_delay.count(), " ms");
+}
+
+bool QosController::enable_transport_cc(GstElement* pay, GstElement* rtp_sink, int ext_id) {
+  if (!session_ || !pay || !rtp_sink || ext_id < 1 || ext_id > 14 || rtp_pad_) return false;
+  pay_pad_ = gst_element_get_static_pad(pay, "src");
+  rtp_pad_ = gst_element_get_static_pad(rtp_sink, "sink");
+  if (!pay_pad_ || !rtp_pad_) {
+    detach_transport_cc();
+    return false;
   }
+  twcc_ext_id_ = ext_id;
+  stamp_id_ = gst_pad_add_probe(
+      pay_pad_, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+      on_rtp_payloaded, this, nullptr);
+  probe_id_ = gst_pad_add_probe(
+      rtp_pad_, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+      on_rtp_out, this, nullptr);
+  feedback_id_ = g_signal_connect(session_, "on-feedback-rtcp", G_CALLBACK(on_feedback_rtcp), this);
+  LOG_INFO("QoS: transport-wide CC on header extension ", ext_id, " (", kTwccExtensionUri, ")");
+  return stamp_id_ != 0 && probe_id_ != 0;
+}
+
+void QosController::detach_transport_cc() {
+  if (pay_pad_) {
+    if (stamp_id_ != 0) gst_pad_remove_probe(pay_pad_, stamp_id_);
+    gst_object_unref(pay_pad_);
+  }
+  if (rtp_pad_) {
+    if (probe_id_ != 0) gst_pad_remove_probe(rtp_pad_, probe_id_);
+    gst_object_unref(rtp_pad_);
+  }
+  pay_pad_ = rtp_pad_ = nullptr;
+  stamp_id_ = probe_id_ = 0;
+}
+
+void QosController::detach() {
+  detach_transport_cc();
+  if (session_) {
+    if (handler_id_ != 0) g_signal_handler_disconnect(session_, handler_id_);
+    if (feedback_id_ != 0) g_signal_handler_disconnect(session_, feedback_id_);
+    if (xr_id_ != 0) g_signal_handler_disconnect(session_, xr_id_);
+    g_object_unref(session_);
+  }
+  session_ = nullptr;
+  handler_id_ = feedback_id_ = xr_id_ = 0;
 }
 
 void QosController::start(int interval_ms) {
+  std::lock_guard<std::mutex> lock(mtx_);
   if (running_) return;
-  interval_ms_ = interval_ms;
+  if (rates_) rates_->set_increase_interval(std::chrono::milliseconds(interval_ms));
   running_ = true;
-  worker_ = std::thread([this]{ run_loop(); });
 }
 
 void QosController::stop() {
-  if (!running_) return;
+  // Taking the lock waits out a report being handled on the RTCP thread.
+  std::lock_guard<std::mutex> lock(mtx_);
   running_ = false;
-  if (worker_.joinable()) worker_.join();
-}
-
-void QosController::run_loop() {
-  // NOTE: In a full implementation, query rtpbin stats (RR reports) and adjust encoder bitrate.
-  // Here we provide a stub that could be extended. We keep bitrate steady unless we detect errors.
-  int stable_count = 0;
-  while (running_) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms_));
-
-    if (!encoder_) continue;
-
-    double fraction_lost = 0.0;
-    bool have_stats = false;
-
-    if (rtpbin_) {
-      GObject* session = nullptr;
-      g_signal_emit_by_name(rtpbin_, "get-internal-session", 0, &session);
-      if (session) {
-        GstStructure* stats = nullptr;
-        g_object_get(session, "stats", &stats, NULL);
-        if (stats) {
-          if (extract_field_from_structure(stats, "fraction-lost", fraction_lost)) {
-            have_stats = true;
-          }
-          gst_structure_free(stats);
-        }
-        g_object_unref(session);
-      }
-    }
+}
 
-    if (!have_stats) {
-      if ((++stable_count % 10) == 0) {
-        LOG_DEBUG("QoS: no stats available yet");
-      }
-      continue;
-    }
+void QosController::on_source_stats(const GstStructure* stats) {
+  gboolean internal = FALSE;
+  gboolean have_rb = FALSE;
+  gst_structure_get_boolean(stats, "internal", &internal);
+  gst_structure_get_boolean(stats, "have-rb", &have_rb);
+  if (internal || !have_rb) return;
 
-    fraction_lost = std::clamp(fraction_lost, 0.0, 1.0);
+  guint ssrc = 0, fraction = 0, ext_seq = 0, lsr = 0, round_trip = 0;
+  gst_structure_get_uint(stats, "ssrc", &ssrc);
+  gst_structure_get_uint(stats, "rb-exthighestseq", &ext_seq);
+  gst_structure_get_uint(stats, "rb-lsr", &lsr);
+  if (!gst_structure_get_uint(stats, "rb-fractionlost", &fraction)) return;
+  gst_structure_get_uint(stats, "rb-round-trip", &round_trip);
 
-    unsigned int bitrate = 0;
-    g_object_get(encoder_, "bitrate", &bitrate, NULL);
-    if (bitrate == 0) bitrate = base_bitrate_;
+  // An SR or an RR without a block for us leaves the previous block in place.
+  if (ssrc == last_rb_ssrc_ && ext_seq == last_rb_seq_ && lsr == last_rb_lsr_) return;
+  last_rb_ssrc_ = ssrc;
+  last_rb_seq_ = ext_seq;
+  last_rb_lsr_ = lsr;
+
+  // fraction lost is 8-bit fixed point; round trip is in 1/65536 s.
+  on_receiver_report(fraction / 256.0, round_trip * 1000.0 / 65536.0);
+}
+
+void QosController::on_receiver_report(double fraction_lost, double rtt_ms) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (!running_ || !rates_) return;
+  apply(rates_->on_receiver_report(fraction_lost, rtt_ms, Clock::now()));
+}
+
+std::uint16_t QosController::assign_transport_seq() {
+  std::lock_guard<std::mutex> lock(history_mtx_);
+  return history_.assign();
+}
+
+bool QosController::on_rtp_sent(std::uint16_t seq, std::size_t bytes) {
+  const auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(history_mtx_);
+  return history_.sent(seq, bytes, now);
+}
+
+std::uint16_t QosController::on_unnumbered_rtp_sent(std::size_t bytes) {
+  const auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(history_mtx_);
+  return history_.record(bytes, now);
+}
 
-    if (fraction_lost > 0.08 && bitrate > min_bitrate_) {
-      unsigned int new_rate = std::max(min_bitrate_, static_cast<unsigned int>(bitrate * 85 / 100));
-      if (new_rate < bitrate) {
-        g_object_set(encoder_, "bitrate", new_rate, NULL);
-        LOG_WARN("QoS: high loss (", fraction_lost * 100.0, "%) -> bitrate ", bitrate, " -> ", new_rate, " kbps");
+void QosController::on_transport_feedback(std::span<const std::uint8_t> fci) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (!running_ || !rates_) return;
+  TwccFeedback feedback;
+  if (!parse_twcc_fci(fci, feedback, &twcc_reference_)) {
+    LOG_DEBUG("QoS: malformed transport-wide feedback (", fci.size(), " bytes)");
+    return;
+  }
+  results_.clear();
+  {
+    std::lock_guard<std::mutex> history_lock(history_mtx_);
+    history_.resolve(feedback, results_);
+  }
+  if (results_.empty()) return;
+  apply(rates_->on_transport_feedback(results_, Clock::now()));
+}
+
+void QosController::on_rtcp(std::span<const std::uint8_t> compound) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (!running_ || !rates_ || !rates_->loss_patterns()) return;
+  xr_.clear();
+  if (!parse_rtcp_xr(compound, xr_)) {
+    LOG_DEBUG("QoS: malformed RTCP compound (", compound.size(), " bytes)");
+    return;
+  }
+  for (const XrReport& report : xr_) {
+    for (const XrLossRle& block : report.loss_rle) rates_->on_loss_rle(report.sender_ssrc, block);
+    for (const XrStatsSummary& summary : report.summaries) {
+      if (!summary.has_loss) continue;
+      LOG_DEBUG("QoS: XR from ", report.sender_ssrc, ": ", summary.lost_packets, " lost in seq ",
+                summary.begin_seq, "-", summary.end_seq);
+    }
+  }
+}
+
+void QosController::apply(const RateDecision& decision) {
+  if (decision.protection_changed && hooks_.set_rtx_enabled) {
+    hooks_.set_rtx_enabled(decision.protection != ProtectionMode::Fec);
+  }
+  if (decision.fec_changed && hooks_.set_fec_percentage) {
+    LOG_INFO("QoS: FEC -> ", decision.fec_percentage, "%");
+    hooks_.set_fec_percentage(decision.fec_percentage);
+  }
+  if (decision.fec_interleave_changed && hooks_.set_fec_interleave) {
+    if (const GilbertElliottEstimator* model = rates_->loss_patterns()->worst(0)) {
+      // Share of losses in runs of 1, 2, 3 and 4+ packets.
+      const auto& runs = model->loss_runs();
+      std::array<double, 4> share{};
+      double total = 0.0;
+      for (std::size_t i = 0; i < kLossRunBins; ++i) {
+        const double lost = runs[i] * static_cast<double>(i + 1);
+        share[std::min<std::size_t>(i, 3)] += lost;
+        total += lost;
       }
-      stable_count = 0;
-    } else if (fraction_lost < 0.01 && bitrate < max_bitrate_) {
-      unsigned int new_rate = std::min(max_bitrate_, static_cast<unsigned int>(bitrate * 105 / 100 + 1));
-      if (new_rate > bitrate) {
-        g_object_set(encoder_, "bitrate", new_rate, NULL);
-        LOG_INFO("QoS: network stable (", fraction_lost * 100.0, "%) -> bitrate ", bitrate, " -> ", new_rate, " kbps");
+      if (total > 0.0) {
+        LOG_DEBUG("QoS: loss runs 1/2/3/4+: ", share[0] / total, "/", share[1] / total, "/", share[2] / total,
+                  "/", share[3] / total);
       }
-      stable_count++;
-    } else {
-      stable_count++;
     }
+    hooks_.set_fec_interleave(decision.fec_interleave);
+  }
+  if (decision.profile_changed && hooks_.set_profile) {
+    const VideoProfile& p = rates_->policy()->ladder()[decision.profile];
+    LOG_INFO("QoS: profile -> ", p.width, "x", p.height, "@", p.fps, " (", decision.bitrate_kbps, " kbps)");
+    hooks_.set_profile(p);
+  }
+  if (decision.bitrate_changed) {
+    g_object_set(encoder_, "bitrate", decision.bitrate_kbps, NULL);
+    LOG_DEBUG("QoS: bitrate -> ", decision.bitrate_kbps, " kbps");
+  }
+  if (decision.probe_padding_kbps > 0 && hooks_.start_probe) {
+    hooks_.start_probe(decision.probe_padding_kbps, decision.probe_duration);
   }
+  stats_.store(rates_->stats());
 }
 
 }  // namespace ve
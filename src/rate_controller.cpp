@@ -0,0 +1,246 @@
+#include "rate_controller.h"
+#include "logger.h"
+#include "rtp_fec.h"
+
+#include <algorithm>
+
+namespace {
+
+// Without a fresh transport-wide report the delay estimate is ignored.
+constexpr auto kFeedbackTimeout = std::chrono::seconds(2);
+
+// Payloader MTU; converts the media rate into packets for the repair span.
+constexpr double kMediaPacketBytes = 1200.0;
+
+}  // namespace
+
+namespace ve {
+
+RateController::RateController(unsigned int base_kbps)
+    : base_kbps_(base_kbps > 0 ? base_kbps : 4000),
+      min_kbps_(std::max(500u, base_kbps_ * 6 / 10)),
+      max_kbps_(std::max(base_kbps_, base_kbps_ * 15 / 10)),
+      loss_kbps_(base_kbps_),
+      applied_kbps_(base_kbps_) {
+  reset_bwe();
+}
+
+void RateController::reset_bwe() {
+  GccConfig gcc;
+  gcc.start_kbps = static_cast<int>(base_kbps_);
+  gcc.min_kbps = static_cast<int>(min_kbps_);
+  gcc.max_kbps = static_cast<int>(max_kbps_);
+  bwe_ = DelayBasedBwe(gcc);
+}
+
+void RateController::enable_joint_adaptation(std::vector<VideoProfile> ladder, int fec_percentage) {
+  if (ladder.empty()) return;
+  AdaptationConfig acfg;
+  acfg.fec_start = fec_percentage;
+  acfg.max_kbps = static_cast<int>(max_kbps_);
+  policy_ = std::make_unique<AdaptationPolicy>(std::move(ladder), acfg);
+
+  // Lower rungs take over below the old 60% floor.
+  min_kbps_ = std::max(100u, static_cast<unsigned int>(policy_->min_kbps()));
+  reset_bwe();
+  if (protection_) policy_->suspend_fec(protection_->mode() == ProtectionMode::Rtx);
+}
+
+void RateController::set_fec_percentage(int fec_percentage) {
+  static_fec_ = applied_fec_ = std::max(fec_percentage, 0);
+}
+
+void RateController::enable_protection_selection(ProtectionConfig cfg) {
+  protection_ = std::make_unique<ProtectionSelector>(cfg);
+  if (policy_) policy_->suspend_fec(protection_->mode() == ProtectionMode::Rtx);
+}
+
+void RateController::enable_probing(ProbeConfig cfg) {
+  prober_ = std::make_unique<BandwidthProber>(cfg);
+}
+
+void RateController::enable_loss_patterns(FecLayoutConfig cfg) {
+  layout_cfg_ = cfg;
+  patterns_ = std::make_unique<LossPatternTracker>(cfg.model);
+}
+
+void RateController::on_loss_rle(std::uint32_t receiver, const XrLossRle& block) {
+  if (patterns_) patterns_->add(receiver, block);
+}
+
+RateDecision RateController::on_receiver_report(double fraction_lost, double rtt_ms,
+                                                Clock::time_point now) {
+  if (!have_report_) {
+    last_change_ = now;
+    have_report_ = true;
+  }
+  if (rtt_ms > 0.0) {
+    srtt_ms_ = srtt_ms_ > 0.0 ? (7.0 * srtt_ms_ + rtt_ms) / 8.0 : rtt_ms;
+    bwe_.set_rtt(srtt_ms_);
+  }
+  fraction_lost = std::clamp(fraction_lost, 0.0, 1.0);
+  last_loss_ = fraction_lost;
+  if (policy_) policy_->report_loss(fraction_lost);
+  if (protection_ && protection_->update(srtt_ms_, fraction_lost, now)) {
+    const ProtectionMode mode = protection_->mode();
+    LOG_INFO("QoS: loss repair -> ", protection_mode_name(mode), " (srtt ", srtt_ms_, " ms)");
+    if (policy_) policy_->suspend_fec(mode == ProtectionMode::Rtx);
+    protection_changed_ = true;
+  }
+
+  // Loss-based ceiling. Cut once per round trip: reports inside one RTT
+  // describe the same congestion episode, before the previous cut can have
+  // taken effect.
+  const auto rtt_gap = std::chrono::milliseconds(static_cast<int>(std::max(srtt_ms_, 50.0)));
+  const unsigned int rate = loss_kbps_;
+  if (fraction_lost > 0.08 && rate > min_kbps_ && now - last_decrease_ >= rtt_gap) {
+    loss_kbps_ = std::max(min_kbps_, rate * 85 / 100);
+    LOG_WARN("QoS: high loss (", fraction_lost * 100.0, "%, rtt ", srtt_ms_, " ms) -> ceiling ",
+             rate, " -> ", loss_kbps_, " kbps");
+    last_decrease_ = last_change_ = now;
+  } else if (fraction_lost < 0.01 && rate < max_kbps_ && now - last_change_ >= increase_interval_) {
+    loss_kbps_ = std::min(max_kbps_, rate * 105 / 100 + 1);
+    LOG_DEBUG("QoS: network stable (", fraction_lost * 100.0, "%) -> ceiling ", rate, " -> ",
+              loss_kbps_, " kbps");
+    last_change_ = now;
+  }
+  return decide(now);
+}
+
+RateDecision RateController::on_transport_feedback(std::span<const PacketResult> packets,
+                                                   Clock::time_point now) {
+  last_feedback_ = now;
+  have_feedback_ = true;
+  bwe_.on_feedback(packets, now);
+  if (patterns_) {
+    received_.clear();
+    for (const PacketResult& p : packets) received_.push_back(p.received);
+    patterns_->add(LossPatternTracker::kTransportWideReceiver, received_);
+  }
+  if (prober_) {
+    if (const auto capacity = prober_->on_feedback(packets, now)) {
+      // The probe measured transport-wide traffic (media plus padding); FEC
+      // on its own stream shares the same bottleneck.
+      const int fec = policy_ ? policy_->fec_percentage() : applied_fec_;
+      const int media = std::min(static_cast<int>(max_kbps_), *capacity * 100 / (100 + fec));
+      LOG_INFO("QoS: probe delivered ", *capacity, " kbps -> media ", media, " kbps (estimate ",
+               bwe_.target_kbps(), " kbps)");
+      if (media > bwe_.target_kbps()) bwe_.set_target_kbps(media);
+      if (media > static_cast<int>(loss_kbps_)) loss_kbps_ = static_cast<unsigned int>(media);
+    }
+  }
+  if (bwe_.state() != last_usage_) {
+    LOG_INFO("QoS: delay gradient ", bandwidth_usage_name(bwe_.state()), " -> estimate ",
+             bwe_.target_kbps(), " kbps (delivered ", static_cast<int>(bwe_.acked_kbps()), " kbps)");
+    last_usage_ = bwe_.state();
+  }
+  return decide(now);
+}
+
+RateDecision RateController::decide(Clock::time_point now) {
+  RateDecision d;
+  ++decisions_;
+  last_decision_ = now;
+  unsigned int target = loss_kbps_;
+  if (have_feedback_ && now - last_feedback_ < kFeedbackTimeout) {
+    target = std::min(target, static_cast<unsigned int>(bwe_.target_kbps()));
+  }
+
+  if (policy_) {
+    // Both estimates see media packets only; the budget adds the FEC share
+    // currently on the wire, which the policy may then split differently.
+    const double budget = target * (100.0 + policy_->fec_percentage()) / 100.0;
+    const AdaptationDecision a = policy_->update(budget, now);
+    d.fec_percentage = a.fec_percentage;
+    d.fec_changed = a.fec_changed;
+    d.profile = a.profile;
+    d.profile_changed = a.profile_changed;
+    target = static_cast<unsigned int>(a.video_kbps);
+  } else if (protection_) {
+    d.fec_percentage = protection_->mode() == ProtectionMode::Rtx ? 0 : static_fec_;
+    d.fec_changed = d.fec_percentage != applied_fec_;
+    applied_fec_ = d.fec_percentage;
+  }
+  if (patterns_) update_fec_layout(d, now);
+  d.fec_interleave = fec_interleave_;
+  if (protection_) {
+    d.protection = protection_->mode();
+    d.protection_changed = protection_changed_;
+    protection_changed_ = false;
+  }
+  target = std::clamp(target, min_kbps_, max_kbps_);
+
+  // Delay feedback arrives many times a second; skip sub-2% increases so the
+  // encoder is not reconfigured on every report. Cuts always go through.
+  const bool small_increase = target > applied_kbps_ && (target - applied_kbps_) * 50 < applied_kbps_;
+  if (target != applied_kbps_ && !small_increase) {
+    applied_kbps_ = target;
+    d.bitrate_changed = true;
+  }
+  d.bitrate_kbps = applied_kbps_;
+
+  if (prober_ && have_feedback_) {
+    const auto cluster = prober_->update(static_cast<int>(applied_kbps_), static_cast<int>(max_kbps_),
+                                         bwe_.state(), last_loss_, now);
+    if (cluster && cluster->target_kbps > static_cast<int>(applied_kbps_)) {
+      d.probe_padding_kbps = cluster->target_kbps - static_cast<int>(applied_kbps_);
+      d.probe_duration = std::chrono::duration_cast<std::chrono::milliseconds>(cluster->end - cluster->start);
+      LOG_DEBUG("QoS: probing at ", cluster->target_kbps, " kbps");
+    }
+  }
+  return d;
+}
+
+QosStats RateController::stats() const {
+  QosStats s;
+  s.updated = last_decision_;
+  s.decisions = decisions_;
+  s.bitrate_kbps = applied_kbps_;
+  s.loss_kbps = loss_kbps_;
+  if (have_feedback_ && last_decision_ - last_feedback_ < kFeedbackTimeout) {
+    s.delay_kbps = bwe_.target_kbps();
+    s.acked_kbps = bwe_.acked_kbps();
+    s.usage = bwe_.state();
+  }
+  s.fraction_lost = last_loss_;
+  s.rtt_ms = srtt_ms_;
+  s.fec_percentage = policy_ ? policy_->fec_percentage() : applied_fec_;
+  s.fec_interleave = fec_interleave_;
+  if (protection_) s.protection = protection_->mode();
+  if (policy_) s.profile = policy_->profile_index();
+  return s;
+}
+
+void RateController::update_fec_layout(RateDecision& d, Clock::time_point now) {
+  const int fec = policy_ ? policy_->fec_percentage() : applied_fec_;
+  const GilbertElliottEstimator* model = patterns_->worst(layout_cfg_.min_packets);
+  if (!model || fec <= 0) return;
+
+  // Media packets sent within the repair delay budget.
+  const double pps = applied_kbps_ * 1000.0 / 8.0 / kMediaPacketBytes;
+  const int span = std::max(1, static_cast<int>(pps * layout_cfg_.max_delay.count() / 1000.0));
+  const GilbertElliottParams params = model->params();
+  // Without significant bursts, a span of 0 leaves only interleave 1.
+  const FecLayout best = choose_fec_layout(params, fec, model->bursty() ? span : 0);
+  if (best.interleave == fec_interleave_) return;
+
+  const int group = best.group_size;
+  const bool fits = fec_interleave_ == 1 || (group * fec_interleave_ <= span &&
+                                             (group - 1) * fec_interleave_ < static_cast<int>(kRtpFecMaxMask));
+  const double current = xor_fec_residual(params, group, fec_interleave_);
+  const bool gain = best.residual_loss < current * (1.0 - layout_cfg_.min_gain);
+  // Shallower is never meaningfully worse (near-ties go that way) and
+  // shortens the repair delay.
+  const bool shallower = best.interleave < fec_interleave_;
+  const bool held = last_layout_change_ != Clock::time_point{} && now - last_layout_change_ < layout_cfg_.hold;
+  if (fits && (held || !(gain || shallower))) return;
+
+  LOG_INFO("QoS: FEC interleave ", fec_interleave_, " -> ", best.interleave, " (group ", group, ", loss ",
+           params.loss_rate() * 100.0, "%, mean burst ", params.mean_burst(), " packets, repairs ",
+           best.recovered * 100.0, "% of losses, residual ", best.residual_loss * 100.0, "%)");
+  fec_interleave_ = best.interleave;
+  last_layout_change_ = now;
+  d.fec_interleave_changed = true;
+}
+
+}  // namespace ve
@@ -0,0 +1,127 @@
+#include "rs_fec.h"
+#include "gf256.h"
+#include "logger.h"
+
+#include <algorithm>
+
+namespace {
+
+using namespace ve;
+
+// Gauss-Jordan inversion of an n x n matrix in place. Cauchy sub-matrices are
+// always invertible, so a zero pivot means corrupted input.
+bool invert_matrix(std::vector<std::uint8_t>& a, int n) {
+  std::vector<std::uint8_t> inv(static_cast<std::size_t>(n) * n, 0);
+  for (int i = 0; i < n; ++i) inv[i * n + i] = 1;
+  for (int col = 0; col < n; ++col) {
+    int pivot = col;
+    while (pivot < n && a[pivot * n + col] == 0) ++pivot;
+    if (pivot == n) return false;
+    if (pivot != col) {
+      std::swap_ranges(a.begin() + pivot * n, a.begin() + pivot * n + n, a.begin() + col * n);
+      std::swap_ranges(inv.begin() + pivot * n, inv.begin() + pivot * n + n,
+                       inv.begin() + col * n);
+    }
+    const std::uint8_t scale = gf_inv(a[col * n + col]);
+    for (int j = 0; j < n; ++j) {
+      a[col * n + j] = gf_mul(a[col * n + j], scale);
+      inv[col * n + j] = gf_mul(inv[col * n + j], scale);
+    }
+    for (int row = 0; row < n; ++row) {
+      const std::uint8_t f = a[row * n + col];
+      if (row == col || f == 0) continue;
+      for (int j = 0; j < n; ++j) {
+        a[row * n + j] ^= gf_mul(f, a[col * n + j]);
+        inv[row * n + j] ^= gf_mul(f, inv[col * n + j]);
+      }
+    }
+  }
+  a.swap(inv);
+  return true;
+}
+
+}  // namespace
+
+namespace ve {
+
+RsCodec::RsCodec(int data_shards, int parity_shards) {
+  if (data_shards <= 0 || parity_shards <= 0 || data_shards + parity_shards > 256) {
+    LOG_ERROR("RS codec: invalid shape k=", data_shards, " m=", parity_shards);
+    return;
+  }
+  k_ = data_shards;
+  m_ = parity_shards;
+  // C[i][j] = 1 / (x_i + y_j) with x_i = k + i, y_j = j; all x/y distinct.
+  cauchy_.resize(static_cast<std::size_t>(m_) * k_);
+  for (int i = 0; i < m_; ++i) {
+    for (int j = 0; j < k_; ++j) {
+      cauchy_[i * k_ + j] = gf_inv(static_cast<std::uint8_t>((k_ + i) ^ j));
+    }
+  }
+}
+
+bool RsCodec::encode(std::span<const std::span<const std::uint8_t>> data,
+                     std::span<const std::span<std::uint8_t>> parity) const {
+  if (!valid() || data.size() != static_cast<std::size_t>(k_) ||
+      parity.size() != static_cast<std::size_t>(m_)) {
+    return false;
+  }
+  const std::size_t len = data[0].size();
+  for (const auto& d : data) if (d.size() != len) return false;
+  for (const auto& p : parity) if (p.size() != len) return false;
+
+  for (int i = 0; i < m_; ++i) {
+    std::uint8_t* out = parity[i].data();
+    gf_mul_region(out, data[0].data(), coefficient(i, 0), len);
+    for (int j = 1; j < k_; ++j) gf_mul_add_region(out, data[j].data(), coefficient(i, j), len);
+  }
+  return true;
+}
+
+bool RsCodec::decode(std::span<const std::span<std::uint8_t>> shards,
+                     const std::vector<bool>& present) const {
+  const std::size_t total = static_cast<std::size_t>(k_ + m_);
+  if (!valid() || shards.size() != total || present.size() != total) return false;
+  const std::size_t len = shards[0].size();
+  for (const auto& s : shards) if (s.size() != len) return false;
+
+  std::vector<int> lost;
+  for (int j = 0; j < k_; ++j) if (!present[j]) lost.push_back(j);
+  if (lost.empty()) return true;
+
+  std::vector<int> rows;
+  for (int i = 0; i < m_ && rows.size() < lost.size(); ++i) {
+    if (present[k_ + i]) rows.push_back(i);
+  }
+  if (rows.size() < lost.size()) return false;
+  const int e = static_cast<int>(lost.size());
+
+  // Syndromes: s_r = p_r - sum over received data of C[r][j] * d_j, which
+  // leaves only the lost columns of C on the left-hand side.
+  std::vector<std::uint8_t> syndromes(static_cast<std::size_t>(e) * len);
+  for (int r = 0; r < e; ++r) {
+    std::uint8_t* s = syndromes.data() + static_cast<std::size_t>(r) * len;
+    std::copy(shards[k_ + rows[r]].begin(), shards[k_ + rows[r]].end(), s);
+    for (int j = 0; j < k_; ++j) {
+      if (present[j]) gf_mul_add_region(s, shards[j].data(), coefficient(rows[r], j), len);
+    }
+  }
+
+  std::vector<std::uint8_t> sub(static_cast<std::size_t>(e) * e);
+  for (int r = 0; r < e; ++r) {
+    for (int c = 0; c < e; ++c) sub[r * e + c] = coefficient(rows[r], lost[c]);
+  }
+  if (!invert_matrix(sub, e)) return false;
+
+  for (int c = 0; c < e; ++c) {
+    std::uint8_t* out = shards[lost[c]].data();
+    gf_mul_region(out, syndromes.data(), sub[c * e], len);
+    for (int r = 1; r < e; ++r) {
+      gf_mul_add_region(out, syndromes.data() + static_cast<std::size_t>(r) * len,
+                        sub[c * e + r], len);
+    }
+  }
+  return true;
+}
+
+}  // namespace ve
@@ -0,0 +1,110 @@
+#include "rtcp_xr.h"
+
+namespace {
+
+using namespace ve;
+
+std::uint16_t read16(const std::uint8_t* p) {
+  return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+}
+
+std::uint32_t read32(const std::uint8_t* p) {
+  return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+         (static_cast<std::uint32_t>(p[2]) << 8) | p[3];
+}
+
+constexpr std::size_t kRtcpHeaderSize = 4;
+constexpr std::size_t kBlockHeaderSize = 4;
+
+// Block body after the common block header: SSRC, begin_seq, end_seq, chunks.
+bool parse_loss_rle(std::uint8_t type_specific, std::span<const std::uint8_t> body, XrLossRle& out) {
+  if (body.size() < 8) return false;
+  out.thinning = type_specific & 0x0f;
+  out.ssrc = read32(body.data());
+  out.begin_seq = read16(body.data() + 4);
+  out.end_seq = read16(body.data() + 6);
+  const std::size_t count = static_cast<std::uint16_t>(out.end_seq - out.begin_seq) >> out.thinning;
+
+  out.received.clear();
+  out.received.reserve(count);
+  for (std::size_t pos = 8; pos + 2 <= body.size() && out.received.size() < count; pos += 2) {
+    const std::uint16_t chunk = read16(body.data() + pos);
+    if (chunk == 0) break;  // terminating null chunk
+    if ((chunk & 0x8000) == 0) {
+      // Run length chunk: run type (1 = received) and 14-bit length.
+      const bool received = (chunk & 0x4000) != 0;
+      const std::size_t run = chunk & 0x3fff;
+      for (std::size_t i = 0; i < run && out.received.size() < count; ++i) out.received.push_back(received);
+    } else {
+      // Bit vector chunk: 15 packets, most significant bit first.
+      for (int i = 14; i >= 0 && out.received.size() < count; --i) {
+        out.received.push_back(((chunk >> i) & 0x1) != 0);
+      }
+    }
+  }
+  return out.received.size() == count;
+}
+
+bool parse_stats_summary(std::uint8_t type_specific, std::span<const std::uint8_t> body, XrStatsSummary& out) {
+  if (body.size() < 16) return false;
+  out.has_loss = (type_specific & 0x80) != 0;
+  out.has_dup = (type_specific & 0x40) != 0;
+  out.ssrc = read32(body.data());
+  out.begin_seq = read16(body.data() + 4);
+  out.end_seq = read16(body.data() + 6);
+  out.lost_packets = read32(body.data() + 8);
+  out.dup_packets = read32(body.data() + 12);
+  return true;
+}
+
+bool parse_xr_packet(std::span<const std::uint8_t> packet, XrReport& out) {
+  if (packet.size() < kRtcpHeaderSize + 4) return false;
+  out.sender_ssrc = read32(packet.data() + kRtcpHeaderSize);
+  std::size_t pos = kRtcpHeaderSize + 4;
+  while (pos + kBlockHeaderSize <= packet.size()) {
+    const std::uint8_t type = packet[pos];
+    const std::uint8_t type_specific = packet[pos + 1];
+    const std::size_t length = (static_cast<std::size_t>(read16(packet.data() + pos + 2))) * 4;
+    if (pos + kBlockHeaderSize + length > packet.size()) return false;
+    const auto body = packet.subspan(pos + kBlockHeaderSize, length);
+    if (type == kXrLossRle) {
+      XrLossRle block;
+      if (!parse_loss_rle(type_specific, body, block)) return false;
+      out.loss_rle.push_back(std::move(block));
+    } else if (type == kXrStatsSummary) {
+      XrStatsSummary block;
+      if (!parse_stats_summary(type_specific, body, block)) return false;
+      out.summaries.push_back(block);
+    }
+    pos += kBlockHeaderSize + length;
+  }
+  return true;
+}
+
+}  // namespace
+
+namespace ve {
+
+bool parse_rtcp_xr(std::span<const std::uint8_t> compound, std::vector<XrReport>& out) {
+  std::size_t pos = 0;
+  while (pos + kRtcpHeaderSize <= compound.size()) {
+    if ((compound[pos] >> 6) != 2) return false;
+    const std::size_t size = (static_cast<std::size_t>(read16(compound.data() + pos + 2)) + 1) * 4;
+    if (pos + size > compound.size()) return false;
+    if (compound[pos + 1] == kRtcpXr) {
+      auto packet = compound.subspan(pos, size);
+      if (compound[pos] & 0x20) {
+        const std::size_t padding = packet.back();
+        if (padding == 0 || padding > size - kRtcpHeaderSize) return false;
+        packet = packet.first(size - padding);
+      }
+      XrReport report;
+      if (!parse_xr_packet(packet, report)) return false;
+      out.push_back(std::move(report));
+    }
+    pos += size;
+  }
+  return pos == compound.size();
+}
+
+}  // namespace ve
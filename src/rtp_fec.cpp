@@ -0,0 +1,339 @@
+#include "rtp_fec.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+
+using namespace ve;
+
+std::uint16_t read16(const std::uint8_t* p) {
+  return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+}
+
+std::uint32_t read32(const std::uint8_t* p) {
+  return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+         (static_cast<std::uint32_t>(p[2]) << 8) | p[3];
+}
+
+void write16(std::uint8_t* p, std::uint16_t v) {
+  p[0] = static_cast<std::uint8_t>(v >> 8);
+  p[1] = static_cast<std::uint8_t>(v);
+}
+
+void write32(std::uint8_t* p, std::uint32_t v) {
+  p[0] = static_cast<std::uint8_t>(v >> 24);
+  p[1] = static_cast<std::uint8_t>(v >> 16);
+  p[2] = static_cast<std::uint8_t>(v >> 8);
+  p[3] = static_cast<std::uint8_t>(v);
+}
+
+// Offset of the payload: fixed header + CSRCs + header extension.
+std::size_t rtp_header_length(std::span<const std::uint8_t> packet) {
+  if (packet.size() < kRtpHeaderSize) return 0;
+  std::size_t len = kRtpHeaderSize + 4u * (packet[0] & 0x0f);
+  if (packet[0] & 0x10) {
+    if (packet.size() < len + 4) return 0;
+    len += 4 + 4u * read16(packet.data() + len + 2);
+  }
+  return len <= packet.size() ? len : 0;
+}
+
+std::uint16_t protected_length(std::span<const std::uint8_t> rtp) {
+  return static_cast<std::uint16_t>(rtp.size() - kRtpHeaderSize);
+}
+
+}  // namespace
+
+namespace ve {
+
+bool parse_rtp_header(std::span<const std::uint8_t> packet, RtpHeader& out) {
+  if (packet.size() < kRtpHeaderSize || (packet[0] >> 6) != 2) return false;
+  out.marker = (packet[1] & 0x80) != 0;
+  out.payload_type = packet[1] & 0x7f;
+  out.seq = read16(packet.data() + 2);
+  out.timestamp = read32(packet.data() + 4);
+  out.ssrc = read32(packet.data() + 8);
+  return true;
+}
+
+std::span<const std::uint8_t> rtp_payload(std::span<const std::uint8_t> packet) {
+  const std::size_t hdr = rtp_header_length(packet);
+  if (hdr == 0) return {};
+  std::size_t end = packet.size();
+  if (packet[0] & 0x20) {
+    const std::size_t pad = packet.back();
+    if (pad == 0 || pad > end - hdr) return {};
+    end -= pad;
+  }
+  return packet.subspan(hdr, end - hdr);
+}
+
+bool RtpFecHeader::covers(std::uint16_t seq) const {
+  const std::uint16_t offset = static_cast<std::uint16_t>(seq - sn_base);
+  return offset < kRtpFecMaxMask && ((mask >> (kRtpFecMaxMask - 1 - offset)) & 1u);
+}
+
+bool parse_rtp_fec(std::span<const std::uint8_t> packet, RtpFecHeader& out) {
+  if (!parse_rtp_header(packet, out.rtp)) return false;
+  const std::size_t hdr = rtp_header_length(packet);
+  if (hdr == 0 || packet.size() < hdr + kRtpFecHeaderSize + 4) return false;
+
+  const std::uint8_t* f = packet.data() + hdr;
+  const bool long_mask = (f[0] & 0x40) != 0;
+  out.recovery_byte0 = f[0] & 0x3f;
+  out.recovery_byte1 = f[1];
+  out.sn_base = read16(f + 2);
+  out.ts_recovery = read32(f + 4);
+  out.length_recovery = read16(f + 8);
+
+  const std::uint8_t* ulp = f + kRtpFecHeaderSize;
+  const std::size_t ulp_len = long_mask ? 8 : 4;
+  if (packet.size() < hdr + kRtpFecHeaderSize + ulp_len) return false;
+  out.protection_length = read16(ulp);
+  out.mask = static_cast<std::uint64_t>(read16(ulp + 2)) << 32;
+  if (long_mask) out.mask |= read32(ulp + 4);
+
+  const std::size_t payload_off = hdr + kRtpFecHeaderSize + ulp_len;
+  if (packet.size() < payload_off + out.protection_length) return false;
+  out.payload = packet.subspan(payload_off, out.protection_length);
+  return true;
+}
+
+RtpFecEncoder::RtpFecEncoder(RtpFecConfig cfg)
+    : cfg_(cfg), pool_(1, cfg.max_packet), parity_(pool_) {
+  set_group_size(cfg_.group_size);
+}
+
+void RtpFecEncoder::set_group_size(std::uint16_t group_size) {
+  cfg_.group_size = std::clamp<std::uint16_t>(group_size, 1, kRtpFecMaxMask);
+}
+
+void RtpFecEncoder::reset_group() {
+  parity_.abort();
+  byte0_ = byte1_ = 0;
+  ts_ = 0;
+  length_ = 0;
+  mask_ = 0;
+  count_ = 0;
+}
+
+bool RtpFecEncoder::add(std::span<const std::uint8_t> rtp, std::vector<std::uint8_t>& out) {
+  RtpHeader h;
+  if (!parse_rtp_header(rtp, h) || rtp.size() - kRtpHeaderSize > cfg_.max_packet) return false;
+
+  bool emitted = false;
+  if (count_ > 0) {
+    const std::uint16_t offset = static_cast<std::uint16_t>(h.seq - sn_base_);
+    if (offset >= kRtpFecMaxMask || h.ssrc != ssrc_) {
+      // Sequence gap or SSRC change: close the group instead of widening it.
+      build(out);
+      reset_group();
+      emitted = true;
+    }
+  }
+  if (count_ == 0) {
+    sn_base_ = h.seq;
+    ssrc_ = h.ssrc;
+    parity_.begin(h.seq);
+  }
+
+  byte0_ ^= rtp[0];
+  byte1_ ^= rtp[1];
+  ts_ ^= h.timestamp;
+  length_ ^= protected_length(rtp);
+  parity_.add(rtp.subspan(kRtpHeaderSize));
+
+  const std::uint16_t offset = static_cast<std::uint16_t>(h.seq - sn_base_);
+  mask_ |= std::uint64_t{1} << (kRtpFecMaxMask - 1 - offset);
+  last_ts_ = h.timestamp;
+  ++count_;
+
+  // With `out` taken by the closed group, a full new one waits for poll().
+  if (!emitted && count_ >= cfg_.group_size) {
+    build(out);
+    reset_group();
+    return true;
+  }
+  return emitted;
+}
+
+bool RtpFecEncoder::poll(std::vector<std::uint8_t>& out) {
+  if (count_ == 0 || count_ < cfg_.group_size) return false;
+  build(out);
+  reset_group();
+  return true;
+}
+
+bool RtpFecEncoder::flush(std::vector<std::uint8_t>& out) {
+  if (count_ == 0) return false;
+  build(out);
+  reset_group();
+  return true;
+}
+
+void RtpFecEncoder::build(std::vector<std::uint8_t>& out) {
+  const PooledParity parity = parity_.finish();
+  const auto payload = parity.data();
+  const bool long_mask = (mask_ & 0xffffffffull) != 0;
+  const std::size_t ulp_len = long_mask ? 8 : 4;
+  out.resize(kRtpHeaderSize + kRtpFecHeaderSize + ulp_len + payload.size());
+  std::uint8_t* p = out.data();
+
+  p[0] = 0x80;
+  p[1] = cfg_.payload_type & 0x7f;
+  write16(p + 2, fec_seq_++);
+  write32(p + 4, last_ts_);
+  write32(p + 8, ssrc_);
+
+  std::uint8_t* f = p + kRtpHeaderSize;
+  f[0] = static_cast<std::uint8_t>((long_mask ? 0x40 : 0x00) | (byte0_ & 0x3f));
+  f[1] = byte1_;
+  write16(f + 2, sn_base_);
+  write32(f + 4, ts_);
+  write16(f + 8, length_);
+
+  std::uint8_t* ulp = f + kRtpFecHeaderSize;
+  write16(ulp, static_cast<std::uint16_t>(payload.size()));
+  write16(ulp + 2, static_cast<std::uint16_t>(mask_ >> 32));
+  if (long_mask) write32(ulp + 4, static_cast<std::uint32_t>(mask_));
+
+  std::copy(payload.begin(), payload.end(), ulp + ulp_len);
+}
+
+InterleavedFecEncoder::InterleavedFecEncoder(RtpFecConfig cfg) : cfg_(cfg) {
+  columns_.push_back(std::make_unique<RtpFecEncoder>(cfg_));
+  set_group_size(cfg_.group_size);
+}
+
+bool InterleavedFecEncoder::add(std::span<const std::uint8_t> rtp, std::vector<std::uint8_t>& out) {
+  RtpFecEncoder& column = *columns_[next_];
+  last_ = next_;
+  next_ = static_cast<std::uint16_t>((next_ + 1) % depth_);
+  return column.add(rtp, out);
+}
+
+bool InterleavedFecEncoder::poll(std::vector<std::uint8_t>& out) { return columns_[last_]->poll(out); }
+
+bool InterleavedFecEncoder::flush(std::vector<std::uint8_t>& out) {
+  for (std::uint16_t i = 0; i < depth_; ++i) {
+    if (columns_[i]->flush(out)) return true;
+  }
+  return false;
+}
+
+void InterleavedFecEncoder::set_group_size(std::uint16_t group_size) {
+  cfg_.group_size = group_size;
+  // Column packets are depth apart; the last must stay inside the mask.
+  const auto fit = static_cast<std::uint16_t>((kRtpFecMaxMask - 1) / depth_ + 1);
+  for (auto& column : columns_) column->set_group_size(std::min(group_size, fit));
+}
+
+void InterleavedFecEncoder::set_depth(std::uint16_t depth) {
+  depth_ = std::clamp<std::uint16_t>(depth, 1, kRtpFecMaxMask);
+  while (columns_.size() < depth_) columns_.push_back(std::make_unique<RtpFecEncoder>(cfg_));
+  next_ = last_ = 0;
+  set_group_size(cfg_.group_size);
+}
+
+UepFecEncoder::UepFecEncoder(UepFecConfig cfg)
+    : cfg_(cfg),
+      encoders_{InterleavedFecEncoder({cfg.payload_type}), InterleavedFecEncoder({cfg.payload_type}),
+                InterleavedFecEncoder({cfg.payload_type})} {
+  for (int i = 0; i < kH264PriorityCount; ++i) {
+    set_percentage(static_cast<H264Priority>(i), cfg_.percentage[i]);
+  }
+  out_.reserve(1500);
+}
+
+void UepFecEncoder::set_percentage(H264Priority priority, int percentage) {
+  const int i = static_cast<int>(priority);
+  cfg_.percentage[i] = std::clamp(percentage, 0, 100);
+  const std::uint16_t group = rtp_fec_group_size(cfg_.percentage[i]);
+  if (group > 0) encoders_[i].set_group_size(group);
+}
+
+void UepFecEncoder::set_interleave(std::uint16_t depth) {
+  InterleavedFecEncoder& encoder = encoders_[static_cast<int>(H264Priority::NonIdr)];
+  if (depth == encoder.depth()) return;
+  while (encoder.flush(out_)) emit(H264Priority::NonIdr);
+  encoder.set_depth(depth);
+}
+
+bool UepFecEncoder::uniform() const {
+  return cfg_.percentage[0] == cfg_.percentage[1] && cfg_.percentage[0] == cfg_.percentage[2];
+}
+
+void UepFecEncoder::emit(H264Priority priority) {
+  const int i = static_cast<int>(priority);
+  write16(out_.data() + 2, fec_seq_++);
+  stats_.parity_bytes[i] += out_.size();
+  if (sink_) sink_(out_);
+}
+
+void UepFecEncoder::add(std::span<const std::uint8_t> rtp) {
+  RtpHeader h;
+  if (!parse_rtp_header(rtp, h)) return;
+  const H264Priority priority = h264_payload_priority(rtp_payload(rtp));
+  stats_.media_bytes[static_cast<int>(priority)] += rtp.size();
+
+  const bool shared = uniform();
+  const H264Priority group = shared ? H264Priority::NonIdr : priority;
+  const int gi = static_cast<int>(group);
+  if (cfg_.percentage[gi] > 0) {
+    if (encoders_[gi].add(rtp, out_)) emit(group);
+    if (encoders_[gi].poll(out_)) emit(group);
+  }
+
+  if (!shared && h.marker) {
+    for (H264Priority p : {H264Priority::Idr, H264Priority::ParameterSet}) {
+      if (encoders_[static_cast<int>(p)].flush(out_)) emit(p);
+    }
+  }
+}
+
+std::vector<std::uint8_t> rtp_fec_recover(std::span<const std::span<const std::uint8_t>> received,
+                                          const RtpFecHeader& fec) {
+  std::uint64_t pending = fec.mask;
+  std::uint8_t byte0 = fec.recovery_byte0;
+  std::uint8_t byte1 = fec.recovery_byte1;
+  std::uint32_t ts = fec.ts_recovery;
+  std::uint16_t length = fec.length_recovery;
+
+  for (const auto& p : received) {
+    RtpHeader h;
+    if (!parse_rtp_header(p, h) || !fec.covers(h.seq)) return {};
+    if (p.size() - kRtpHeaderSize > fec.protection_length) return {};
+    pending &= ~(std::uint64_t{1} << (kRtpFecMaxMask - 1 - static_cast<std::uint16_t>(h.seq - fec.sn_base)));
+    byte0 ^= p[0];
+    byte1 ^= p[1];
+    ts ^= h.timestamp;
+    length ^= protected_length(p);
+  }
+  if (std::popcount(pending) != 1) return {};
+  if (length > fec.protection_length) return {};
+
+  const int offset = static_cast<int>(kRtpFecMaxMask) - 1 - std::countr_zero(pending);
+  std::vector<std::uint8_t> out(kRtpHeaderSize + fec.protection_length);
+  out[0] = static_cast<std::uint8_t>(0x80 | (byte0 & 0x3f));
+  out[1] = byte1;
+  write16(out.data() + 2, static_cast<std::uint16_t>(fec.sn_base + offset));
+  write32(out.data() + 4, ts);
+  write32(out.data() + 8, fec.rtp.ssrc);
+
+  std::copy(fec.payload.begin(), fec.payload.end(), out.begin() + kRtpHeaderSize);
+  for (const auto& p : received) {
+    const std::span<const std::uint8_t> one[] = {p.subspan(kRtpHeaderSize)};
+    xor_accumulate(std::span<std::uint8_t>(out).subspan(kRtpHeaderSize), one);
+  }
+  out.resize(kRtpHeaderSize + length);
+  return out;
+}
+
+std::uint16_t rtp_fec_group_size(int percentage) {
+  if (percentage <= 0) return 0;
+  const int group = (100 + percentage / 2) / percentage;
+  return static_cast<std::uint16_t>(std::clamp(group, 1, static_cast<int>(kRtpFecMaxMask)));
+}
+
+}  // namespace ve
@@ -0,0 +1,118 @@
+#include "rtx_stage.h"
+#include "logger.h"
+
+#include <gst/gst.h>
+#include <gst/rtp/rtp.h>
+
+#include <string>
+
+namespace {
+
+using namespace ve;
+
+GstElement* on_request_aux_sender(GstElement*, guint session, gpointer user_data) {
+  return static_cast<RtxStage*>(user_data)->make_aux_sender(session);
+}
+
+bool keep_buffer(GstBuffer* buf, RtxStage* stage) {
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  if (!gst_rtp_buffer_map(buf, GST_MAP_READ, &rtp)) return true;
+  const std::uint8_t pt = gst_rtp_buffer_get_payload_type(&rtp);
+  gst_rtp_buffer_unmap(&rtp);
+  return stage->on_rtx_output(pt);
+}
+
+// rtprtxsend pushes retransmissions as single buffers, so buffer lists
+// (media only) are not probed.
+GstPadProbeReturn on_rtx_src(GstPad*, GstPadProbeInfo* info, gpointer user_data) {
+  auto* stage = static_cast<RtxStage*>(user_data);
+  return keep_buffer(GST_PAD_PROBE_INFO_BUFFER(info), stage) ? GST_PAD_PROBE_OK : GST_PAD_PROBE_DROP;
+}
+
+bool add_ghost_pad(GstElement* bin, GstElement* element, const char* pad_name,
+                   const std::string& ghost_name) {
+  GstPad* pad = gst_element_get_static_pad(element, pad_name);
+  if (!pad) return false;
+  const bool ok = gst_element_add_pad(bin, gst_ghost_pad_new(ghost_name.c_str(), pad));
+  gst_object_unref(pad);
+  return ok;
+}
+
+}  // namespace
+
+namespace ve {
+
+RtxStage::RtxStage() = default;
+RtxStage::~RtxStage() { detach(); }
+
+bool RtxStage::attach(GstElement* rtpbin, const RtxConfig& cfg) {
+  detach();
+  if (!rtpbin) return false;
+  cfg_ = cfg;
+  rtpbin_ = GST_ELEMENT(gst_object_ref(rtpbin));
+  handler_id_ = g_signal_connect(rtpbin_, "request-aux-sender", G_CALLBACK(on_request_aux_sender), this);
+  return handler_id_ != 0;
+}
+
+void RtxStage::detach() {
+  if (rtpbin_) {
+    if (handler_id_ != 0) g_signal_handler_disconnect(rtpbin_, handler_id_);
+    gst_object_unref(rtpbin_);
+    LOG_INFO("RTX: ", sent_.load(), " retransmissions sent, ", dropped_.load(), " suppressed");
+  }
+  rtpbin_ = nullptr;
+  handler_id_ = 0;
+}
+
+GstElement* RtxStage::make_aux_sender(unsigned int session) {
+  if (session != 0) return nullptr;
+  GstElement* rtx = gst_element_factory_make("rtprtxsend", nullptr);
+  if (!rtx) {
+    LOG_WARN("RTX: rtprtxsend unavailable, NACKs will not be served");
+    return nullptr;
+  }
+
+  GstStructure* pt_map = gst_structure_new_empty("application/x-rtp-pt-map");
+  gst_structure_set(pt_map, std::to_string(cfg_.media_pt).c_str(), G_TYPE_UINT, cfg_.rtx_pt, NULL);
+  g_object_set(rtx,
+               "payload-type-map", pt_map,
+               "max-size-time", cfg_.history_ms,
+               "max-size-packets", cfg_.history_packets,
+               NULL);
+  gst_structure_free(pt_map);
+  if (cfg_.media_ssrc != 0 && cfg_.rtx_ssrc != 0) {
+    GstStructure* ssrc_map = gst_structure_new_empty("application/x-rtp-ssrc-map");
+    gst_structure_set(ssrc_map, std::to_string(cfg_.media_ssrc).c_str(), G_TYPE_UINT, cfg_.rtx_ssrc, NULL);
+    g_object_set(rtx, "ssrc-map", ssrc_map, NULL);
+    gst_structure_free(ssrc_map);
+  }
+
+  GstElement* bin = gst_bin_new(nullptr);
+  gst_bin_add(GST_BIN(bin), rtx);
+  const std::string suffix = "_" + std::to_string(session);
+  if (!add_ghost_pad(bin, rtx, "src", "src" + suffix) || !add_ghost_pad(bin, rtx, "sink", "sink" + suffix)) {
+    LOG_ERROR("RTX: failed to expose rtprtxsend pads");
+    gst_object_unref(bin);
+    return nullptr;
+  }
+
+  GstPad* src = gst_element_get_static_pad(rtx, "src");
+  gst_pad_add_probe(src, GST_PAD_PROBE_TYPE_BUFFER, on_rtx_src, this, nullptr);
+  gst_object_unref(src);
+
+  LOG_INFO("RTX: session ", session, " pt ", cfg_.media_pt, " -> ", cfg_.rtx_pt, ", history ",
+           cfg_.history_ms, " ms / ", cfg_.history_packets, " packets");
+  return bin;
+}
+
+bool RtxStage::on_rtx_output(std::uint8_t payload_type) {
+  if (payload_type != cfg_.rtx_pt) return true;
+  if (!enabled()) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  sent_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+}  // namespace ve
@@ -0,0 +1,285 @@
+#include "sliding_fec.h"
+#include "gf256.h"
+
+#include <algorithm>
+
+namespace {
+
+using namespace ve;
+
+std::int16_t seq_diff(std::uint16_t a, std::uint16_t b) {
+  return static_cast<std::int16_t>(static_cast<std::uint16_t>(a - b));
+}
+
+std::uint16_t read16(const std::uint8_t* p) {
+  return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+}
+
+void write16(std::uint8_t* p, std::uint16_t v) {
+  p[0] = static_cast<std::uint8_t>(v >> 8);
+  p[1] = static_cast<std::uint8_t>(v);
+}
+
+// Source symbol: 16-bit packet length followed by the packet.
+void make_symbol(std::span<const std::uint8_t> packet, std::vector<std::uint8_t>& symbol) {
+  symbol.resize(2 + packet.size());
+  write16(symbol.data(), static_cast<std::uint16_t>(packet.size()));
+  std::copy(packet.begin(), packet.end(), symbol.begin() + 2);
+}
+
+// Length of the symbol encoded at the start of data, or 0 if inconsistent.
+std::size_t symbol_length(std::span<const std::uint8_t> data) {
+  if (data.size() < 2) return 0;
+  const std::size_t len = 2u + read16(data.data());
+  return len <= data.size() ? len : 0;
+}
+
+}  // namespace
+
+namespace ve {
+
+std::uint8_t sliding_fec_coefficient(std::uint16_t repair_key, std::uint16_t index) {
+  // splitmix64 finaliser over (key, index)
+  std::uint64_t z = (static_cast<std::uint64_t>(repair_key) << 16 | index) + 0x9e3779b97f4a7c15ull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  z ^= z >> 31;
+  const auto c = static_cast<std::uint8_t>(z);
+  return c != 0 ? c : 1;
+}
+
+SlidingWindowEncoder::SlidingWindowEncoder(SlidingFecConfig cfg) : cfg_(cfg) {
+  cfg_.window = std::clamp<std::uint16_t>(cfg_.window, 1, 255);
+  cfg_.repair_interval = std::max<std::uint16_t>(cfg_.repair_interval, 1);
+  ring_.resize(cfg_.window);
+  for (auto& s : ring_) s.symbol.reserve(2 + cfg_.max_packet);
+}
+
+bool SlidingWindowEncoder::add(std::uint16_t id, std::span<const std::uint8_t> packet,
+                               std::vector<std::uint8_t>& repair) {
+  if (packet.size() > cfg_.max_packet) return false;
+  if (filled_ > 0 && id != next_id_) filled_ = 0;
+
+  Source& src = ring_[pos_++ % cfg_.window];
+  make_symbol(packet, src.symbol);
+  src.id = id;
+  next_id_ = static_cast<std::uint16_t>(id + 1);
+  filled_ = std::min<std::uint16_t>(filled_ + 1, cfg_.window);
+
+  if (++since_repair_ < cfg_.repair_interval) return false;
+  since_repair_ = 0;
+  return make_repair(repair);
+}
+
+bool SlidingWindowEncoder::make_repair(std::vector<std::uint8_t>& repair) {
+  if (filled_ == 0) return false;
+  const std::uint16_t first = static_cast<std::uint16_t>(next_id_ - filled_);
+
+  std::size_t sym_len = 0;
+  const std::uint32_t oldest = pos_ - filled_;
+  for (std::uint16_t i = 0; i < filled_; ++i) {
+    sym_len = std::max(sym_len, ring_[(oldest + i) % cfg_.window].symbol.size());
+  }
+
+  repair.assign(kSlidingRepairHeaderSize + sym_len, 0);
+  write16(repair.data(), first);
+  repair[2] = static_cast<std::uint8_t>(filled_);
+  write16(repair.data() + 3, repair_key_);
+  write16(repair.data() + 5, static_cast<std::uint16_t>(sym_len));
+
+  std::uint8_t* out = repair.data() + kSlidingRepairHeaderSize;
+  for (std::uint16_t i = 0; i < filled_; ++i) {
+    const Source& src = ring_[(oldest + i) % cfg_.window];
+    gf_mul_add_region(out, src.symbol.data(), sliding_fec_coefficient(repair_key_, i),
+                      src.symbol.size());
+  }
+  ++repair_key_;
+  return true;
+}
+
+SlidingWindowDecoder::SlidingWindowDecoder(SlidingFecConfig cfg) : cfg_(cfg) {
+  cfg_.window = std::clamp<std::uint16_t>(cfg_.window, 1, 255);
+  std::uint16_t capacity = 64;
+  while (capacity < 4 * cfg_.window) capacity = static_cast<std::uint16_t>(capacity << 1);
+  slots_.resize(capacity);
+  mask_ = static_cast<std::uint16_t>(capacity - 1);
+}
+
+bool SlidingWindowDecoder::known(std::uint16_t id) const {
+  const Slot& s = slots_[id & mask_];
+  return s.present && s.id == id;
+}
+
+void SlidingWindowDecoder::learn(std::uint16_t id, std::span<const std::uint8_t> symbol,
+                                 bool recovered) {
+  if (known(id)) return;
+  if (!started_ || seq_diff(id, newest_) > 0) newest_ = id;
+  started_ = true;
+
+  Slot& s = slots_[id & mask_];
+  s.symbol.assign(symbol.begin(), symbol.end());
+  s.id = id;
+  s.present = true;
+
+  if (recovered) {
+    recovered_.emplace_back(id, std::vector<std::uint8_t>(symbol.begin() + 2, symbol.end()));
+    ++recovered_total_;
+  }
+}
+
+void SlidingWindowDecoder::add_source(std::uint16_t id, std::span<const std::uint8_t> packet) {
+  if (packet.size() > cfg_.max_packet || known(id)) return;
+  std::vector<std::uint8_t> symbol;
+  make_symbol(packet, symbol);
+  learn(id, symbol, false);
+  if (!equations_.empty()) solve();
+}
+
+void SlidingWindowDecoder::add_repair(std::span<const std::uint8_t> repair) {
+  if (repair.size() < kSlidingRepairHeaderSize) return;
+  const std::uint16_t first = read16(repair.data());
+  const std::uint16_t count = repair[2];
+  const std::uint16_t key = read16(repair.data() + 3);
+  const std::uint16_t sym_len = read16(repair.data() + 5);
+  if (count == 0 || repair.size() < kSlidingRepairHeaderSize + sym_len) return;
+
+  Equation eq;
+  eq.terms.reserve(count);
+  for (std::uint16_t i = 0; i < count; ++i) {
+    eq.terms.emplace_back(static_cast<std::uint16_t>(first + i), sliding_fec_coefficient(key, i));
+  }
+  const auto payload = repair.subspan(kSlidingRepairHeaderSize, sym_len);
+  eq.data.assign(payload.begin(), payload.end());
+  if (!started_) {
+    newest_ = static_cast<std::uint16_t>(first + count - 1);
+    started_ = true;
+  }
+  substitute(eq);
+  if (eq.terms.empty()) return;
+  equations_.push_back(std::move(eq));
+  prune();
+  solve();
+}
+
+void SlidingWindowDecoder::substitute(Equation& eq) const {
+  auto it = std::remove_if(eq.terms.begin(), eq.terms.end(), [&](const auto& term) {
+    if (!known(term.first)) return false;
+    const auto& sym = slots_[term.first & mask_].symbol;
+    if (sym.size() > eq.data.size()) eq.data.resize(sym.size(), 0);
+    gf_mul_add_region(eq.data.data(), sym.data(), term.second, sym.size());
+    return true;
+  });
+  eq.terms.erase(it, eq.terms.end());
+}
+
+void SlidingWindowDecoder::prune() {
+  // Unknowns older than the slot ring can never be released usefully.
+  const int horizon = static_cast<int>(slots_.size()) - cfg_.window;
+  equations_.erase(std::remove_if(equations_.begin(), equations_.end(),
+                                  [&](const Equation& eq) {
+                                    return std::any_of(eq.terms.begin(), eq.terms.end(),
+                                                       [&](const auto& t) {
+                                                         return seq_diff(newest_, t.first) >= horizon;
+                                                       });
+                                  }),
+                   equations_.end());
+  const std::size_t max_equations = 4u * cfg_.window;
+  if (equations_.size() > max_equations) {
+    equations_.erase(equations_.begin(),
+                     equations_.begin() + static_cast<std::ptrdiff_t>(equations_.size() - max_equations));
+  }
+}
+
+void SlidingWindowDecoder::solve() {
+  bool progress = true;
+  bool eliminated = false;
+  while (progress) {
+    progress = false;
+    for (auto& eq : equations_) substitute(eq);
+    equations_.erase(std::remove_if(equations_.begin(), equations_.end(),
+                                    [](const Equation& eq) { return eq.terms.empty(); }),
+                     equations_.end());
+
+    // Single-unknown equations are solved directly.
+    for (auto& eq : equations_) {
+      if (eq.terms.size() != 1) continue;
+      const auto [id, c] = eq.terms.front();
+      gf_mul_region(eq.data.data(), eq.data.data(), gf_inv(c), eq.data.size());
+      const std::size_t len = symbol_length(eq.data);
+      if (len > 0) learn(id, std::span<const std::uint8_t>(eq.data.data(), len), true);
+      eq.terms.clear();
+      progress = true;
+    }
+    if (progress) {
+      eliminated = false;
+      continue;
+    }
+    if (eliminated || equations_.size() < 2) break;
+
+    // Gauss-Jordan over the remaining unknowns; rows reduced to a single
+    // unknown are picked up by the next pass.
+    std::vector<std::uint16_t> unknowns;
+    std::size_t width = 0;
+    for (const auto& eq : equations_) {
+      width = std::max(width, eq.data.size());
+      for (const auto& t : eq.terms) {
+        if (std::find(unknowns.begin(), unknowns.end(), t.first) == unknowns.end()) {
+          unknowns.push_back(t.first);
+        }
+      }
+    }
+    const std::size_t rows = equations_.size();
+    const std::size_t cols = unknowns.size();
+    std::vector<std::uint8_t> m(rows * cols, 0);
+    for (std::size_t r = 0; r < rows; ++r) {
+      equations_[r].data.resize(width, 0);
+      for (const auto& t : equations_[r].terms) {
+        const auto col = std::find(unknowns.begin(), unknowns.end(), t.first) - unknowns.begin();
+        m[r * cols + static_cast<std::size_t>(col)] = t.second;
+      }
+    }
+
+    std::size_t rank = 0;
+    for (std::size_t col = 0; col < cols && rank < rows; ++col) {
+      std::size_t pivot = rank;
+      while (pivot < rows && m[pivot * cols + col] == 0) ++pivot;
+      if (pivot == rows) continue;
+      if (pivot != rank) {
+        std::swap_ranges(m.begin() + pivot * cols, m.begin() + pivot * cols + cols,
+                         m.begin() + rank * cols);
+        std::swap(equations_[pivot].data, equations_[rank].data);
+      }
+      const std::uint8_t scale = gf_inv(m[rank * cols + col]);
+      for (std::size_t j = 0; j < cols; ++j) m[rank * cols + j] = gf_mul(m[rank * cols + j], scale);
+      auto& prow = equations_[rank].data;
+      gf_mul_region(prow.data(), prow.data(), scale, width);
+      for (std::size_t r = 0; r < rows; ++r) {
+        const std::uint8_t f = m[r * cols + col];
+        if (r == rank || f == 0) continue;
+        for (std::size_t j = 0; j < cols; ++j) m[r * cols + j] ^= gf_mul(f, m[rank * cols + j]);
+        gf_mul_add_region(equations_[r].data.data(), prow.data(), f, width);
+      }
+      ++rank;
+    }
+
+    for (std::size_t r = 0; r < rows; ++r) {
+      auto& terms = equations_[r].terms;
+      terms.clear();
+      for (std::size_t j = 0; j < cols; ++j) {
+        if (m[r * cols + j] != 0) terms.emplace_back(unknowns[j], m[r * cols + j]);
+      }
+    }
+    eliminated = true;
+    progress = true;
+  }
+}
+
+bool SlidingWindowDecoder::pop_recovered(std::uint16_t& id, std::vector<std::uint8_t>& packet) {
+  if (recovered_.empty()) return false;
+  id = recovered_.front().first;
+  packet.swap(recovered_.front().second);
+  recovered_.pop_front();
+  return true;
+}
+
+}  // namespace ve
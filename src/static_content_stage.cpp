@@ -0,0 +1,159 @@
+#include "static_content_stage.h"
+#include "logger.h"
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+namespace {
+
+using namespace ve;
+
+GstPadProbeReturn on_source_data(GstPad*, GstPadProbeInfo* info, gpointer user_data) {
+  auto* stage = static_cast<StaticContentStage*>(user_data);
+  if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    return stage->on_buffer(GST_PAD_PROBE_INFO_BUFFER(info)) ? GST_PAD_PROBE_OK : GST_PAD_PROBE_DROP;
+  }
+  GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+  if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+    GstCaps* caps = nullptr;
+    gst_event_parse_caps(event, &caps);
+    stage->on_caps(caps);
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn on_encoder_data(GstPad*, GstPadProbeInfo* info, gpointer user_data) {
+  auto* stage = static_cast<StaticContentStage*>(user_data);
+  if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    if (!GST_BUFFER_FLAG_IS_SET(GST_PAD_PROBE_INFO_BUFFER(info), GST_BUFFER_FLAG_DELTA_UNIT)) {
+      stage->on_keyframe();
+    }
+  } else if (gst_video_event_is_force_key_unit(GST_PAD_PROBE_INFO_EVENT(info))) {
+    stage->on_key_unit_request();
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+}  // namespace
+
+namespace ve {
+
+StaticContentStage::StaticContentStage() = default;
+StaticContentStage::~StaticContentStage() { detach(); }
+
+bool StaticContentStage::attach(GstElement* source, GstElement* encoder, const StaticContentConfig& cfg) {
+  detach();
+  if (!source) return false;
+  source_pad_ = gst_element_get_static_pad(source, "src");
+  encoder_pad_ = encoder ? gst_element_get_static_pad(encoder, "src") : nullptr;
+  if (!source_pad_ || (encoder && !encoder_pad_)) {
+    LOG_ERROR("Static content: source or encoder pad unavailable");
+    detach();
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    detector_.reset();
+    gate_ = StaticFrameGate(cfg);
+    changed_blocks_ = 0;
+  }
+  source_probe_id_ = gst_pad_add_probe(
+      source_pad_, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+      on_source_data, this, nullptr);
+  if (encoder_pad_) {
+    event_probe_id_ = gst_pad_add_probe(
+        encoder_pad_, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_UPSTREAM),
+        on_encoder_data, this, nullptr);
+  }
+  LOG_INFO("Static content: unchanged frames skipped (", hash_kernel_name(hash_kernel()),
+           " block hash), refresh every ", cfg.refresh.count(), " ms, keyframe at least every ",
+           cfg.keyframe_interval.count(), " ms");
+  return source_probe_id_ != 0 && (!encoder_pad_ || event_probe_id_ != 0);
+}
+
+void StaticContentStage::detach() {
+  if (source_pad_) {
+    if (source_probe_id_ != 0) gst_pad_remove_probe(source_pad_, source_probe_id_);
+    gst_object_unref(source_pad_);
+    const std::uint64_t frames = gate_.frames();
+    LOG_INFO("Static content: ", gate_.skipped(), " of ", frames, " frames skipped, ", gate_.refreshes(),
+             " refreshes, ", gate_.forced_keyframes(), " forced keyframes, ",
+             frames > 0 ? static_cast<double>(changed_blocks_) / frames : 0.0, " changed blocks per frame");
+  }
+  if (encoder_pad_) {
+    if (event_probe_id_ != 0) gst_pad_remove_probe(encoder_pad_, event_probe_id_);
+    gst_object_unref(encoder_pad_);
+  }
+  if (info_) gst_video_info_free(info_);
+  info_ = nullptr;
+  source_pad_ = encoder_pad_ = nullptr;
+  source_probe_id_ = event_probe_id_ = 0;
+}
+
+void StaticContentStage::on_caps(GstCaps* caps) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (!info_) info_ = gst_video_info_new();
+  if (!caps || !gst_video_info_from_caps(info_, caps)) {
+    gst_video_info_free(info_);
+    info_ = nullptr;
+  }
+  detector_.reset();
+}
+
+bool StaticContentStage::on_buffer(GstBuffer* buffer) {
+  bool key_unit = false;
+  const bool forward = admit(buffer, &key_unit);
+  if (key_unit) {
+    // Serialized ahead of this frame, through the tee to every encoder.
+    LOG_DEBUG("Static content: keyframe interval elapsed while skipping, forcing one");
+    gst_pad_push_event(source_pad_, gst_video_event_new_downstream_force_key_unit(
+                                        GST_BUFFER_PTS(buffer), GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, TRUE, 0));
+  }
+  return forward;
+}
+
+bool StaticContentStage::admit(GstBuffer* buffer, bool* key_unit) {
+  const auto now = StaticFrameGate::Clock::now();
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (!info_) return true;
+  GstVideoFrame frame;
+  if (!gst_video_frame_map(&frame, info_, buffer, GST_MAP_READ)) return true;
+
+  // One component per plane gives its pixel bytes per row without padding.
+  planes_.clear();
+  for (guint p = 0; p < GST_VIDEO_FRAME_N_PLANES(&frame); ++p) {
+    for (guint c = 0; c < GST_VIDEO_FRAME_N_COMPONENTS(&frame); ++c) {
+      if (GST_VIDEO_FRAME_COMP_PLANE(&frame, c) != p) continue;
+      PlaneView view;
+      view.data = static_cast<const std::uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(&frame, p));
+      view.stride = static_cast<std::size_t>(GST_VIDEO_FRAME_PLANE_STRIDE(&frame, p));
+      view.row_bytes = static_cast<std::size_t>(GST_VIDEO_FRAME_COMP_WIDTH(&frame, c)) *
+                       static_cast<std::size_t>(GST_VIDEO_FRAME_COMP_PSTRIDE(&frame, c));
+      view.rows = GST_VIDEO_FRAME_COMP_HEIGHT(&frame, c);
+      // Formats without a per-pixel stride (v210, tiled): hash padding too.
+      if (view.row_bytes == 0) view.row_bytes = view.stride;
+      planes_.push_back(view);
+      break;
+    }
+  }
+  const int changed = detector_.update(planes_);
+  gst_video_frame_unmap(&frame);
+
+  changed_blocks_ += static_cast<std::uint64_t>(changed);
+  const bool forward = gate_.admit(changed > 0, now);
+  *key_unit = gate_.take_key_unit();
+  return forward;
+}
+
+void StaticContentStage::on_key_unit_request() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  gate_.force_next();
+}
+
+void StaticContentStage::on_keyframe() {
+  const auto now = StaticFrameGate::Clock::now();
+  std::lock_guard<std::mutex> lock(mtx_);
+  gate_.keyframe(now);
+}
+
+}  // namespace ve
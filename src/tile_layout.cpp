@@ -0,0 +1,40 @@
+#include "tile_layout.h"
+
+#include <algorithm>
+
+namespace ve {
+
+std::vector<Tile> plan_tiles(int width, int height, int count, int align) {
+  std::vector<Tile> tiles;
+  if (width <= 0 || height <= 0) return tiles;
+  align = std::max(align, 2);
+  const int units = (width + align - 1) / align;
+  count = std::clamp(count, 1, std::min(units, kMaxTiles));
+  int x = 0;
+  for (int i = 0; i < count; ++i) {
+    const int share = units / count + (i < units % count ? 1 : 0);
+    Tile t;
+    t.index = i;
+    t.x = x;
+    t.width = i + 1 == count ? width - x : share * align;
+    t.height = height;
+    tiles.push_back(t);
+    x += t.width;
+  }
+  return tiles;
+}
+
+std::uint32_t tile_ssrc(int index) { return kTileSsrcBase + static_cast<std::uint32_t>(index); }
+
+int tile_index(std::uint32_t ssrc, int count) {
+  if (ssrc < kTileSsrcBase) return -1;
+  const std::uint32_t index = ssrc - kTileSsrcBase;
+  return index < static_cast<std::uint32_t>(count) ? static_cast<int>(index) : -1;
+}
+
+int tile_bitrate_kbps(const Tile& tile, int frame_width, int total_kbps) {
+  if (frame_width <= 0) return total_kbps;
+  return std::max(1, static_cast<int>(static_cast<long long>(total_kbps) * tile.width / frame_width));
+}
+
+}  // namespace ve
@@ -0,0 +1,144 @@
+#include "twcc.h"
+
+namespace {
+
+std::uint16_t read16(const std::uint8_t* p) {
+  return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+}
+
+constexpr auto kDeltaUnit = std::chrono::microseconds(250);
+constexpr auto kReferenceUnit = std::chrono::milliseconds(64);
+constexpr std::uint32_t kReferenceMask = 0xffffff;
+
+std::int32_t sign_extend24(std::uint32_t v) {
+  v &= kReferenceMask;
+  return static_cast<std::int32_t>(v ^ 0x800000) - 0x800000;
+}
+
+// Packet status symbols.
+constexpr std::uint8_t kNotReceived = 0;
+constexpr std::uint8_t kSmallDelta = 1;
+constexpr std::uint8_t kLargeDelta = 2;
+
+}  // namespace
+
+namespace ve {
+
+std::int64_t TwccReferenceUnwrapper::unwrap(std::uint32_t reference) {
+  if (!have_last_) {
+    unwrapped_ = sign_extend24(reference);
+    have_last_ = true;
+  } else {
+    unwrapped_ += sign_extend24(reference - last_);
+  }
+  last_ = reference & kReferenceMask;
+  return unwrapped_;
+}
+
+bool parse_twcc_fci(std::span<const std::uint8_t> fci, TwccFeedback& out, TwccReferenceUnwrapper* reference) {
+  if (fci.size() < 8) return false;
+  out.base_seq = read16(fci.data());
+  const std::uint16_t status_count = read16(fci.data() + 2);
+  const std::uint32_t reference_time = (static_cast<std::uint32_t>(fci[4]) << 16) |
+                                       (static_cast<std::uint32_t>(fci[5]) << 8) | fci[6];
+  out.feedback_count = fci[7];
+
+  // Packet status chunks: one symbol per packet.
+  std::vector<std::uint8_t> symbols;
+  symbols.reserve(status_count);
+  std::size_t pos = 8;
+  while (symbols.size() < status_count) {
+    if (pos + 2 > fci.size()) return false;
+    const std::uint16_t chunk = read16(fci.data() + pos);
+    pos += 2;
+    if ((chunk & 0x8000) == 0) {
+      // Run length chunk: 2-bit symbol, 13-bit run.
+      const std::uint8_t symbol = (chunk >> 13) & 0x3;
+      const std::size_t run = chunk & 0x1fff;
+      for (std::size_t i = 0; i < run && symbols.size() < status_count; ++i) symbols.push_back(symbol);
+    } else if ((chunk & 0x4000) == 0) {
+      // Status vector of fourteen 1-bit symbols.
+      for (int i = 13; i >= 0 && symbols.size() < status_count; --i) {
+        symbols.push_back(static_cast<std::uint8_t>((chunk >> i) & 0x1));
+      }
+    } else {
+      // Status vector of seven 2-bit symbols.
+      for (int i = 6; i >= 0 && symbols.size() < status_count; --i) {
+        symbols.push_back(static_cast<std::uint8_t>((chunk >> (2 * i)) & 0x3));
+      }
+    }
+  }
+
+  // Receive deltas, in packet order, for every received packet.
+  out.packets.clear();
+  out.packets.reserve(status_count);
+  std::chrono::microseconds arrival{0};  // from the reference time
+  for (std::size_t i = 0; i < symbols.size(); ++i) {
+    TwccPacket p;
+    p.seq = static_cast<std::uint16_t>(out.base_seq + i);
+    if (symbols[i] == kSmallDelta) {
+      if (pos + 1 > fci.size()) return false;
+      arrival += fci[pos] * kDeltaUnit;
+      pos += 1;
+    } else if (symbols[i] == kLargeDelta) {
+      if (pos + 2 > fci.size()) return false;
+      arrival += static_cast<std::int16_t>(read16(fci.data() + pos)) * kDeltaUnit;
+      pos += 2;
+    } else if (symbols[i] != kNotReceived) {
+      return false;
+    }
+    p.received = symbols[i] != kNotReceived;
+    p.arrival = arrival;
+    out.packets.push_back(p);
+  }
+  // Unwrapped only once the message parsed, so a malformed one leaves the
+  // unwrapper alone.
+  const std::int64_t base = reference ? reference->unwrap(reference_time) : sign_extend24(reference_time);
+  for (TwccPacket& p : out.packets) p.arrival += base * kReferenceUnit;
+  return true;
+}
+
+TwccSendHistory::TwccSendHistory(std::size_t capacity) {
+  std::size_t size = 64;
+  while (size < capacity && size < 0x8000) size <<= 1;
+  ring_.resize(size);
+  mask_ = static_cast<std::uint16_t>(size - 1);
+}
+
+std::uint16_t TwccSendHistory::record(std::size_t bytes, Clock::time_point now) {
+  const std::uint16_t seq = assign();
+  sent(seq, bytes, now);
+  return seq;
+}
+
+std::uint16_t TwccSendHistory::assign() {
+  const std::uint16_t seq = next_seq_++;
+  Sent& s = ring_[seq & mask_];
+  s.seq = seq;
+  s.valid = false;
+  return seq;
+}
+
+bool TwccSendHistory::sent(std::uint16_t seq, std::size_t bytes, Clock::time_point now) {
+  Sent& s = ring_[seq & mask_];
+  if (s.seq != seq || s.valid) return false;
+  s.time = now;
+  s.bytes = bytes;
+  s.valid = true;
+  return true;
+}
+
+void TwccSendHistory::resolve(const TwccFeedback& feedback, std::vector<PacketResult>& out) const {
+  for (const TwccPacket& p : feedback.packets) {
+    const Sent& s = ring_[p.seq & mask_];
+    if (!s.valid || s.seq != p.seq) continue;
+    PacketResult r;
+    r.send_time = s.time;
+    r.arrival = p.arrival;
+    r.bytes = s.bytes;
+    r.received = p.received;
+    out.push_back(r);
+  }
+}
+
+}  // namespace ve
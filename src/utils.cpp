@@ -1,5 +1,6 @@
 #include "utils.h"
 #include "logger.h"
+#include "tile_layout.h"
 
 #include <algorithm>
 #include <charconv>
@@ -70,7 +71,21 @@ static void print_usage(const char* prog) {
             << "  --source=ximagesrc|v4l2src\n"
             << "  --width=<int>  --height=<int>  --fps=<int>\n"
             << "  --bitrate=<kbps>  --fec=<percentage 0-100>\n"
-            << "  --latency=<ms sender jitter buffer target>\n";
+            << "  --fec-engine=ulpfec|xor\n"
+            << "  --fec-idr=<percentage>  --fec-params=<percentage> (xor engine only)\n"
+            << "  --latency=<ms sender jitter buffer target>\n"
+            << "  --twcc-ext=<1-14, 0 = off> transport-wide CC extension id (rtpbin mode)\n"
+            << "  --adapt=joint|bitrate  joint also retunes FEC and steps the resolution ladder\n"
+            << "  --protection=auto|fec|rtx|both  loss repair; auto picks by RTT (rtpbin mode)\n"
+            << "  --rtx-window=<ms> receiver jitter-buffer delay available for retransmissions\n"
+            << "  --gop=<seconds> max keyframe distance (default 10 in rtpbin mode, 2 in simple mode)\n"
+            << "  --probe=on|off  padding bursts to find spare capacity (needs --twcc-ext)\n"
+            << "  --cpu-adapt=on|off  lower frame rate/resolution while the encoder falls behind\n"
+            << "  --fused-convert=on|off  convert RGB sources to I420 and scale in one threaded pass\n"
+            << "  --static-refresh=<ms> skip unchanged frames, sending one per interval (0 = off)\n"
+            << "  --tiles=<n> split frames into n vertical strips encoded in parallel (simple mode)\n"
+            << "  --low-delay=on|off  encode slices in parallel and send each as soon as it is ready\n"
+            << "  --mtu-slices=on|off  limit slices to one RTP packet each, so a loss costs one slice\n";
 }
 
 std::optional<EngineConfig> parse_args(int argc, char** argv) {
@@ -114,6 +129,21 @@ std::optional<EngineConfig> parse_args(int argc, char** argv) {
     else if (auto v = eat("--fec")) cfg.fec_percentage = std::clamp(std::stoi(*v), 0, 100);
     else if (auto v = eat("--latency")) cfg.latency_ms = std::clamp(std::stoi(*v), 10, 200);
     else if (auto v = eat("--mode")) cfg.mode = *v;
+    else if (auto v = eat("--fec-engine")) cfg.fec_engine = *v;
+    else if (auto v = eat("--fec-idr")) cfg.fec_idr_percentage = std::clamp(std::stoi(*v), 0, 100);
+    else if (auto v = eat("--fec-params")) cfg.fec_params_percentage = std::clamp(std::stoi(*v), 0, 100);
+    else if (auto v = eat("--adapt")) cfg.adapt = *v;
+    else if (auto v = eat("--twcc-ext")) cfg.twcc_ext_id = std::clamp(std::stoi(*v), 0, 14);
+    else if (auto v = eat("--protection")) cfg.protection = *v;
+    else if (auto v = eat("--rtx-window")) cfg.rtx_window_ms = std::clamp(std::stoi(*v), 20, 2000);
+    else if (auto v = eat("--probe")) cfg.probing = *v != "off" && *v != "0";
+    else if (auto v = eat("--cpu-adapt")) cfg.cpu_adapt = *v != "off" && *v != "0";
+    else if (auto v = eat("--fused-convert")) cfg.fused_convert = *v != "off" && *v != "0";
+    else if (auto v = eat("--static-refresh")) cfg.static_refresh_ms = std::clamp(std::stoi(*v), 0, 10000);
+    else if (auto v = eat("--tiles")) cfg.tiles = std::clamp(std::stoi(*v), 1, kMaxTiles);
+    else if (auto v = eat("--low-delay")) cfg.low_delay = *v == "on" || *v == "1";
+    else if (auto v = eat("--mtu-slices")) cfg.mtu_slices = *v == "on" || *v == "1";
+    else if (auto v = eat("--gop")) cfg.gop_seconds = std::clamp(std::stoi(*v), 1, 300);
     else {
       LOG_WARN("Unknown arg: ", a);
     }
@@ -124,13 +154,65 @@ std::optional<EngineConfig> parse_args(int argc, char** argv) {
     cfg.source = "ximagesrc";
   }
 
-  if (cfg.mode != "rtpbin" && cfg.mode != "simple") {
-    LOG_WARN("Unsupported mode '", cfg.mode, "', defaulting to rtpbin");
-    cfg.mode = "rtpbin";
+  if (!cfg.mode.empty() && cfg.mode != "rtpbin" && cfg.mode != "simple") {
+    LOG_WARN("Unsupported mode '", cfg.mode, "', using the default");
+    cfg.mode.clear();
+  }
+
+  // Strips are cropped at fixed columns and leave as several SSRCs on one
+  // port: the size must not change, and the FEC and feedback paths handle a
+  // single stream. Only options given explicitly are worth a warning.
+  if (cfg.tiles > 1) {
+    if (!cfg.mode.empty() && cfg.mode != "simple") LOG_WARN("--tiles uses --mode=simple");
+    if (cfg.fec_percentage > 0) LOG_WARN("FEC is not applied to tiled streams");
+    cfg.mode = "simple";
+    cfg.fec_engine = "ulpfec";
+    cfg.fec_percentage = cfg.fec_idr_percentage = cfg.fec_params_percentage = 0;
+    cfg.adapt = "bitrate";
+    cfg.cpu_adapt = false;
+  }
+  if (cfg.mode.empty()) cfg.mode = "rtpbin";
+  if (cfg.fec_percentage < 0) cfg.fec_percentage = 20;
+
+  if (cfg.fec_engine != "ulpfec" && cfg.fec_engine != "xor") {
+    LOG_WARN("Unsupported FEC engine '", cfg.fec_engine, "', defaulting to ulpfec");
+    cfg.fec_engine = "ulpfec";
+  }
+
+  if (cfg.adapt != "joint" && cfg.adapt != "bitrate") {
+    LOG_WARN("Unsupported adaptation '", cfg.adapt, "', defaulting to joint");
+    cfg.adapt = "joint";
+  }
+
+  if (!cfg.protection.empty() && cfg.protection != "auto" && cfg.protection != "fec" &&
+      cfg.protection != "rtx" && cfg.protection != "both") {
+    LOG_WARN("Unsupported protection '", cfg.protection, "', using the mode's default");
+    cfg.protection.clear();
+  }
+  // Only rtpbin's RTCP session hears NACKs; an explicit request for
+  // retransmission is all that deserves a warning.
+  if (cfg.protection.empty()) cfg.protection = cfg.mode == "rtpbin" ? "auto" : "fec";
+  if (cfg.mode != "rtpbin" && cfg.protection != "fec") {
+    LOG_WARN("Retransmission needs --mode=rtpbin; protection is FEC only");
+    cfg.protection = "fec";
+  }
+  if (cfg.protection == "rtx") {
+    cfg.fec_percentage = cfg.fec_idr_percentage = cfg.fec_params_percentage = 0;
+  }
+
+  if (cfg.fec_idr_percentage < 0) cfg.fec_idr_percentage = cfg.fec_percentage;
+  if (cfg.fec_params_percentage < 0) cfg.fec_params_percentage = cfg.fec_percentage;
+  if (cfg.fec_engine != "xor" &&
+      (cfg.fec_idr_percentage != cfg.fec_percentage || cfg.fec_params_percentage != cfg.fec_percentage)) {
+    LOG_WARN("--fec-idr/--fec-params need --fec-engine=xor; using uniform ", cfg.fec_percentage, "%");
   }
 
   cfg.latency_ms = std::clamp(cfg.latency_ms, 10, 200);
 
+  // Receivers can only ask for a keyframe over RTCP; without it the GOP
+  // bounds how long a decoder stays broken after a loss.
+  if (cfg.gop_seconds == 0) cfg.gop_seconds = cfg.mode == "rtpbin" ? 10 : 2;
+
   return cfg;
 }
 
@@ -0,0 +1,65 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+namespace ve {
+
+WorkerPool::WorkerPool(int helpers) {
+  threads_.reserve(static_cast<std::size_t>(std::max(helpers, 0)));
+  for (int i = 0; i < helpers; ++i) threads_.emplace_back([this] { worker(); });
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  start_cv_.notify_all();
+  for (auto& t : threads_) t.join();
+}
+
+void WorkerPool::run(int tasks, const std::function<void(int)>& fn) {
+  if (tasks <= 0) return;
+  if (threads_.empty() || tasks == 1) {
+    for (int i = 0; i < tasks; ++i) fn(i);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    fn_ = &fn;
+    tasks_ = tasks;
+    next_.store(0, std::memory_order_relaxed);
+    busy_ = threads_.size();
+    ++generation_;
+  }
+  start_cv_.notify_all();
+  drain();
+
+  std::unique_lock<std::mutex> lock(mtx_);
+  done_cv_.wait(lock, [this] { return busy_ == 0; });
+  fn_ = nullptr;
+}
+
+void WorkerPool::drain() {
+  for (int i = next_.fetch_add(1, std::memory_order_relaxed); i < tasks_;
+       i = next_.fetch_add(1, std::memory_order_relaxed)) {
+    (*fn_)(i);
+  }
+}
+
+void WorkerPool::worker() {
+  std::uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      start_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) return;
+      seen = generation_;
+    }
+    drain();
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (--busy_ == 0) done_cv_.notify_one();
+  }
+}
+
+}  // namespace ve
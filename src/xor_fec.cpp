@@ -1,32 +1,273 @@
 #include "xor_fec.h"
+#include "xor_kernels.h"
 
 #include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+using namespace ve;
+
+constexpr std::size_t kInlinePackets = 64;
+
+// Small-buffer scratch so typical group sizes do not touch the heap.
+template <typename T>
+class Scratch {
+ public:
+  explicit Scratch(std::size_t n) : n_(n) {
+    if (n_ > kInlinePackets) heap_.resize(n_);
+  }
+  T* data() { return n_ > kInlinePackets ? heap_.data() : inline_.data(); }
+  T& operator[](std::size_t i) { return data()[i]; }
+
+ private:
+  std::size_t n_;
+  std::array<T, kInlinePackets> inline_{};
+  std::vector<T> heap_;
+};
+
+std::vector<std::span<const std::uint8_t>> as_spans(
+    const std::vector<std::vector<std::uint8_t>>& packets) {
+  return {packets.begin(), packets.end()};
+}
+
+}  // namespace
 
 namespace ve {
 
+void xor_accumulate(std::span<std::uint8_t> dst,
+                    std::span<const std::span<const std::uint8_t>> packets) {
+  const std::size_t n = packets.size();
+  if (n == 0 || dst.empty()) return;
+
+  Scratch<std::size_t> order(n);
+  Scratch<const std::uint8_t*> ptrs(n);
+  bool uniform = true;
+  for (std::size_t i = 0; i < n; ++i) {
+    order[i] = i;
+    uniform = uniform && packets[i].size() == packets[0].size();
+  }
+
+  if (uniform) {
+    for (std::size_t i = 0; i < n; ++i) ptrs[i] = packets[i].data();
+    xor_into(dst.data(), ptrs.data(), n, std::min(dst.size(), packets[0].size()));
+    return;
+  }
+
+  // Mixed lengths: walk segments between distinct lengths, shortest first,
+  // so each kernel call only sees sources that cover the whole segment.
+  std::sort(order.data(), order.data() + n, [&](std::size_t a, std::size_t b) {
+    return packets[a].size() < packets[b].size();
+  });
+  std::size_t start = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::size_t end = std::min(dst.size(), packets[order[i]].size());
+    if (end <= start) continue;
+    const std::size_t active = n - i;
+    for (std::size_t j = 0; j < active; ++j) ptrs[j] = packets[order[i + j]].data() + start;
+    xor_into(dst.data() + start, ptrs.data(), active, end - start);
+    start = end;
+  }
+}
+
 FecPacket xor_parity(const std::vector<std::vector<std::uint8_t>>& packets,
                      std::uint32_t group_id) {
+  const auto spans = as_spans(packets);
+  return xor_parity(std::span<const std::span<const std::uint8_t>>(spans), group_id);
+}
+
+FecPacket xor_parity(std::span<const std::span<const std::uint8_t>> packets,
+                     std::uint32_t group_id) {
   FecPacket fec;
   fec.group_id = group_id;
   fec.count = static_cast<std::uint16_t>(packets.size());
   size_t maxlen = 0;
   for (const auto& p : packets) maxlen = std::max(maxlen, p.size());
   fec.data.assign(maxlen, 0);
-  for (const auto& p : packets) {
-    for (size_t i = 0; i < p.size(); ++i) fec.data[i] ^= p[i];
-  }
+  xor_accumulate(fec.data, packets);
   return fec;
 }
 
 std::vector<std::uint8_t> xor_recover(const std::vector<std::vector<std::uint8_t>>& received,
                                       const FecPacket& parity) {
+  const auto spans = as_spans(received);
+  return xor_recover(std::span<const std::span<const std::uint8_t>>(spans), parity);
+}
+
+std::vector<std::uint8_t> xor_recover(std::span<const std::span<const std::uint8_t>> received,
+                                      const FecPacket& parity) {
   // Only works if exactly one packet is missing and the rest align to max len.
-  size_t maxlen = parity.data.size();
   std::vector<std::uint8_t> out = parity.data; // start from parity, XOR back
-  for (const auto& p : received) {
-    for (size_t i = 0; i < p.size(); ++i) out[i] ^= p[i];
+  xor_accumulate(out, received);
+  return out;
+}
+
+FecMatrixParity xor_parity_2d(std::span<const std::span<const std::uint8_t>> packets,
+                              FecMatrix shape, std::uint32_t group_id) {
+  FecMatrixParity out;
+  const std::size_t cols = shape.columns;
+  const std::size_t rows = shape.rows;
+  if (cols == 0 || rows == 0 || packets.size() != cols * rows) return out;
+
+  out.row_parity.reserve(rows);
+  for (std::size_t r = 0; r < rows; ++r) {
+    out.row_parity.push_back(xor_parity(packets.subspan(r * cols, cols), group_id));
+  }
+
+  Scratch<std::span<const std::uint8_t>> column(rows);
+  out.column_parity.reserve(cols);
+  for (std::size_t c = 0; c < cols; ++c) {
+    for (std::size_t r = 0; r < rows; ++r) column[r] = packets[r * cols + c];
+    out.column_parity.push_back(
+        xor_parity(std::span<const std::span<const std::uint8_t>>(column.data(), rows), group_id));
+  }
+  return out;
+}
+
+std::size_t xor_recover_2d(std::vector<std::vector<std::uint8_t>>& packets,
+                           std::vector<bool>& present, FecMatrix shape,
+                           const FecMatrixParity& parity) {
+  const std::size_t cols = shape.columns;
+  const std::size_t rows = shape.rows;
+  if (cols == 0 || rows == 0 || packets.size() != cols * rows ||
+      present.size() != packets.size() || parity.row_parity.size() != rows ||
+      parity.column_parity.size() != cols) {
+    return 0;
+  }
+
+  Scratch<std::span<const std::uint8_t>> received(std::max(cols, rows));
+
+  // Repairs one line (row or column) if exactly one of its packets is missing.
+  auto repair_line = [&](const FecPacket& fec, std::size_t first, std::size_t stride,
+                         std::size_t n) -> bool {
+    if (fec.count == 0) return false;
+    std::size_t missing = 0;
+    std::size_t missing_idx = 0;
+    std::size_t have = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      const std::size_t idx = first + i * stride;
+      if (present[idx]) {
+        received[have++] = packets[idx];
+      } else {
+        ++missing;
+        missing_idx = idx;
+      }
+    }
+    if (missing != 1) return false;
+    packets[missing_idx] = xor_recover(
+        std::span<const std::span<const std::uint8_t>>(received.data(), have), fec);
+    present[missing_idx] = true;
+    return true;
+  };
+
+  std::size_t recovered = 0;
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (std::size_t r = 0; r < rows; ++r) {
+      if (repair_line(parity.row_parity[r], r * cols, 1, cols)) {
+        ++recovered;
+        progress = true;
+      }
+    }
+    for (std::size_t c = 0; c < cols; ++c) {
+      if (repair_line(parity.column_parity[c], c, cols, rows)) {
+        ++recovered;
+        progress = true;
+      }
+    }
   }
+  return recovered;
+}
+
+ParityBufferPool::ParityBufferPool(std::size_t buffers, std::size_t capacity)
+    : capacity_(capacity), stride_((capacity + 63) / 64 * 64) {
+  arena_.resize(buffers * stride_);
+  free_.reserve(buffers);
+  for (std::size_t i = buffers; i > 0; --i) free_.push_back(static_cast<std::uint32_t>(i - 1));
+}
+
+std::uint32_t ParityBufferPool::acquire() {
+  if (free_.empty()) return kNone;
+  const std::uint32_t index = free_.back();
+  free_.pop_back();
+  return index;
+}
+
+void ParityBufferPool::release(std::uint32_t index) {
+  if (index != kNone) free_.push_back(index);
+}
+
+PooledParity::PooledParity(ParityBufferPool* pool, std::uint32_t index, std::size_t size,
+                           std::uint32_t group_id, std::uint16_t count)
+    : pool_(pool), index_(index), size_(size), group_id_(group_id), count_(count) {}
+
+PooledParity::PooledParity(PooledParity&& other) noexcept
+    : pool_(std::exchange(other.pool_, nullptr)),
+      index_(std::exchange(other.index_, ParityBufferPool::kNone)),
+      size_(other.size_),
+      group_id_(other.group_id_),
+      count_(other.count_) {}
+
+PooledParity& PooledParity::operator=(PooledParity&& other) noexcept {
+  if (this != &other) {
+    release();
+    pool_ = std::exchange(other.pool_, nullptr);
+    index_ = std::exchange(other.index_, ParityBufferPool::kNone);
+    size_ = other.size_;
+    group_id_ = other.group_id_;
+    count_ = other.count_;
+  }
+  return *this;
+}
+
+std::span<const std::uint8_t> PooledParity::data() const {
+  if (!pool_) return {};
+  return {pool_->data(index_), size_};
+}
+
+void PooledParity::release() {
+  if (pool_) pool_->release(index_);
+  pool_ = nullptr;
+  index_ = ParityBufferPool::kNone;
+}
+
+bool XorParityAccumulator::begin(std::uint32_t group_id) {
+  abort();
+  index_ = pool_.acquire();
+  if (index_ == ParityBufferPool::kNone) return false;
+  size_ = 0;
+  count_ = 0;
+  group_id_ = group_id;
+  return true;
+}
+
+bool XorParityAccumulator::add(std::span<const std::uint8_t> packet) {
+  if (!active() || packet.size() > pool_.capacity()) return false;
+  std::uint8_t* buf = pool_.data(index_);
+  // Only the newly covered tail needs clearing; the rest already holds parity.
+  if (packet.size() > size_) {
+    std::memset(buf + size_, 0, packet.size() - size_);
+    size_ = packet.size();
+  }
+  const std::uint8_t* src = packet.data();
+  xor_into(buf, &src, 1, packet.size());
+  ++count_;
+  return true;
+}
+
+PooledParity XorParityAccumulator::finish() {
+  if (!active()) return {};
+  PooledParity out(&pool_, index_, size_, group_id_, count_);
+  index_ = ParityBufferPool::kNone;
   return out;
 }
 
+void XorParityAccumulator::abort() {
+  if (active()) pool_.release(index_);
+  index_ = ParityBufferPool::kNone;
+}
+
 }  // namespace ve
@@ -0,0 +1,147 @@
+#include "xor_kernels.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VE_XOR_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using namespace ve;
+
+constexpr std::size_t kLine = 64;
+
+using XorFn = void (*)(std::uint8_t*, const std::uint8_t* const*, std::size_t, std::size_t);
+
+inline std::uint64_t load64(const std::uint8_t* p) {
+  std::uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline void store64(std::uint8_t* p, std::uint64_t v) { std::memcpy(p, &v, sizeof(v)); }
+
+void xor_tail(std::uint8_t* dst, const std::uint8_t* const* srcs, std::size_t n,
+              std::size_t from, std::size_t len) {
+  for (std::size_t i = from; i < len; ++i) {
+    std::uint8_t acc = dst[i];
+    for (std::size_t s = 0; s < n; ++s) acc ^= srcs[s][i];
+    dst[i] = acc;
+  }
+}
+
+void xor_scalar(std::uint8_t* dst, const std::uint8_t* const* srcs, std::size_t n,
+                std::size_t len) {
+  std::size_t off = 0;
+  for (; off + kLine <= len; off += kLine) {
+    std::uint64_t acc[8];
+    for (int w = 0; w < 8; ++w) acc[w] = load64(dst + off + w * 8);
+    for (std::size_t s = 0; s < n; ++s) {
+      const std::uint8_t* p = srcs[s] + off;
+      for (int w = 0; w < 8; ++w) acc[w] ^= load64(p + w * 8);
+    }
+    for (int w = 0; w < 8; ++w) store64(dst + off + w * 8, acc[w]);
+  }
+  for (; off + 8 <= len; off += 8) {
+    std::uint64_t acc = load64(dst + off);
+    for (std::size_t s = 0; s < n; ++s) acc ^= load64(srcs[s] + off);
+    store64(dst + off, acc);
+  }
+  xor_tail(dst, srcs, n, off, len);
+}
+
+#ifdef VE_XOR_X86
+
+__attribute__((target("sse2")))
+void xor_sse2(std::uint8_t* dst, const std::uint8_t* const* srcs, std::size_t n,
+              std::size_t len) {
+  std::size_t off = 0;
+  for (; off + kLine <= len; off += kLine) {
+    auto* d = reinterpret_cast<__m128i*>(dst + off);
+    __m128i a0 = _mm_loadu_si128(d + 0);
+    __m128i a1 = _mm_loadu_si128(d + 1);
+    __m128i a2 = _mm_loadu_si128(d + 2);
+    __m128i a3 = _mm_loadu_si128(d + 3);
+    for (std::size_t s = 0; s < n; ++s) {
+      const auto* p = reinterpret_cast<const __m128i*>(srcs[s] + off);
+      a0 = _mm_xor_si128(a0, _mm_loadu_si128(p + 0));
+      a1 = _mm_xor_si128(a1, _mm_loadu_si128(p + 1));
+      a2 = _mm_xor_si128(a2, _mm_loadu_si128(p + 2));
+      a3 = _mm_xor_si128(a3, _mm_loadu_si128(p + 3));
+    }
+    _mm_storeu_si128(d + 0, a0);
+    _mm_storeu_si128(d + 1, a1);
+    _mm_storeu_si128(d + 2, a2);
+    _mm_storeu_si128(d + 3, a3);
+  }
+  for (; off + 16 <= len; off += 16) {
+    auto* d = reinterpret_cast<__m128i*>(dst + off);
+    __m128i a = _mm_loadu_si128(d);
+    for (std::size_t s = 0; s < n; ++s) {
+      a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcs[s] + off)));
+    }
+    _mm_storeu_si128(d, a);
+  }
+  xor_tail(dst, srcs, n, off, len);
+}
+
+__attribute__((target("avx2")))
+void xor_avx2(std::uint8_t* dst, const std::uint8_t* const* srcs, std::size_t n,
+              std::size_t len) {
+  std::size_t off = 0;
+  for (; off + kLine <= len; off += kLine) {
+    auto* d = reinterpret_cast<__m256i*>(dst + off);
+    __m256i a0 = _mm256_loadu_si256(d + 0);
+    __m256i a1 = _mm256_loadu_si256(d + 1);
+    for (std::size_t s = 0; s < n; ++s) {
+      const auto* p = reinterpret_cast<const __m256i*>(srcs[s] + off);
+      a0 = _mm256_xor_si256(a0, _mm256_loadu_si256(p + 0));
+      a1 = _mm256_xor_si256(a1, _mm256_loadu_si256(p + 1));
+    }
+    _mm256_storeu_si256(d + 0, a0);
+    _mm256_storeu_si256(d + 1, a1);
+  }
+  for (; off + 16 <= len; off += 16) {
+    auto* d = reinterpret_cast<__m128i*>(dst + off);
+    __m128i a = _mm_loadu_si128(d);
+    for (std::size_t s = 0; s < n; ++s) {
+      a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcs[s] + off)));
+    }
+    _mm_storeu_si128(d, a);
+  }
+  xor_tail(dst, srcs, n, off, len);
+}
+
+#endif  // VE_XOR_X86
+
+constexpr KernelEntry<XorFn> kKernels[] = {
+#ifdef VE_XOR_X86
+    {SimdLevel::Avx2, xor_avx2},
+    {SimdLevel::Sse2, xor_sse2},
+#endif
+    {SimdLevel::Scalar, xor_scalar},
+};
+
+KernelDispatch<XorFn>& dispatch() {
+  static KernelDispatch<XorFn> d(kKernels);
+  return d;
+}
+
+}  // namespace
+
+namespace ve {
+
+void xor_into(std::uint8_t* dst, const std::uint8_t* const* srcs, std::size_t n,
+              std::size_t len) {
+  if (!dst || len == 0 || n == 0) return;
+  dispatch().table()(dst, srcs, n, len);
+}
+
+XorKernel xor_kernel() { return dispatch().level(); }
+bool xor_kernel_supported(XorKernel kernel) { return dispatch().supports(kernel); }
+bool set_xor_kernel(XorKernel kernel) { return dispatch().select(kernel); }
+const char* xor_kernel_name(XorKernel kernel) { return simd_level_name(kernel); }
+
+}  // namespace ve
@@ -0,0 +1,38 @@
+// Minimal assertions for the unit tests: each test binary returns non-zero if any check failed
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+namespace ve::test {
+
+inline int& failures() {
+  static int n = 0;
+  return n;
+}
+
+inline int result(const char* name) {
+  if (failures() == 0) std::printf("%s: ok\n", name);
+  return failures() == 0 ? 0 : 1;
+}
+
+}  // namespace ve::test
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      ++ve::test::failures();                                                  \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                         \
+  do {                                                                         \
+    const auto va_ = (a);                                                      \
+    const auto vb_ = (b);                                                      \
+    if (!(va_ == vb_)) {                                                       \
+      std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, \
+                   static_cast<long long>(va_), static_cast<long long>(vb_));  \
+      ++ve::test::failures();                                                  \
+    }                                                                          \
+  } while (0)
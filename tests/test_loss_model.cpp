@@ -0,0 +1,107 @@
+// Loss pattern fit and FEC interleave choice: i.i.d. loss must not be mistaken for bursts
+#include "check.h"
+#include "loss_model.h"
+#include "rate_controller.h"
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace ve;
+
+namespace {
+
+// Received flags: i.i.d. loss at `loss`, or Gilbert-Elliott bursts with the
+// same average loss and mean burst length `burst` (all losses in the burst).
+class LossTrace {
+ public:
+  LossTrace(double loss, double burst, std::uint32_t seed) : loss_(loss), rng_(seed) {
+    if (burst > 1.0) {
+      r_ = 1.0 / burst;
+      p_ = loss * r_ / (1.0 - loss);
+    }
+  }
+  std::vector<bool> next(std::size_t n) {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::vector<bool> received(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      if (r_ == 0.0) {
+        received[i] = u(rng_) >= loss_;
+      } else {
+        bad_ = bad_ ? u(rng_) >= r_ : u(rng_) < p_;
+        received[i] = !bad_;
+      }
+    }
+    return received;
+  }
+
+ private:
+  double loss_;
+  double p_ = 0.0;
+  double r_ = 0.0;
+  bool bad_ = false;
+  std::mt19937 rng_;
+};
+
+void test_iid_not_bursty() {
+  for (std::uint32_t seed = 1; seed <= 20; ++seed) {
+    for (double loss : {0.01, 0.03, 0.10}) {
+      GilbertElliottEstimator m;
+      m.add(LossTrace(loss, 1.0, seed).next(20000));
+      CHECK(!m.bursty());
+    }
+  }
+}
+
+void test_bursts_detected() {
+  for (std::uint32_t seed = 1; seed <= 20; ++seed) {
+    GilbertElliottEstimator m;
+    m.add(LossTrace(0.03, 4.0, seed).next(20000));
+    CHECK(m.bursty());
+  }
+}
+
+// One minute of receiver reports with RTCP XR loss RLE blocks, 400 packets
+// per second; returns the interleave after every report.
+std::vector<int> run_controller(double loss, double burst, std::uint32_t seed) {
+  RateController rc(4000);
+  rc.set_fec_percentage(20);
+  rc.enable_loss_patterns(FecLayoutConfig{});
+  LossTrace trace(loss, burst, seed);
+  std::vector<int> interleave;
+  std::uint16_t seq = 0;
+  const RateController::Clock::time_point t0{};
+  for (int s = 1; s <= 60; ++s) {
+    XrLossRle block;
+    block.begin_seq = seq;
+    block.received = trace.next(400);
+    seq = static_cast<std::uint16_t>(seq + block.received.size());
+    block.end_seq = seq;
+    rc.on_loss_rle(1, block);
+    interleave.push_back(rc.on_receiver_report(loss, 80.0, t0 + std::chrono::seconds(s)).fec_interleave);
+  }
+  return interleave;
+}
+
+void test_iid_keeps_interleave_one() {
+  for (std::uint32_t seed = 1; seed <= 20; ++seed) {
+    for (int d : run_controller(0.03, 1.0, seed)) CHECK_EQ(d, 1);
+  }
+}
+
+void test_bursts_interleave() {
+  int deeper = 0;
+  for (std::uint32_t seed = 1; seed <= 20; ++seed) deeper += run_controller(0.03, 4.0, seed).back() > 1;
+  CHECK(deeper >= 18);
+}
+
+}  // namespace
+
+int main() {
+  test_iid_not_bursty();
+  test_bursts_detected();
+  test_iid_keeps_interleave_one();
+  test_bursts_interleave();
+  return test::result("loss_model");
+}
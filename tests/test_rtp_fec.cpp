@@ -0,0 +1,111 @@
+// RFC 5109 encoder grouping: group size, sequence gaps and SSRC changes
+#include "check.h"
+#include "rtp_fec.h"
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+using namespace ve;
+
+namespace {
+
+std::vector<std::uint8_t> make_rtp(std::uint16_t seq, std::uint32_t ssrc = 0x1234) {
+  std::vector<std::uint8_t> p(kRtpHeaderSize + 100, static_cast<std::uint8_t>(seq));
+  p[0] = 0x80;
+  p[1] = 96;
+  p[2] = static_cast<std::uint8_t>(seq >> 8);
+  p[3] = static_cast<std::uint8_t>(seq);
+  for (int i = 0; i < 4; ++i) p[4 + i] = 0;
+  for (int i = 0; i < 4; ++i) p[8 + i] = static_cast<std::uint8_t>(ssrc >> (24 - 8 * i));
+  return p;
+}
+
+// Media packets covered by a parity packet, and its base sequence number.
+int covered(const std::vector<std::uint8_t>& fec, std::uint16_t* base = nullptr) {
+  RtpFecHeader h;
+  if (!parse_rtp_fec(fec, h)) return -1;
+  if (base) *base = h.sn_base;
+  return std::popcount(h.mask);
+}
+
+void test_groups_of_configured_size() {
+  RtpFecEncoder enc({127, 4});
+  std::vector<std::uint8_t> out;
+  int parity = 0;
+  for (std::uint16_t seq = 0; seq < 20; ++seq) {
+    if (enc.add(make_rtp(seq), out)) {
+      ++parity;
+      CHECK_EQ(covered(out), 4);
+    }
+    CHECK(!enc.poll(out));
+  }
+  CHECK_EQ(parity, 5);
+}
+
+void test_gap_with_group_size_one() {
+  RtpFecEncoder enc({127, 3});
+  std::vector<std::uint8_t> out;
+  CHECK(!enc.add(make_rtp(10), out));
+  CHECK(!enc.add(make_rtp(11), out));
+  enc.set_group_size(1);
+
+  // The gap closes {10, 11}; packet 200 alone is already a full group.
+  std::uint16_t base = 0;
+  CHECK(enc.add(make_rtp(200), out));
+  CHECK_EQ(covered(out, &base), 2);
+  CHECK_EQ(base, 10);
+  CHECK(enc.poll(out));
+  CHECK_EQ(covered(out, &base), 1);
+  CHECK_EQ(base, 200);
+  CHECK(!enc.poll(out));
+
+  CHECK(enc.add(make_rtp(201), out));
+  CHECK_EQ(covered(out, &base), 1);
+  CHECK_EQ(base, 201);
+}
+
+void test_ssrc_change_closes_group() {
+  RtpFecEncoder enc({127, 2});
+  std::vector<std::uint8_t> out;
+  CHECK(!enc.add(make_rtp(5, 1), out));
+  CHECK(enc.add(make_rtp(6, 2), out));
+  CHECK_EQ(covered(out), 1);
+  CHECK(!enc.poll(out));
+  CHECK(enc.add(make_rtp(7, 2), out));
+  CHECK_EQ(covered(out), 2);
+}
+
+void test_uep_emits_both_after_gap() {
+  UepFecConfig cfg;
+  cfg.percentage = {34, 34, 34};  // group of 3
+  UepFecEncoder enc(cfg);
+  std::vector<int> groups;
+  enc.set_sink([&](std::span<const std::uint8_t> fec) {
+    RtpFecHeader h;
+    groups.push_back(parse_rtp_fec(fec, h) ? std::popcount(h.mask) : -1);
+  });
+  enc.add(make_rtp(0));
+  enc.add(make_rtp(1));
+  enc.set_percentage(H264Priority::NonIdr, 100);
+  enc.set_percentage(H264Priority::Idr, 100);
+  enc.set_percentage(H264Priority::ParameterSet, 100);
+  enc.add(make_rtp(500));
+  enc.add(make_rtp(501));
+  CHECK_EQ(groups.size(), 3u);
+  if (groups.size() == 3) {
+    CHECK_EQ(groups[0], 2);
+    CHECK_EQ(groups[1], 1);
+    CHECK_EQ(groups[2], 1);
+  }
+}
+
+}  // namespace
+
+int main() {
+  test_groups_of_configured_size();
+  test_gap_with_group_size_one();
+  test_ssrc_change_closes_group();
+  test_uep_emits_both_after_gap();
+  return test::result("rtp_fec");
+}
@@ -0,0 +1,94 @@
+// Static-content gate: refreshes, settling and wall-clock keyframes while frames are skipped
+#include "check.h"
+#include "frame_diff.h"
+
+#include <chrono>
+
+using namespace ve;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Clock = StaticFrameGate::Clock;
+
+StaticContentConfig config(std::chrono::milliseconds keyframe_interval) {
+  StaticContentConfig cfg;
+  cfg.refresh = 1000ms;
+  cfg.settle_frames = 0;
+  cfg.keyframe_interval = keyframe_interval;
+  return cfg;
+}
+
+// Feeds `seconds` of unchanged 30 fps frames from `start`; returns forced key units.
+int run_static(StaticFrameGate& gate, Clock::time_point start, int seconds) {
+  int key_units = 0;
+  for (int i = 0; i < seconds * 30; ++i) {
+    gate.admit(false, start + i * 33ms);
+    if (gate.take_key_unit()) ++key_units;
+  }
+  return key_units;
+}
+
+void test_refresh_only_without_interval() {
+  StaticFrameGate gate(config(0ms));
+  const auto t0 = Clock::now();
+  CHECK(gate.admit(true, t0));
+  CHECK_EQ(run_static(gate, t0 + 33ms, 60), 0);
+  CHECK_EQ(gate.forced_keyframes(), 0);
+  CHECK(gate.skipped() > 1700);
+}
+
+void test_keyframe_every_interval_while_skipping() {
+  StaticFrameGate gate(config(10000ms));
+  const auto t0 = Clock::now();
+  CHECK(gate.admit(true, t0));
+  CHECK(!gate.take_key_unit());
+  // 60 s of a static screen: a keyframe at 10, 20, ... 60 s, each forwarded.
+  CHECK_EQ(run_static(gate, t0 + 33ms, 60), 5);
+  CHECK_EQ(gate.forced_keyframes(), 5);
+}
+
+void test_encoder_keyframes_postpone() {
+  StaticFrameGate gate(config(10000ms));
+  auto t = Clock::now();
+  CHECK(gate.admit(true, t));
+  for (int i = 0; i < 6; ++i) {
+    CHECK_EQ(run_static(gate, t + 33ms, 8), 0);
+    t += 8s;
+    gate.keyframe(t);  // a PLI answered by the encoder
+  }
+  CHECK_EQ(gate.forced_keyframes(), 0);
+}
+
+void test_no_forcing_while_frames_flow() {
+  StaticFrameGate gate(config(2000ms));
+  const auto t0 = Clock::now();
+  for (int i = 0; i < 30 * 30; ++i) {
+    CHECK(gate.admit(true, t0 + i * 33ms));
+    CHECK(!gate.take_key_unit());
+  }
+  CHECK_EQ(gate.skipped(), 0);
+}
+
+void test_forced_frame_admitted() {
+  StaticFrameGate gate(config(5000ms));
+  const auto t0 = Clock::now();
+  CHECK(gate.admit(true, t0));
+  CHECK(!gate.admit(false, t0 + 100ms));
+  // Past the interval, between refreshes: the frame must still go out.
+  CHECK(gate.admit(false, t0 + 5000ms + 500ms));
+  CHECK(gate.take_key_unit());
+  CHECK(!gate.take_key_unit());
+  CHECK(!gate.admit(false, t0 + 5000ms + 600ms));
+}
+
+}  // namespace
+
+int main() {
+  test_refresh_only_without_interval();
+  test_keyframe_every_interval_while_skipping();
+  test_encoder_keyframes_postpone();
+  test_no_forcing_while_frames_flow();
+  test_forced_frame_admitted();
+  return test::result("static_gate");
+}
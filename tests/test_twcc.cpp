@@ -0,0 +1,100 @@
+// Transport-wide feedback parsing: status chunks, receive deltas and reference time wrap
+#include "check.h"
+#include "twcc.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace ve;
+
+namespace {
+
+// One feedback message: `deltas` small receive deltas (250 us units) for
+// consecutive packets from base_seq, in a single run-length chunk.
+std::vector<std::uint8_t> make_fci(std::uint16_t base_seq, std::uint32_t reference,
+                                   const std::vector<std::uint8_t>& deltas) {
+  const auto n = static_cast<std::uint16_t>(deltas.size());
+  const auto chunk = static_cast<std::uint16_t>((1u << 13) | n);  // run of "small delta"
+  std::vector<std::uint8_t> fci = {
+      static_cast<std::uint8_t>(base_seq >> 8), static_cast<std::uint8_t>(base_seq),
+      static_cast<std::uint8_t>(n >> 8),        static_cast<std::uint8_t>(n),
+      static_cast<std::uint8_t>(reference >> 16), static_cast<std::uint8_t>(reference >> 8),
+      static_cast<std::uint8_t>(reference),     0,
+      static_cast<std::uint8_t>(chunk >> 8),    static_cast<std::uint8_t>(chunk)};
+  fci.insert(fci.end(), deltas.begin(), deltas.end());
+  return fci;
+}
+
+long long arrival_us(const TwccFeedback& fb, std::size_t i) { return fb.packets.at(i).arrival.count(); }
+
+void test_parse_run_length() {
+  TwccFeedback fb;
+  CHECK(parse_twcc_fci(make_fci(100, 10, {4, 8, 0}), fb));
+  CHECK_EQ(fb.base_seq, 100);
+  CHECK_EQ(fb.packets.size(), 3u);
+  CHECK_EQ(fb.packets[2].seq, 102);
+  CHECK(fb.packets[0].received && fb.packets[2].received);
+  CHECK_EQ(arrival_us(fb, 0), 10 * 64000 + 1000);
+  CHECK_EQ(arrival_us(fb, 1), 10 * 64000 + 3000);
+  CHECK_EQ(arrival_us(fb, 2), 10 * 64000 + 3000);
+}
+
+void test_parse_truncated() {
+  TwccFeedback fb;
+  auto fci = make_fci(0, 0, {1, 2});
+  fci.pop_back();
+  CHECK(!parse_twcc_fci(fci, fb));
+}
+
+void test_reference_sign_extended() {
+  TwccFeedback fb;
+  CHECK(parse_twcc_fci(make_fci(0, 0xffffff, {0}), fb));
+  CHECK_EQ(arrival_us(fb, 0), -64000);
+}
+
+void test_reference_wrap() {
+  // Reference time steps by one unit across the 24-bit wrap and across the
+  // sign boundary; arrivals must advance by 64 ms both times.
+  TwccReferenceUnwrapper unwrap;
+  TwccFeedback a, b, c;
+  CHECK(parse_twcc_fci(make_fci(0, 0x7fffff, {0}), a, &unwrap));
+  CHECK(parse_twcc_fci(make_fci(1, 0x800000, {0}), b, &unwrap));
+  CHECK_EQ(arrival_us(b, 0) - arrival_us(a, 0), 64000);
+
+  TwccReferenceUnwrapper unwrap2;
+  CHECK(parse_twcc_fci(make_fci(0, 0xfffffe, {0}), a, &unwrap2));
+  CHECK(parse_twcc_fci(make_fci(1, 0xffffff, {0}), b, &unwrap2));
+  CHECK(parse_twcc_fci(make_fci(2, 0x000001, {0}), c, &unwrap2));
+  CHECK_EQ(arrival_us(b, 0) - arrival_us(a, 0), 64000);
+  CHECK_EQ(arrival_us(c, 0) - arrival_us(b, 0), 2 * 64000);
+}
+
+void test_reference_reordered() {
+  // A late message may carry an older reference time; it steps back.
+  TwccReferenceUnwrapper unwrap;
+  CHECK_EQ(unwrap.unwrap(0x000002), 2);
+  CHECK_EQ(unwrap.unwrap(0xffffff), -1);
+  CHECK_EQ(unwrap.unwrap(0x000003), 3);
+}
+
+void test_malformed_keeps_unwrapper() {
+  TwccReferenceUnwrapper unwrap;
+  TwccFeedback fb;
+  CHECK(parse_twcc_fci(make_fci(0, 5, {0}), fb, &unwrap));
+  auto bad = make_fci(1, 0x400000, {1, 2});
+  bad.pop_back();
+  CHECK(!parse_twcc_fci(bad, fb, &unwrap));
+  CHECK_EQ(unwrap.unwrap(6), 6);
+}
+
+}  // namespace
+
+int main() {
+  test_parse_run_length();
+  test_parse_truncated();
+  test_reference_sign_extended();
+  test_reference_wrap();
+  test_reference_reordered();
+  test_malformed_keeps_unwrapper();
+  return test::result("twcc");
+}
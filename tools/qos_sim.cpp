@@ -0,0 +1,423 @@
+// Trace-driven QoS simulator: replays bandwidth/loss/RTT traces in virtual time
+#include "logger.h"
+#include "rate_controller.h"
+#include "twcc.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ve;
+
+namespace {
+
+using Clock = RateController::Clock;
+using Micros = std::chrono::microseconds;
+
+constexpr std::size_t kPacketBytes = 1200;
+constexpr int kFps = 30;
+constexpr auto kFeedbackInterval = std::chrono::milliseconds(50);
+constexpr auto kReportInterval = std::chrono::seconds(1);
+constexpr auto kMaxQueueDelay = std::chrono::milliseconds(250);
+constexpr unsigned int kBaseKbps = 4000;
+constexpr int kStaticFec = 20;  // loss/gcc runs keep the configured redundancy
+
+// Capacity, random loss and RTT hold from `start` until the next point.
+// With burst > 1 losses come in runs of that mean length (Gilbert model).
+struct TracePoint {
+  double start_s = 0.0;
+  double capacity_kbps = 0.0;
+  double loss = 0.0;
+  double rtt_ms = 0.0;
+  double burst = 1.0;
+};
+
+struct Trace {
+  std::string name;
+  std::vector<TracePoint> points;
+  double duration_s = 60.0;
+
+  const TracePoint& at(double t_s) const {
+    auto it = std::upper_bound(points.begin(), points.end(), t_s,
+                               [](double t, const TracePoint& p) { return t < p.start_s; });
+    return it == points.begin() ? points.front() : *(it - 1);
+  }
+};
+
+std::vector<Trace> builtin_traces() {
+  return {
+      {"step", {{0, 8000, 0, 60}, {20, 4000, 0, 60}, {40, 8000, 0, 60}}, 60},
+      {"deep-step", {{0, 3000, 0, 60}, {20, 1000, 0, 60}, {40, 3000, 0, 60}}, 60},
+      {"ramp", {{0, 1500, 0, 60}, {10, 2500, 0, 60}, {20, 4000, 0, 60}, {30, 2000, 0, 60},
+                {40, 6000, 0, 60}, {50, 1000, 0, 60}}, 60},
+      {"lossy", {{0, 5000, 0.03, 80}}, 60},
+      {"bursty", {{0, 5000, 0.03, 80, 4}}, 60},
+      {"high-rtt", {{0, 6000, 0, 250}, {20, 3000, 0, 250}, {40, 6000, 0, 250}}, 60},
+      {"flaky", {{0, 2500, 0.01, 60}, {15, 2500, 0.10, 60}, {25, 2500, 0.01, 60},
+                 {35, 800, 0.02, 120}, {45, 2500, 0.01, 60}}, 60},
+  };
+}
+
+// CSV: seconds,capacity_kbps,loss,rtt_ms[,mean_burst] per line; '#' starts a comment.
+bool load_trace(const std::string& path, Trace& out) {
+  std::ifstream f(path);
+  if (!f) return false;
+  out.name = path;
+  out.points.clear();
+  std::string line;
+  while (std::getline(f, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream ss(line);
+    TracePoint p;
+    if (!(ss >> p.start_s >> p.capacity_kbps >> p.loss >> p.rtt_ms)) return false;
+    if (!(ss >> p.burst)) p.burst = 1.0;
+    out.points.push_back(p);
+  }
+  if (out.points.empty()) return false;
+  std::sort(out.points.begin(), out.points.end(),
+            [](const TracePoint& a, const TracePoint& b) { return a.start_s < b.start_s; });
+  out.duration_s = out.points.back().start_s + 10.0;
+  return true;
+}
+
+enum class Algorithm { Loss, Gcc, Probe, Joint };
+
+const char* algorithm_name(Algorithm a) {
+  switch (a) {
+    case Algorithm::Loss: return "loss";
+    case Algorithm::Gcc: return "gcc";
+    case Algorithm::Probe: return "probe";
+    case Algorithm::Joint: return "joint";
+  }
+  return "unknown";
+}
+
+struct RunResult {
+  double convergence_s = 0.0;  // mean over capacity steps that converged
+  int steps = 0;
+  int converged = 0;
+  double overshoot_pct = 0.0;  // worst 1 s send rate above capacity
+  double utilisation = 0.0;    // delivered / capacity
+  double loss = 0.0;           // packets lost in queue or on the link
+  double queue_p95_ms = 0.0;
+  double mean_kbps = 0.0;      // encoder bitrate
+  int fec_changes = 0;
+  int profile_changes = 0;
+  int probes = 0;
+  int fec_interleave = 1;      // at the end of the run
+};
+
+struct InFlight {
+  std::uint16_t seq = 0;
+  Clock::time_point send{};
+  Clock::time_point known{};  // arrival, or when the receiver notices the gap
+  Micros arrival{0};          // receiver clock
+  bool received = false;
+};
+
+struct Delivery {
+  Clock::time_point at{};
+  bool report = false;  // receiver report, else transport feedback
+  double fraction_lost = 0.0;
+  double rtt_ms = 0.0;
+  TwccFeedback feedback;
+
+  bool operator>(const Delivery& o) const { return at > o.at; }
+};
+
+double seconds(Clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+Clock::duration from_seconds(double s) {
+  return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(s));
+}
+
+// Packet-level simulation: frames are sent back to back through one FIFO
+// bottleneck with a 250 ms drop-tail queue, then random loss; the receiver
+// sends transport-wide feedback every 50 ms and a receiver report every
+// second, each delayed by half the RTT. Probe padding is paced evenly over
+// its cluster.
+RunResult simulate(const Trace& trace, Algorithm algo, std::uint32_t seed) {
+  RateController rc(kBaseKbps);
+  rc.set_fec_percentage(kStaticFec);
+  if (algo == Algorithm::Probe || algo == Algorithm::Joint) rc.enable_probing(ProbeConfig{});
+  if (algo == Algorithm::Joint) {
+    rc.enable_joint_adaptation(make_profile_ladder(VideoProfile{1280, 720, kFps, int(kBaseKbps)}), kStaticFec);
+    rc.enable_loss_patterns(FecLayoutConfig{});
+  }
+  int fec = kStaticFec;
+
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  TwccSendHistory history(8192);
+  std::vector<PacketResult> results;
+
+  const Clock::time_point t0{};
+  const auto end = t0 + from_seconds(trace.duration_s);
+  const std::size_t buckets = static_cast<std::size_t>(std::ceil(trace.duration_s)) + 1;
+  std::vector<double> sent_bits(buckets, 0.0), delivered_bits(buckets, 0.0), capacity_bits(buckets, 0.0);
+  std::vector<double> queue_ms;
+
+  Clock::time_point link_free = t0;
+  Clock::time_point next_frame = t0, next_feedback = t0 + kFeedbackInterval, next_report = t0 + kReportInterval;
+  std::deque<InFlight> in_flight;  // stamped packets not yet covered by feedback
+  std::deque<Clock::time_point> padding;  // pending probe padding, paced
+  std::uint64_t report_sent = 0, report_lost = 0, total_sent = 0, total_lost = 0;
+  std::priority_queue<Delivery, std::vector<Delivery>, std::greater<>> deliveries;
+  double bitrate_sum = 0.0;
+  int frames = 0;
+  bool in_burst = false;
+  RunResult r;
+
+  auto apply = [&](const RateDecision& d, Clock::time_point now) {
+    if (d.fec_changed) {
+      fec = d.fec_percentage;
+      ++r.fec_changes;
+    }
+    if (d.profile_changed) ++r.profile_changes;
+    r.fec_interleave = d.fec_interleave;
+    if (d.probe_padding_kbps > 0) {
+      ++r.probes;
+      const double bits = d.probe_padding_kbps * static_cast<double>(d.probe_duration.count());
+      const int n = std::max(1, static_cast<int>(bits / (kPacketBytes * 8.0)));
+      const Clock::time_point from = std::max(padding.empty() ? t0 : padding.back(), now);
+      for (int i = 0; i < n; ++i) padding.push_back(from + d.probe_duration * i / n);
+    }
+  };
+
+  // Media and probe padding carry transport-wide sequence numbers, FEC not.
+  auto send_packet = [&](Clock::time_point now, bool stamped) {
+    const TracePoint& tp = trace.at(seconds(now - t0));
+    const auto one_way = from_seconds(tp.rtt_ms / 2000.0);
+    const auto tx = from_seconds(kPacketBytes * 8.0 / (tp.capacity_kbps * 1000.0));
+    const Clock::time_point start = std::max(now, link_free);
+    const bool queue_drop = start - now > kMaxQueueDelay;
+    bool lost = queue_drop;
+    if (!queue_drop) {
+      link_free = start + tx;
+      queue_ms.push_back(seconds(start - now) * 1000.0);
+      if (tp.burst > 1.0) {
+        lost = in_burst;
+        const double enter = tp.loss / (tp.burst * (1.0 - tp.loss));
+        in_burst = uniform(rng) < (in_burst ? 1.0 - 1.0 / tp.burst : enter);
+      } else {
+        lost = uniform(rng) < tp.loss;
+      }
+    }
+    const Clock::time_point arrive = queue_drop ? now + one_way : link_free + one_way;
+    const std::size_t bucket = std::min(buckets - 1, static_cast<std::size_t>(seconds(now - t0)));
+    sent_bits[bucket] += kPacketBytes * 8.0;
+    if (!lost) delivered_bits[bucket] += kPacketBytes * 8.0;
+    ++report_sent;
+    ++total_sent;
+    if (lost) {
+      ++report_lost;
+      ++total_lost;
+    }
+    if (!stamped || algo == Algorithm::Loss) return;
+
+    InFlight p;
+    p.seq = history.record(kPacketBytes, now);
+    p.send = now;
+    p.known = arrive;
+    p.arrival = std::chrono::duration_cast<Micros>(arrive - t0);
+    p.received = !lost;
+    in_flight.push_back(p);
+  };
+
+  while (true) {
+    const Clock::time_point now =
+        std::min({next_frame, next_feedback, next_report,
+                  deliveries.empty() ? Clock::time_point::max() : deliveries.top().at,
+                  padding.empty() ? Clock::time_point::max() : padding.front()});
+    if (now >= end) break;
+    const TracePoint& tp = trace.at(seconds(now - t0));
+
+    if (!deliveries.empty() && deliveries.top().at == now) {
+      Delivery d = deliveries.top();
+      deliveries.pop();
+      if (d.report) {
+        apply(rc.on_receiver_report(d.fraction_lost, d.rtt_ms, now), now);
+      } else {
+        results.clear();
+        history.resolve(d.feedback, results);
+        if (!results.empty()) apply(rc.on_transport_feedback(results, now), now);
+      }
+    } else if (!padding.empty() && padding.front() == now) {
+      padding.pop_front();
+      send_packet(now, true);
+    } else if (now == next_frame) {
+      // One encoded frame plus its FEC share, sent back to back.
+      const double frame_bits = rc.bitrate_kbps() * 1000.0 / kFps;
+      const int media = std::max(1, static_cast<int>(std::lround(frame_bits / (kPacketBytes * 8.0))));
+      const int parity = static_cast<int>(std::lround(media * fec / 100.0));
+      const auto gap = from_seconds(kPacketBytes * 8.0 / 1e9);
+      for (int i = 0; i < media + parity; ++i) send_packet(now + i * gap, i < media);
+      bitrate_sum += rc.bitrate_kbps();
+      ++frames;
+      next_frame += std::chrono::microseconds(1000000 / kFps);
+    } else if (now == next_feedback) {
+      Delivery d;
+      d.at = now + from_seconds(tp.rtt_ms / 2000.0);
+      while (!in_flight.empty() && in_flight.front().known <= now) {
+        const InFlight& p = in_flight.front();
+        if (d.feedback.packets.empty()) d.feedback.base_seq = p.seq;
+        TwccPacket tw;
+        tw.seq = p.seq;
+        tw.received = p.received;
+        tw.arrival = p.arrival;
+        d.feedback.packets.push_back(tw);
+        in_flight.pop_front();
+      }
+      if (!d.feedback.packets.empty()) deliveries.push(std::move(d));
+      next_feedback += kFeedbackInterval;
+    } else {
+      Delivery d;
+      d.at = now + from_seconds(tp.rtt_ms / 2000.0);
+      d.report = true;
+      d.fraction_lost = report_sent ? static_cast<double>(report_lost) / report_sent : 0.0;
+      d.rtt_ms = tp.rtt_ms;
+      deliveries.push(std::move(d));
+      report_sent = report_lost = 0;
+      next_report += kReportInterval;
+    }
+  }
+
+  // Per-second metrics against the capacity the controller could use.
+  double capacity_total = 0.0, delivered_total = 0.0;
+  for (std::size_t s = 0; s < buckets; ++s) {
+    const double t = std::min(static_cast<double>(s), trace.duration_s);
+    const double len = std::min(1.0, trace.duration_s - t);
+    if (len <= 0.0) continue;
+    capacity_bits[s] = trace.at(t).capacity_kbps * 1000.0 * len;
+    capacity_total += capacity_bits[s];
+    delivered_total += delivered_bits[s];
+    if (len == 1.0 && sent_bits[s] > capacity_bits[s]) {
+      r.overshoot_pct = std::max(r.overshoot_pct, (sent_bits[s] / capacity_bits[s] - 1.0) * 100.0);
+    }
+  }
+  r.utilisation = capacity_total > 0 ? delivered_total / capacity_total : 0.0;
+  r.loss = total_sent ? static_cast<double>(total_lost) / total_sent : 0.0;
+  r.mean_kbps = frames ? bitrate_sum / frames : 0.0;
+  if (!queue_ms.empty()) {
+    auto p95 = queue_ms.begin() + static_cast<std::ptrdiff_t>(queue_ms.size() * 95 / 100);
+    std::nth_element(queue_ms.begin(), p95, queue_ms.end());
+    r.queue_p95_ms = *p95;
+  }
+
+  // Convergence: after each capacity change, first second from which the
+  // send rate stays within 80-105% of what is reachable for 3 s.
+  const double max_total_kbps = rc.max_kbps() * (100.0 + kStaticFec) / 100.0;
+  double convergence_sum = 0.0;
+  for (std::size_t i = 0; i < trace.points.size(); ++i) {
+    if (i > 0 && trace.points[i].capacity_kbps == trace.points[i - 1].capacity_kbps) continue;
+    const double from = trace.points[i].start_s;
+    const double to = i + 1 < trace.points.size() ? trace.points[i + 1].start_s : trace.duration_s;
+    const double reachable = std::min(trace.points[i].capacity_kbps, max_total_kbps) * 1000.0;
+    ++r.steps;
+    int streak = 0;
+    for (std::size_t s = static_cast<std::size_t>(from); s < static_cast<std::size_t>(to) && s < buckets; ++s) {
+      const double ratio = sent_bits[s] / reachable;
+      streak = (ratio >= 0.8 && ratio <= 1.05) ? streak + 1 : 0;
+      if (streak == 3) {
+        convergence_sum += static_cast<double>(s) - 2 - from;
+        ++r.converged;
+        break;
+      }
+    }
+  }
+  r.convergence_s = r.converged ? convergence_sum / r.converged : 0.0;
+  return r;
+}
+
+void print_usage(const char* prog) {
+  std::fprintf(stderr,
+               "Usage: %s [--trace=<csv>]... [--algo=loss|gcc|probe|joint]... [--repeat=<n>] [--verbose]\n"
+               "  csv lines: seconds,capacity_kbps,loss(0-1),rtt_ms[,mean_burst_packets]\n"
+               "  without --trace the built-in traces are replayed\n",
+               prog);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<Trace> traces;
+  std::vector<Algorithm> algos;
+  int repeat = 1;
+  bool verbose = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    if (a.rfind("--trace=", 0) == 0) {
+      Trace t;
+      if (!load_trace(a.substr(8), t)) {
+        std::fprintf(stderr, "Cannot read trace %s\n", a.substr(8).c_str());
+        return 1;
+      }
+      traces.push_back(std::move(t));
+    } else if (a == "--algo=loss") {
+      algos.push_back(Algorithm::Loss);
+    } else if (a == "--algo=gcc") {
+      algos.push_back(Algorithm::Gcc);
+    } else if (a == "--algo=probe") {
+      algos.push_back(Algorithm::Probe);
+    } else if (a == "--algo=joint") {
+      algos.push_back(Algorithm::Joint);
+    } else if (a.rfind("--repeat=", 0) == 0) {
+      repeat = std::max(1, std::atoi(a.c_str() + 9));
+    } else if (a == "--verbose") {
+      verbose = true;
+    } else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  if (traces.empty()) traces = builtin_traces();
+  if (algos.empty()) algos = {Algorithm::Loss, Algorithm::Gcc, Algorithm::Probe, Algorithm::Joint};
+  Logger::set_level(verbose ? LogLevel::Debug : LogLevel::Error);
+
+  const auto wall_start = std::chrono::steady_clock::now();
+  double trace_minutes = 0.0;
+  std::printf("{\n  \"runs\": [");
+  bool first = true;
+  for (const Trace& trace : traces) {
+    for (Algorithm algo : algos) {
+      RunResult sum;
+      for (int n = 0; n < repeat; ++n) {
+        const RunResult r = simulate(trace, algo, 1234u + static_cast<std::uint32_t>(n));
+        trace_minutes += trace.duration_s / 60.0;
+        sum.convergence_s += r.convergence_s;
+        sum.steps += r.steps;
+        sum.converged += r.converged;
+        sum.overshoot_pct = std::max(sum.overshoot_pct, r.overshoot_pct);
+        sum.utilisation += r.utilisation;
+        sum.loss += r.loss;
+        sum.queue_p95_ms += r.queue_p95_ms;
+        sum.mean_kbps += r.mean_kbps;
+        sum.fec_changes += r.fec_changes;
+        sum.profile_changes += r.profile_changes;
+        sum.probes += r.probes;
+        sum.fec_interleave = r.fec_interleave;
+      }
+      std::printf("%s\n    {\"trace\": \"%s\", \"algorithm\": \"%s\", \"repeat\": %d, "
+                  "\"convergence_s\": %.2f, \"converged_steps\": \"%d/%d\", \"overshoot_pct\": %.1f, "
+                  "\"utilisation\": %.3f, \"loss\": %.4f, \"queue_p95_ms\": %.1f, \"mean_kbps\": %.0f, "
+                  "\"fec_changes\": %d, \"profile_changes\": %d, \"probes\": %d, \"fec_interleave\": %d}",
+                  first ? "" : ",", trace.name.c_str(), algorithm_name(algo), repeat,
+                  sum.convergence_s / repeat, sum.converged, sum.steps, sum.overshoot_pct,
+                  sum.utilisation / repeat, sum.loss / repeat, sum.queue_p95_ms / repeat,
+                  sum.mean_kbps / repeat, sum.fec_changes, sum.profile_changes, sum.probes, sum.fec_interleave);
+      first = false;
+    }
+  }
+  const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  std::printf("\n  ],\n  \"trace_minutes\": %.1f,\n  \"wall_s\": %.2f\n}\n", trace_minutes, wall);
+  return 0;
+}
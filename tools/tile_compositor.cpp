@@ -0,0 +1,314 @@
+// Receiver for tiled encoding: decodes each strip's RTP stream and composites them by RTP timestamp
+#include "logger.h"
+#include "tile_layout.h"
+
+#include <gst/gst.h>
+#include <gst/rtp/rtp.h>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace ve;
+
+namespace {
+
+constexpr int kClockRate = 90000;
+// A frame counts as done once timestamps this far ahead have arrived.
+constexpr std::int64_t kSettleTicks = kClockRate / 2;
+
+GMainLoop* g_loop = nullptr;
+
+struct CompositorConfig {
+  int port = 0;
+  int tiles = 2;
+  int width = 0;
+  int height = 0;
+  int latency_ms = 100;
+  std::string sink = "autovideosink";
+};
+
+void print_usage(const char* prog) {
+  std::fprintf(stderr,
+               "Usage: %s --port=<rtp port> --tiles=<n> --width=<px> --height=<px> [--latency=<ms>]\n"
+               "          [--sink=autovideosink|fakesink|...]\n"
+               "  Receives the strips video_engine --tiles=<n> sends, decodes each SSRC on its own\n"
+               "  branch and places it at its column. Frames are aligned by RTP timestamp; every\n"
+               "  second it prints how many frames arrived with all strips.\n",
+               prog);
+}
+
+bool parse(int argc, char** argv, CompositorConfig& cfg) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    auto value = [&](const char* key) -> const char* {
+      const std::string k = std::string(key) + "=";
+      return a.rfind(k, 0) == 0 ? argv[i] + k.size() : nullptr;
+    };
+    if (const char* v = value("--port")) {
+      cfg.port = std::atoi(v);
+    } else if (const char* v = value("--tiles")) {
+      cfg.tiles = std::clamp(std::atoi(v), 1, kMaxTiles);
+    } else if (const char* v = value("--width")) {
+      cfg.width = std::atoi(v);
+    } else if (const char* v = value("--height")) {
+      cfg.height = std::atoi(v);
+    } else if (const char* v = value("--latency")) {
+      cfg.latency_ms = std::clamp(std::atoi(v), 0, 2000);
+    } else if (const char* v = value("--sink")) {
+      cfg.sink = v;
+    } else {
+      return false;
+    }
+  }
+  return cfg.port > 0 && cfg.port < 65536 && cfg.width > 0 && cfg.height > 0;
+}
+
+// Shared across the strip branches (their streaming threads). Every strip of
+// a frame carries the same RTP timestamp, so mapping timestamps to running
+// time through one common base gives the compositor identical PTS for them.
+class TileSync {
+ public:
+  TileSync(GstElement* pipeline, int tiles) : pipeline_(pipeline), tiles_(tiles) {}
+
+  // PTS for a packet of `tile` with RTP timestamp `rtp`.
+  GstClockTime on_packet(int tile, std::uint32_t rtp) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!have_base_) {
+      const GstClockTime now = gst_element_get_current_running_time(pipeline_);
+      base_pts_ = GST_CLOCK_TIME_IS_VALID(now) ? now : 0;
+      last_rtp_ = rtp;
+      have_base_ = true;
+    }
+    // Unwrap against the last timestamp seen by any strip; strips stay
+    // within a few frames of each other.
+    const std::int64_t ext = last_ext_ + static_cast<std::int32_t>(rtp - last_rtp_);
+    if (ext > last_ext_) {
+      last_ext_ = ext;
+      last_rtp_ = rtp;
+    }
+    frames_[ext] |= 1u << tile;
+    settle(last_ext_ - kSettleTicks);
+    const std::int64_t ticks = std::max<std::int64_t>(ext, 0);
+    return base_pts_ + gst_util_uint64_scale(static_cast<guint64>(ticks), GST_SECOND, kClockRate);
+  }
+
+  // Frames with every strip / some strips missing since the last call.
+  void take_counts(std::uint64_t& complete, std::uint64_t& partial) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    complete = complete_;
+    partial = partial_;
+    complete_ = partial_ = 0;
+  }
+
+ private:
+  void settle(std::int64_t before) {
+    const std::uint32_t all = tiles_ >= 32 ? ~0u : (1u << tiles_) - 1;
+    while (!frames_.empty() && frames_.begin()->first < before) {
+      if (frames_.begin()->second == all) {
+        ++complete_;
+      } else {
+        ++partial_;
+      }
+      frames_.erase(frames_.begin());
+    }
+  }
+
+  std::mutex mtx_;
+  GstElement* pipeline_;
+  int tiles_;
+  bool have_base_ = false;
+  GstClockTime base_pts_ = 0;
+  std::uint32_t last_rtp_ = 0;
+  std::int64_t last_ext_ = 0;
+  std::map<std::int64_t, std::uint32_t> frames_;  // extended timestamp -> strips seen
+  std::uint64_t complete_ = 0;
+  std::uint64_t partial_ = 0;
+};
+
+struct Receiver {
+  CompositorConfig cfg;
+  std::vector<Tile> tiles;
+  GstElement* pipeline = nullptr;
+  GstElement* compositor = nullptr;
+  TileSync* sync = nullptr;
+  std::vector<bool> linked;
+};
+
+struct TileProbe {
+  TileSync* sync;
+  int tile;
+};
+
+// Replaces the jitter buffer's per-stream PTS with the shared mapping.
+GstPadProbeReturn retimestamp(GstPad*, GstPadProbeInfo* info, gpointer user_data) {
+  const auto* probe = static_cast<const TileProbe*>(user_data);
+  GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  if (!gst_rtp_buffer_map(buffer, GST_MAP_READ, &rtp)) return GST_PAD_PROBE_OK;
+  const std::uint32_t timestamp = gst_rtp_buffer_get_timestamp(&rtp);
+  gst_rtp_buffer_unmap(&rtp);
+  buffer = gst_buffer_make_writable(buffer);
+  GST_BUFFER_PTS(buffer) = GST_BUFFER_DTS(buffer) = probe->sync->on_packet(probe->tile, timestamp);
+  GST_PAD_PROBE_INFO_DATA(info) = buffer;
+  return GST_PAD_PROBE_OK;
+}
+
+void link_unknown(GstElement* pipeline, GstPad* pad) {
+  GstElement* sink = gst_element_factory_make("fakesink", nullptr);
+  gst_bin_add(GST_BIN(pipeline), sink);
+  gst_element_sync_state_with_parent(sink);
+  GstPad* sinkpad = gst_element_get_static_pad(sink, "sink");
+  gst_pad_link(pad, sinkpad);
+  gst_object_unref(sinkpad);
+}
+
+void on_new_ssrc_pad(GstElement*, guint ssrc, GstPad* pad, gpointer user_data) {
+  auto* r = static_cast<Receiver*>(user_data);
+  const int index = tile_index(ssrc, static_cast<int>(r->tiles.size()));
+  if (index < 0 || r->linked[index]) {
+    LOG_WARN("Ignoring SSRC ", ssrc, index < 0 ? " (not a tile stream)" : " (tile already linked)");
+    link_unknown(r->pipeline, pad);
+    return;
+  }
+  const Tile& tile = r->tiles[index];
+  GstElement* jitter = gst_element_factory_make("rtpjitterbuffer", nullptr);
+  GstElement* depay = gst_element_factory_make("rtph264depay", nullptr);
+  GstElement* parser = gst_element_factory_make("h264parse", nullptr);
+  GstElement* decoder = gst_element_factory_make("avdec_h264", nullptr);
+  GstElement* convert = gst_element_factory_make("videoconvert", nullptr);
+  if (!jitter || !depay || !parser || !decoder || !convert) {
+    LOG_ERROR("Tile ", index, ": missing rtpjitterbuffer/rtph264depay/h264parse/avdec_h264/videoconvert");
+    if (g_loop) g_main_loop_quit(g_loop);
+    return;
+  }
+  g_object_set(jitter, "latency", r->cfg.latency_ms, NULL);
+  gst_bin_add_many(GST_BIN(r->pipeline), jitter, depay, parser, decoder, convert, NULL);
+  GstPad* comp_pad = gst_element_get_request_pad(r->compositor, "sink_%u");
+  g_object_set(comp_pad, "xpos", tile.x, "ypos", 0, NULL);
+  GstPad* convert_src = gst_element_get_static_pad(convert, "src");
+  GstPad* jitter_sink = gst_element_get_static_pad(jitter, "sink");
+  const bool ok = gst_element_link_many(jitter, depay, parser, decoder, convert, NULL) &&
+                  gst_pad_link(convert_src, comp_pad) == GST_PAD_LINK_OK &&
+                  gst_pad_link(pad, jitter_sink) == GST_PAD_LINK_OK;
+  gst_object_unref(convert_src);
+  gst_object_unref(jitter_sink);
+  gst_object_unref(comp_pad);
+  if (!ok) {
+    LOG_ERROR("Tile ", index, ": failed to link decode branch");
+    if (g_loop) g_main_loop_quit(g_loop);
+    return;
+  }
+
+  GstPad* depay_sink = gst_element_get_static_pad(depay, "sink");
+  gst_pad_add_probe(depay_sink, GST_PAD_PROBE_TYPE_BUFFER, retimestamp, new TileProbe{r->sync, index},
+                    [](gpointer data) { delete static_cast<TileProbe*>(data); });
+  gst_object_unref(depay_sink);
+  for (GstElement* e : {jitter, depay, parser, decoder, convert}) gst_element_sync_state_with_parent(e);
+  r->linked[index] = true;
+  LOG_INFO("Tile ", index, ": SSRC ", ssrc, " -> columns ", tile.x, "-", tile.x + tile.width - 1);
+}
+
+gboolean report(gpointer user_data) {
+  auto* r = static_cast<Receiver*>(user_data);
+  std::uint64_t complete = 0, partial = 0;
+  r->sync->take_counts(complete, partial);
+  const auto streams = std::count(r->linked.begin(), r->linked.end(), true);
+  std::printf("{\"streams\": %ld, \"complete_frames\": %llu, \"partial_frames\": %llu}\n",
+              static_cast<long>(streams), static_cast<unsigned long long>(complete),
+              static_cast<unsigned long long>(partial));
+  std::fflush(stdout);
+  return G_SOURCE_CONTINUE;
+}
+
+gboolean bus_call(GstBus*, GstMessage* msg, gpointer) {
+  if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+    GError* err = nullptr;
+    gst_message_parse_error(msg, &err, nullptr);
+    LOG_ERROR("GStreamer error: ", (err ? err->message : "(unknown)"));
+    if (err) g_error_free(err);
+    if (g_loop) g_main_loop_quit(g_loop);
+  } else if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS) {
+    if (g_loop) g_main_loop_quit(g_loop);
+  }
+  return TRUE;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Receiver r;
+  if (!parse(argc, argv, r.cfg)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  gst_init(&argc, &argv);
+  std::signal(SIGINT, [](int) {
+    if (g_loop) g_main_loop_quit(g_loop);
+  });
+
+  r.tiles = plan_tiles(r.cfg.width, r.cfg.height, r.cfg.tiles);
+  r.linked.assign(r.tiles.size(), false);
+  r.pipeline = gst_pipeline_new("tile-compositor");
+  GstElement* src = gst_element_factory_make("udpsrc", "src");
+  GstElement* demux = gst_element_factory_make("rtpssrcdemux", "demux");
+  r.compositor = gst_element_factory_make("compositor", "compositor");
+  GstElement* capsfilter = gst_element_factory_make("capsfilter", "size");
+  GstElement* convert = gst_element_factory_make("videoconvert", "out_convert");
+  GstElement* sink = gst_element_factory_make(r.cfg.sink.c_str(), "sink");
+  if (!r.pipeline || !src || !demux || !r.compositor || !capsfilter || !convert || !sink) {
+    LOG_ERROR("Element creation failed. Ensure required GStreamer plugins are installed.");
+    return 1;
+  }
+
+  GstCaps* rtp_caps = gst_caps_new_simple("application/x-rtp",
+                                          "media", G_TYPE_STRING, "video",
+                                          "clock-rate", G_TYPE_INT, kClockRate,
+                                          "encoding-name", G_TYPE_STRING, "H264",
+                                          "payload", G_TYPE_INT, 96,
+                                          NULL);
+  g_object_set(src, "port", r.cfg.port, "caps", rtp_caps, "buffer-size", 4 << 20, NULL);
+  gst_caps_unref(rtp_caps);
+  GstCaps* size = gst_caps_new_simple("video/x-raw",
+                                      "width", G_TYPE_INT, r.cfg.width,
+                                      "height", G_TYPE_INT, r.cfg.height,
+                                      NULL);
+  g_object_set(capsfilter, "caps", size, NULL);
+  gst_caps_unref(size);
+  // Strips wait for each other this long before a frame is composed without them.
+  g_object_set(r.compositor, "latency", static_cast<guint64>(r.cfg.latency_ms) * GST_MSECOND, NULL);
+  g_object_set(sink, "sync", TRUE, NULL);
+
+  gst_bin_add_many(GST_BIN(r.pipeline), src, demux, r.compositor, capsfilter, convert, sink, NULL);
+  if (!gst_element_link(src, demux) || !gst_element_link_many(r.compositor, capsfilter, convert, sink, NULL)) {
+    LOG_ERROR("Failed to link compositor pipeline");
+    return 1;
+  }
+  TileSync sync(r.pipeline, static_cast<int>(r.tiles.size()));
+  r.sync = &sync;
+  g_signal_connect(demux, "new-ssrc-pad", G_CALLBACK(on_new_ssrc_pad), &r);
+
+  GstBus* bus = gst_element_get_bus(r.pipeline);
+  const guint bus_watch_id = gst_bus_add_watch(bus, bus_call, nullptr);
+  g_loop = g_main_loop_new(nullptr, FALSE);
+  const guint report_id = g_timeout_add_seconds(1, report, &r);
+
+  LOG_INFO("Listening on port ", r.cfg.port, " for ", r.tiles.size(), " strips of a ", r.cfg.width, "x",
+           r.cfg.height, " frame");
+  gst_element_set_state(r.pipeline, GST_STATE_PLAYING);
+  g_main_loop_run(g_loop);
+
+  g_source_remove(report_id);
+  gst_element_set_state(r.pipeline, GST_STATE_NULL);
+  g_source_remove(bus_watch_id);
+  gst_object_unref(bus);
+  g_main_loop_unref(g_loop);
+  g_loop = nullptr;
+  gst_object_unref(r.pipeline);
+  return 0;
+}
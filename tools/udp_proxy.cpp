@@ -0,0 +1,199 @@
+// Rate-limiting UDP proxy: a bottleneck link for testing rate control live
+#include "logger.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ve;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+volatile std::sig_atomic_t g_stop = 0;
+
+struct RateStep {
+  double at_s = 0.0;
+  double kbps = 0.0;
+};
+
+struct ProxyConfig {
+  int listen_port = 0;
+  sockaddr_in to{};
+  double rate_kbps = 2000.0;
+  std::vector<RateStep> schedule;  // replaces rate_kbps from each step on
+  std::chrono::milliseconds queue{200};
+  std::chrono::milliseconds delay{0};
+  double loss = 0.0;
+};
+
+struct Queued {
+  std::vector<std::uint8_t> data;
+  Clock::time_point deliver{};
+};
+
+void print_usage(const char* prog) {
+  std::fprintf(stderr,
+               "Usage: %s --listen=<port> --to=<ip>:<port> [--rate=<kbps>] [--schedule=<s>:<kbps>,...]\n"
+               "          [--queue=<ms>] [--delay=<ms>] [--loss=<0-1>]\n"
+               "  Forwards datagrams through a FIFO bottleneck: serialised at the current rate,\n"
+               "  dropped when the queue would exceed --queue, delayed by --delay, then random loss.\n",
+               prog);
+}
+
+bool parse_schedule(const std::string& text, std::vector<RateStep>& out) {
+  std::stringstream ss(text);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    const auto colon = item.find(':');
+    if (colon == std::string::npos) return false;
+    out.push_back({std::atof(item.substr(0, colon).c_str()), std::atof(item.substr(colon + 1).c_str())});
+  }
+  std::sort(out.begin(), out.end(), [](const RateStep& a, const RateStep& b) { return a.at_s < b.at_s; });
+  return !out.empty();
+}
+
+bool parse(int argc, char** argv, ProxyConfig& cfg) {
+  bool have_to = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    auto value = [&](const char* key) -> const char* {
+      const std::string k = std::string(key) + "=";
+      return a.rfind(k, 0) == 0 ? argv[i] + k.size() : nullptr;
+    };
+    if (const char* v = value("--listen")) {
+      cfg.listen_port = std::atoi(v);
+    } else if (const char* v = value("--to")) {
+      const std::string to = v;
+      const auto colon = to.rfind(':');
+      if (colon == std::string::npos) return false;
+      cfg.to.sin_family = AF_INET;
+      cfg.to.sin_port = htons(static_cast<std::uint16_t>(std::atoi(to.c_str() + colon + 1)));
+      if (inet_pton(AF_INET, to.substr(0, colon).c_str(), &cfg.to.sin_addr) != 1) return false;
+      have_to = true;
+    } else if (const char* v = value("--rate")) {
+      cfg.rate_kbps = std::atof(v);
+    } else if (const char* v = value("--schedule")) {
+      if (!parse_schedule(v, cfg.schedule)) return false;
+    } else if (const char* v = value("--queue")) {
+      cfg.queue = std::chrono::milliseconds(std::atoi(v));
+    } else if (const char* v = value("--delay")) {
+      cfg.delay = std::chrono::milliseconds(std::atoi(v));
+    } else if (const char* v = value("--loss")) {
+      cfg.loss = std::clamp(std::atof(v), 0.0, 1.0);
+    } else {
+      return false;
+    }
+  }
+  return have_to && cfg.listen_port > 0 && cfg.listen_port < 65536 && cfg.rate_kbps > 0.0;
+}
+
+double rate_at(const ProxyConfig& cfg, double t_s) {
+  double kbps = cfg.rate_kbps;
+  for (const auto& step : cfg.schedule) {
+    if (step.at_s <= t_s) kbps = step.kbps;
+  }
+  return std::max(kbps, 1.0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ProxyConfig cfg;
+  if (!parse(argc, argv, cfg)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  std::signal(SIGINT, [](int) { g_stop = 1; });
+
+  const int in = socket(AF_INET, SOCK_DGRAM, 0);
+  const int out = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(static_cast<std::uint16_t>(cfg.listen_port));
+  if (in < 0 || out < 0 || bind(in, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    LOG_ERROR("Cannot bind UDP port ", cfg.listen_port);
+    return 1;
+  }
+  int rcvbuf = 4 << 20;
+  setsockopt(in, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  const auto start = Clock::now();
+  Clock::time_point link_free = start;  // when the bottleneck finishes the last queued packet
+  std::deque<Queued> queue;
+  std::vector<std::uint8_t> buf(65536);
+
+  std::uint64_t in_bytes = 0, out_bytes = 0, dropped = 0, lost = 0;
+  double max_queue_ms = 0.0;
+  auto next_stats = start + std::chrono::seconds(1);
+
+  while (!g_stop) {
+    const auto now = Clock::now();
+    while (!queue.empty() && queue.front().deliver <= now) {
+      const auto& q = queue.front();
+      if (uniform(rng) < cfg.loss) {
+        ++lost;
+      } else {
+        sendto(out, q.data.data(), q.data.size(), 0, reinterpret_cast<const sockaddr*>(&cfg.to), sizeof(cfg.to));
+        out_bytes += q.data.size();
+      }
+      queue.pop_front();
+    }
+
+    if (now >= next_stats) {
+      LOG_INFO("t=", std::chrono::duration_cast<std::chrono::seconds>(now - start).count(), "s rate ",
+               rate_at(cfg, std::chrono::duration<double>(now - start).count()), " kbps in ",
+               in_bytes * 8 / 1000, " kbps out ", out_bytes * 8 / 1000, " kbps, queue drops ", dropped,
+               ", lost ", lost, ", max queue ", static_cast<int>(max_queue_ms), " ms");
+      in_bytes = out_bytes = dropped = lost = 0;
+      max_queue_ms = 0.0;
+      next_stats += std::chrono::seconds(1);
+    }
+
+    int timeout_ms = 100;
+    if (!queue.empty()) {
+      const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(queue.front().deliver - now);
+      timeout_ms = std::clamp(static_cast<int>(wait.count()), 0, 100);
+    }
+    pollfd pfd{in, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) <= 0 || !(pfd.revents & POLLIN)) continue;
+
+    const ssize_t n = recv(in, buf.data(), buf.size(), 0);
+    if (n <= 0) continue;
+    const auto arrival = Clock::now();
+    in_bytes += static_cast<std::uint64_t>(n);
+
+    const auto wait = std::max(link_free, arrival) - arrival;
+    if (wait > cfg.queue) {
+      ++dropped;
+      continue;
+    }
+    max_queue_ms = std::max(max_queue_ms, std::chrono::duration<double, std::milli>(wait).count());
+    const double kbps = rate_at(cfg, std::chrono::duration<double>(arrival - start).count());
+    const auto tx = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(n * 8.0 / kbps));
+    link_free = std::max(link_free, arrival) + tx;
+    queue.push_back({std::vector<std::uint8_t>(buf.begin(), buf.begin() + n), link_free + cfg.delay});
+  }
+
+  close(in);
+  close(out);
+  return 0;
+}